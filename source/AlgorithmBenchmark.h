@@ -1,15 +1,113 @@
 #pragma once
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Trace.h"
 
 using std::chrono::duration;
 using std::chrono::high_resolution_clock;
 
+/// <summary>
+/// Statistics of the samples of a benchmark in milliseconds.
+/// </summary>
+struct BenchmarkStatistics
+{
+	size_t count = 0;
+	double min = 0;
+	double median = 0;
+	double mean = 0;
+	double p95 = 0;
+	double p99 = 0;
+	double max = 0;
+	double stdDev = 0;
+
+	/// <summary>
+	/// Computes the statistics of the given samples.
+	/// </summary>
+	/// <param name="samples">The samples in milliseconds</param>
+	/// <returns></returns>
+	static BenchmarkStatistics FromSamples(std::vector<double> samples) {
+		BenchmarkStatistics statistics;
+		statistics.count = samples.size();
+		if (samples.empty()) return statistics;
+
+		std::sort(samples.begin(), samples.end());
+		double sum = 0;
+		for (double sample : samples) sum += sample;
+		statistics.mean = sum / samples.size();
+
+		double squaredDeviations = 0;
+		for (double sample : samples) squaredDeviations += (sample - statistics.mean) * (sample - statistics.mean);
+		statistics.stdDev = (samples.size() > 1) ? std::sqrt(squaredDeviations / (samples.size() - 1)) : 0;
+
+		statistics.min = samples.front();
+		statistics.max = samples.back();
+		statistics.median = Percentile(samples, 0.5);
+		statistics.p95 = Percentile(samples, 0.95);
+		statistics.p99 = Percentile(samples, 0.99);
+		return statistics;
+	}
+
+private:
+	/// <summary>
+	/// Returns the percentile of sorted samples, interpolating linearly between the closest ranks.
+	/// </summary>
+	static double Percentile(const std::vector<double>& sortedSamples, double percentile) {
+		double rank = percentile * (sortedSamples.size() - 1);
+		size_t lower = static_cast<size_t>(rank);
+		size_t upper = std::min(lower + 1, sortedSamples.size() - 1);
+		return sortedSamples[lower] + (rank - lower) * (sortedSamples[upper] - sortedSamples[lower]);
+	}
+};
+
 class AlgorithmBenchmark
 {
 private:
 	double totalDuration = 0;
 	int repetitions = 0;
+	int warmupRepetitions = 0;
+	std::vector<double> samples;
+
+	// the durations of the phases of every measured repetition, in the order the phases were first recorded
+	std::vector<std::string> phaseNames;
+	std::map<std::string, std::vector<double>> phaseSamples;
+	std::map<std::string, double> currentPhases;
+
+	static AlgorithmBenchmark*& ActiveBenchmark() {
+		static AlgorithmBenchmark* activeBenchmark = nullptr;
+		return activeBenchmark;
+	}
+
+	// control characters are replaced by spaces, like in the trace
+	static void WriteJSONString(std::ostream& out, const std::string& text) {
+		out << '"';
+		for (char c : text) {
+			if (c == '"' || c == '\\') out << '\\' << c;
+			else if (static_cast<unsigned char>(c) < 0x20) out << ' ';
+			else out << c;
+		}
+		out << '"';
+	}
+
+	// fields with separators, quotes or line breaks are quoted, their quotes doubled
+	static void WriteCSVField(std::ostream& out, const std::string& text) {
+		if (text.find_first_of(",\"\r\n") == std::string::npos) {
+			out << text;
+			return;
+		}
+		out << '"';
+		for (char c : text) {
+			if (c == '"') out << '"';
+			out << c;
+		}
+		out << '"';
+	}
 
 public:
 	/// <summary>
@@ -17,7 +115,7 @@ public:
 	/// </summary>
 	/// <returns></returns>
 	double GetTotalDuration() const {
-		return totalDuration; 
+		return totalDuration;
 	}
 
 	/// <summary>
@@ -34,7 +132,43 @@ public:
 	/// </summary>
 	/// <returns></returns>
 	int GetRepetitions() const {
-		return repetitions; 
+		return repetitions;
+	}
+
+	/// <summary>
+	/// Sets the number of repetitions that are run before every benchmark without being measured, so that caches,
+	/// page mappings and thread pools are warmed up.
+	/// </summary>
+	/// <param name="warmupRepetitions"></param>
+	void SetWarmupRepetitions(int warmupRepetitions) {
+		this->warmupRepetitions = warmupRepetitions;
+	}
+
+	/// <summary>
+	/// Returns the statistics of the durations of the measured repetitions.
+	/// </summary>
+	/// <returns></returns>
+	BenchmarkStatistics GetStatistics() const {
+		return BenchmarkStatistics::FromSamples(samples);
+	}
+
+	/// <summary>
+	/// Returns the statistics of the durations of a phase over the measured repetitions.
+	/// </summary>
+	/// <param name="phaseName">The name of the phase</param>
+	/// <returns></returns>
+	BenchmarkStatistics GetPhaseStatistics(const std::string& phaseName) const {
+		auto phase = phaseSamples.find(phaseName);
+		if (phase == phaseSamples.end()) return BenchmarkStatistics();
+		return BenchmarkStatistics::FromSamples(phase->second);
+	}
+
+	/// <summary>
+	/// Returns the names of the phases recorded during the benchmark.
+	/// </summary>
+	/// <returns></returns>
+	const std::vector<std::string>& GetPhaseNames() const {
+		return phaseNames;
 	}
 
 	/// <summary>
@@ -46,14 +180,112 @@ public:
 	/// <param name="repetitions">Number of repetitions that he benchmark should be run</param>
 	template<typename Func>
 	void RunBenchmark(Func func, int repetitions) {
+		for (int i = 0; i < warmupRepetitions; i++) {
+			func();
+		}
+
+		// every repetition is measured on its own, so that outliers show up in the statistics
+		ActiveBenchmark() = this;
 		this->repetitions += repetitions;
-		auto startTime = high_resolution_clock::now();
 		for (int i = 0; i < repetitions; i++) {
+			currentPhases.clear();
+			auto startTime = high_resolution_clock::now();
 			func();
+			auto endTime = high_resolution_clock::now();
+			duration<double, std::milli> duration = endTime - startTime;
+			this->totalDuration += duration.count();
+			samples.push_back(duration.count());
+
+			for (const auto& phaseName : phaseNames) {
+				phaseSamples[phaseName].push_back(currentPhases[phaseName]);
+			}
+		}
+		ActiveBenchmark() = nullptr;
+	}
+
+	/// <summary>
+	/// Adds the duration of a phase to the current repetition of the running benchmark. Phases are recorded by the
+	/// thread that runs the benchmark, phases outside of a benchmark and of warm-up repetitions are ignored.
+	/// </summary>
+	/// <param name="phaseName">The name of the phase</param>
+	/// <param name="milliseconds">The duration of the phase</param>
+	static void RecordPhase(const std::string& phaseName, double milliseconds) {
+		AlgorithmBenchmark* benchmark = ActiveBenchmark();
+		if (benchmark == nullptr) return;
+
+		if (benchmark->phaseSamples.find(phaseName) == benchmark->phaseSamples.end()) {
+			// phases that first appear in a later repetition did not take any time in the earlier ones
+			benchmark->phaseNames.push_back(phaseName);
+			benchmark->phaseSamples[phaseName].assign(benchmark->samples.size(), 0.0);
+		}
+		benchmark->currentPhases[phaseName] += milliseconds;
+	}
+
+	/// <summary>
+	/// Writes the header of the rows written by WriteCSV.
+	/// </summary>
+	/// <param name="out"></param>
+	static void WriteCSVHeader(std::ostream& out) {
+		out << "benchmark,input,phase,count,min_ms,median_ms,mean_ms,p95_ms,p99_ms,max_ms,stddev_ms" << std::endl;
+	}
+
+	/// <summary>
+	/// Writes the statistics of the total duration and of every phase as CSV rows.
+	/// </summary>
+	/// <param name="out"></param>
+	/// <param name="name">The name of the benchmark</param>
+	/// <param name="input">The input of the benchmark</param>
+	void WriteCSV(std::ostream& out, const std::string& name, const std::string& input) const {
+		auto writeRow = [&](const std::string& phaseName, const BenchmarkStatistics& statistics) {
+			WriteCSVField(out, name);
+			out << ",";
+			WriteCSVField(out, input);
+			out << ",";
+			WriteCSVField(out, phaseName);
+			out << "," << statistics.count << "," << statistics.min << ","
+				<< statistics.median << "," << statistics.mean << "," << statistics.p95 << "," << statistics.p99 << ","
+				<< statistics.max << "," << statistics.stdDev << std::endl;
+		};
+
+		writeRow("total", GetStatistics());
+		for (const auto& phaseName : phaseNames) {
+			writeRow(phaseName, GetPhaseStatistics(phaseName));
+		}
+	}
+
+	/// <summary>
+	/// Writes the statistics of the total duration and of every phase as a JSON object, including the samples.
+	/// </summary>
+	/// <param name="out"></param>
+	/// <param name="name">The name of the benchmark</param>
+	/// <param name="input">The input of the benchmark</param>
+	void WriteJSON(std::ostream& out, const std::string& name, const std::string& input) const {
+		auto writeStatistics = [&](const std::string& phaseName, const std::vector<double>& phaseSamples) {
+			BenchmarkStatistics statistics = BenchmarkStatistics::FromSamples(phaseSamples);
+			out << "{\"phase\": ";
+			WriteJSONString(out, phaseName);
+			out << ", \"count\": " << statistics.count
+				<< ", \"min_ms\": " << statistics.min << ", \"median_ms\": " << statistics.median
+				<< ", \"mean_ms\": " << statistics.mean << ", \"p95_ms\": " << statistics.p95
+				<< ", \"p99_ms\": " << statistics.p99 << ", \"max_ms\": " << statistics.max
+				<< ", \"stddev_ms\": " << statistics.stdDev << ", \"samples_ms\": [";
+			for (size_t i = 0; i < phaseSamples.size(); i++) {
+				out << (i == 0 ? "" : ", ") << phaseSamples[i];
+			}
+			out << "]}";
+		};
+
+		out << "{\"benchmark\": ";
+		WriteJSONString(out, name);
+		out << ", \"input\": ";
+		WriteJSONString(out, input);
+		out << ", \"warmup_repetitions\": " << warmupRepetitions << ", \"phases\": [";
+		writeStatistics("total", samples);
+		for (const auto& phaseName : phaseNames) {
+			out << ", ";
+			writeStatistics(phaseName, phaseSamples.at(phaseName));
 		}
-		auto endTime = high_resolution_clock::now();
-		duration<double, std::milli> duration = endTime - startTime;
-		this->totalDuration += duration.count();
+		out << "]}";
 	}
 
 	/// <summary>
@@ -62,5 +294,35 @@ public:
 	void ResetBenchmark() {
 		this->totalDuration = 0;
 		this->repetitions = 0;
+		this->samples.clear();
+		this->phaseNames.clear();
+		this->phaseSamples.clear();
+		this->currentPhases.clear();
 	}
 };
+
+/// <summary>
+/// Measures the duration of a phase of the running benchmark from its construction until it goes out of scope.
+/// The phase is also recorded in the trace, if it is enabled.
+/// </summary>
+class BenchmarkPhase
+{
+private:
+	std::string phaseName;
+	high_resolution_clock::time_point startTime;
+	TraceScope trace;
+
+public:
+	explicit BenchmarkPhase(std::string phaseName)
+		: phaseName(std::move(phaseName)), startTime(high_resolution_clock::now()),
+		trace(TraceCategory::Phase, Trace::IsEnabled() ? this->phaseName : std::string()) {
+	}
+
+	~BenchmarkPhase() {
+		duration<double, std::milli> duration = high_resolution_clock::now() - startTime;
+		AlgorithmBenchmark::RecordPhase(phaseName, duration.count());
+	}
+
+	BenchmarkPhase(const BenchmarkPhase&) = delete;
+	BenchmarkPhase& operator=(const BenchmarkPhase&) = delete;
+};
@@ -0,0 +1,207 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <opencv2/opencv.hpp>
+#include <omp.h>
+#include "AlgorithmBenchmark.h"
+#include "BoundedQueue.h"
+#include "FilterPipeline.h"
+#include "ImageBatch.h"
+#include "ImageCache.h"
+#include "RawImage.h"
+
+/// <summary>
+/// An image of a batch on its way through the stages of the batch pipeline.
+/// </summary>
+struct BatchFrame
+{
+    int index = -1;
+    cv::Mat image;
+    // the bytes of the decoded image, which the filters may convert to an image of another size
+    size_t bytes = 0;
+};
+
+/// <summary>
+/// Applies the specified filter methods on a batch of images in a pipeline of a decode, a filter and an encode stage,
+/// which run in their own worker threads and are connected by bounded lock-free queues, so that images are decoded
+/// and encoded while other images are filtered. Full queues make the earlier stages wait, and no more images are
+/// decoded while the decoded images in flight would exceed the memory budget.
+/// </summary>
+/// <param name="batchPath">The directory of the to be filtered images or a file listing their paths</param>
+/// <param name="outputDir">The output directory path of the filtered images after saving</param>
+/// <param name="filterMethods">The image filter methods that should be run</param>
+/// <param name="decodeWorkers">The number of threads that decode images</param>
+/// <param name="filterWorkers">The number of threads that filter images, which share the OpenMP threads</param>
+/// <param name="encodeWorkers">The number of threads that encode images</param>
+/// <param name="queueCapacity">The maximum number of images waiting between two stages</param>
+/// <param name="memoryBudget">The maximum number of bytes of decoded images in flight, at least one image is always
+/// in flight</param>
+/// <param name="useOpenMP">Wether to use OpenMP for the image filter or not</param>
+/// <param name="saveImage">Wether to save the resulting images or not</param>
+static void BatchFilters(
+    const std::string& batchPath,
+    const std::string& outputDir,
+    const std::vector<std::function<void(cv::Mat&, bool)>>& filterMethods,
+    int decodeWorkers = 2,
+    int filterWorkers = 1,
+    int encodeWorkers = 2,
+    int queueCapacity = 4,
+    size_t memoryBudget = size_t(512) * 1024 * 1024,
+    bool useOpenMP = true,
+    bool saveImage = false
+) {
+    if (decodeWorkers < 1 || filterWorkers < 1 || encodeWorkers < 1)
+        throw std::invalid_argument("Every stage needs at least one worker!");
+
+    auto batchBegin = high_resolution_clock::now();
+    const std::vector<std::string> imagePaths = GetBatchImagePaths(batchPath);
+    const int imageCount = static_cast<int>(imagePaths.size());
+
+    BoundedQueue<BatchFrame> decodedFrames(queueCapacity);
+    BoundedQueue<BatchFrame> filteredFrames(queueCapacity);
+    std::atomic<int> nextImage{ 0 };
+    std::atomic<int> runningDecoders{ decodeWorkers };
+    std::atomic<int> runningFilters{ filterWorkers };
+    std::atomic<size_t> bytesInFlight{ 0 };
+    std::atomic<size_t> peakBytesInFlight{ 0 };
+    std::atomic<size_t> largestImageBytes{ 0 };
+    std::mutex budgetMutex;
+    std::condition_variable budgetReleased;
+    std::atomic<int> failedImages{ 0 };
+
+    // every stage sums the time its workers were busy, which shows how much of the batch the stage was idle
+    std::atomic<int64_t> decodeNanoseconds{ 0 };
+    std::atomic<int64_t> filterNanoseconds{ 0 };
+    std::atomic<int64_t> encodeNanoseconds{ 0 };
+    auto addDuration = [](std::atomic<int64_t>& total, high_resolution_clock::time_point begin) {
+        total += std::chrono::duration_cast<std::chrono::nanoseconds>(high_resolution_clock::now() - begin).count();
+    };
+
+    // the bytes of an image are only known after decoding it, so a decoder reserves the bytes of the largest image so
+    // far and corrects its reservation afterwards. Before the first image was decoded the whole budget is reserved,
+    // which decodes the first image alone. The bytes are reserved by a compare and swap, so that concurrent decoders
+    // never exceed the budget together, and the decoders sleep until enough bytes are released. An empty pipeline
+    // always takes the next image
+    auto reserveBytes = [&]() {
+        auto fits = [&](size_t inFlight, size_t& bytes) {
+            bytes = largestImageBytes.load();
+            if (bytes == 0) bytes = std::max<size_t>(memoryBudget, 1);
+            return inFlight == 0 || inFlight + bytes <= memoryBudget;
+        };
+        size_t inFlight = bytesInFlight.load();
+        size_t bytes = 0;
+        while (true) {
+            if (!fits(inFlight, bytes)) {
+                std::unique_lock<std::mutex> lock(budgetMutex);
+                budgetReleased.wait(lock, [&]() { return fits(inFlight = bytesInFlight.load(), bytes); });
+            }
+            if (bytesInFlight.compare_exchange_weak(inFlight, inFlight + bytes)) return bytes;
+        }
+    };
+    auto releaseBytes = [&](size_t bytes) {
+        bytesInFlight -= bytes;
+        std::lock_guard<std::mutex> lock(budgetMutex);
+        budgetReleased.notify_all();
+    };
+
+    auto decode = [&]() {
+        for (int index = nextImage++; index < imageCount; index = nextImage++) {
+            size_t reservedBytes = reserveBytes();
+
+            auto begin = high_resolution_clock::now();
+            BatchFrame frame;
+            frame.index = index;
+            try {
+                frame.image = ImageSource(imagePaths[index]).Decode();
+            }
+            catch (const std::exception&) {
+                frame.image = cv::Mat();
+            }
+            addDuration(decodeNanoseconds, begin);
+
+            if (frame.image.empty()) {
+                // a broken image does not stop the batch
+                std::cerr << "Could not open or find the image " << imagePaths[index] << "!" << std::endl;
+                failedImages++;
+                releaseBytes(reservedBytes);
+                continue;
+            }
+
+            size_t frameBytes = frame.bytes = frame.image.total() * frame.image.elemSize();
+            size_t largest = largestImageBytes.load();
+            while (frameBytes > largest && !largestImageBytes.compare_exchange_weak(largest, frameBytes)) {}
+            // an image larger than all images before it takes the bytes it exceeds its reservation by
+            if (frameBytes < reservedBytes) releaseBytes(reservedBytes - frameBytes);
+            else bytesInFlight += frameBytes - reservedBytes;
+            size_t inFlight = bytesInFlight.load();
+            size_t peak = peakBytesInFlight.load();
+            while (inFlight > peak && !peakBytesInFlight.compare_exchange_weak(peak, inFlight)) {}
+            decodedFrames.Push(std::move(frame));
+        }
+
+        // the last decoder tells the filter workers that no more images follow
+        if (--runningDecoders == 0) decodedFrames.Close();
+    };
+
+    // the OpenMP threads of the benchmark are split between the filter workers, since every worker thread starts
+    // with the default number of OpenMP threads
+    const int filterThreads = std::max(1, omp_get_max_threads() / filterWorkers);
+    auto filter = [&]() {
+        omp_set_num_threads(filterThreads);
+        BatchFrame frame;
+        while (decodedFrames.Pop(frame)) {
+            auto begin = high_resolution_clock::now();
+            for (const auto& filterMethod : filterMethods) {
+                filterMethod(frame.image, useOpenMP);
+            }
+            addDuration(filterNanoseconds, begin);
+            filteredFrames.Push(std::move(frame));
+        }
+
+        if (--runningFilters == 0) filteredFrames.Close();
+    };
+
+    auto encode = [&]() {
+        BatchFrame frame;
+        while (filteredFrames.Pop(frame)) {
+            auto begin = high_resolution_clock::now();
+            if (saveImage)
+                ImageOutput::Write(ImageOutput::GetPath(outputDir, GetBatchOutputName(imagePaths, frame.index)), frame.image);
+            addDuration(encodeNanoseconds, begin);
+
+            frame.image.release();
+            releaseBytes(frame.bytes);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int i = 0; i < decodeWorkers; i++) workers.emplace_back(decode);
+    for (int i = 0; i < filterWorkers; i++) workers.emplace_back(filter);
+    for (int i = 0; i < encodeWorkers; i++) workers.emplace_back(encode);
+    for (auto& worker : workers) worker.join();
+
+    double batchDuration = duration<double, std::milli>(high_resolution_clock::now() - batchBegin).count();
+    double decodeDuration = decodeNanoseconds / 1e6;
+    double filterDuration = filterNanoseconds / 1e6;
+    double encodeDuration = encodeNanoseconds / 1e6;
+
+    // the phases of the benchmark are the busy times of the stages, which overlap each other
+    AlgorithmBenchmark::RecordPhase("decode", decodeDuration);
+    AlgorithmBenchmark::RecordPhase("filter " + FilterPipeline::GetFilterName(FilterPipeline::FromFilterMethods(filterMethods)), filterDuration);
+    AlgorithmBenchmark::RecordPhase("encode", encodeDuration);
+
+    int filteredImages = std::max(1, imageCount - failedImages.load());
+    std::cout << "Images: " << imageCount << ", Failed: " << failedImages << std::endl;
+    std::cout << "Batch Duration: " << batchDuration << "ms" << std::endl;
+    std::cout << "Images per Second: " << imageCount / (batchDuration / 1000) << std::endl;
+    std::cout << "Average Decode Duration: " << decodeDuration / filteredImages << "ms, Utilization: "
+        << 100 * decodeDuration / (decodeWorkers * batchDuration) << "%" << std::endl;
+    std::cout << "Average Filter Duration: " << filterDuration / filteredImages << "ms, Utilization: "
+        << 100 * filterDuration / (filterWorkers * batchDuration) << "%" << std::endl;
+    std::cout << "Average Encode Duration: " << encodeDuration / filteredImages << "ms, Utilization: "
+        << 100 * encodeDuration / (encodeWorkers * batchDuration) << "%" << std::endl;
+    std::cout << "Peak Memory in Flight: " << peakBytesInFlight / (1024.0 * 1024.0) << "MiB" << std::endl;
+}
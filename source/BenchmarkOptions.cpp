@@ -0,0 +1,480 @@
+#include "BenchmarkOptions.h"
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <omp.h>
+#include "ImageFilter.h"
+#include "FilterPipeline.h"
+
+static const BenchmarkMode allModes[] = {
+    BenchmarkMode::Simple,
+    BenchmarkMode::OpenCV,
+    BenchmarkMode::Stream,
+    BenchmarkMode::Batch,
+    BenchmarkMode::Video,
+    BenchmarkMode::MPI,
+    BenchmarkMode::MPISingleLoop,
+    BenchmarkMode::MPIPipelined,
+    BenchmarkMode::MPIDynamic,
+    BenchmarkMode::MPIBatch,
+};
+
+/// <summary>
+/// Splits a comma separated list into its values, leaving out empty values.
+/// </summary>
+static std::vector<std::string> SplitList(const std::string& list)
+{
+    std::vector<std::string> values;
+    std::istringstream stream(list);
+    for (std::string value; std::getline(stream, value, ',');) {
+        if (!value.empty()) values.push_back(value);
+    }
+    if (values.empty())
+        throw std::invalid_argument("The list \"" + list + "\" is empty!");
+    return values;
+}
+
+/// <summary>
+/// Reads a whole number that is at least the given minimum.
+/// </summary>
+static int ParseInt(const std::string& option, const std::string& value, int minimum)
+{
+    size_t length = 0;
+    int number = 0;
+    try {
+        number = std::stoi(value, &length);
+    }
+    catch (const std::exception&) {
+        length = 0;
+    }
+
+    if (length == 0 || length != value.size())
+        throw std::invalid_argument("The value \"" + value + "\" of " + option + " is not a number!");
+    if (number < minimum)
+        throw std::invalid_argument("The value of " + option + " has to be at least " + std::to_string(minimum) + "!");
+    return number;
+}
+
+/// <summary>
+/// Reads the values of a switch that can be benchmarked off, on or both.
+/// </summary>
+static std::vector<bool> ParseSwitch(const std::string& option, const std::string& value)
+{
+    if (value == "no" || value == "0") return { false };
+    if (value == "yes" || value == "1") return { true };
+    if (value == "both") return { false, true };
+    throw std::invalid_argument("The value of " + option + " has to be no, yes or both!");
+}
+
+/// <summary>
+/// Reads a list of thread counts, where every value is either a single count or an inclusive range like 1-8.
+/// </summary>
+static std::vector<int> ParseThreads(const std::string& value)
+{
+    std::vector<int> threads;
+    for (const auto& part : SplitList(value)) {
+        size_t dash = part.find('-');
+        if (dash == std::string::npos) {
+            threads.push_back(ParseInt("--threads", part, 1));
+            continue;
+        }
+
+        int first = ParseInt("--threads", part.substr(0, dash), 1);
+        int last = ParseInt("--threads", part.substr(dash + 1), first);
+        for (int count = first; count <= last; count++) threads.push_back(count);
+    }
+    return threads;
+}
+
+std::string BenchmarkConfiguration::GetName(bool withInput) const
+{
+    std::string name = BenchmarkOptions::GetModeName(mode) + " threads=" + std::to_string(threads);
+    if (BenchmarkOptions::UsesFilterMethods(mode)) {
+        name += std::string(" collapsed=") + (collapsed ? "yes" : "no");
+        name += std::string(" fused=") + (fused ? "yes" : "no");
+        // the name of the default backend is left out, so that the results stay comparable to earlier builds
+        if (backend != ParallelBackend::OpenMP) name += " backend=" + TileScheduler::GetBackendName(backend);
+    }
+    return withInput ? name + " input=" + input : name;
+}
+
+BenchmarkOptions BenchmarkOptions::Parse(int argc, char** argv)
+{
+    BenchmarkOptions options;
+    bool hasSchedule = false;
+
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+
+        // every argument that is not an option is an input
+        if (argument.size() < 2 || argument.compare(0, 2, "--") != 0) {
+            options.inputs.push_back(argument);
+            continue;
+        }
+
+        // values are either given after an equals sign or as the next argument
+        std::string option = argument;
+        std::string value;
+        bool hasValue = false;
+        size_t equals = argument.find('=');
+        if (equals != std::string::npos) {
+            option = argument.substr(0, equals);
+            value = argument.substr(equals + 1);
+            hasValue = true;
+        }
+        auto nextValue = [&]() {
+            if (hasValue) return value;
+            if (i + 1 >= argc)
+                throw std::invalid_argument("The option " + option + " needs a value!");
+            return std::string(argv[++i]);
+        };
+
+        if (option == "--help") {
+            options.showHelp = true;
+        }
+        else if (option == "--mode") {
+            options.modes.clear();
+            for (const auto& modeName : SplitList(nextValue())) {
+                auto mode = std::find_if(std::begin(allModes), std::end(allModes),
+                    [&](BenchmarkMode mode) { return GetModeName(mode) == modeName; });
+                if (mode == std::end(allModes))
+                    throw std::invalid_argument("The mode \"" + modeName + "\" is unknown!");
+                options.modes.push_back(*mode);
+            }
+        }
+        else if (option == "--filters") {
+            options.filters.clear();
+            for (auto filter : SplitList(nextValue())) {
+                if (filter == "grayscale") filter = "gray";
+                if (filter != "hsv" && filter != "gray" && filter != "emboss")
+                    throw std::invalid_argument("The filter \"" + filter + "\" is unknown!");
+                options.filters.push_back(filter);
+            }
+        }
+        else if (option == "--collapsed") {
+            options.collapsed = ParseSwitch(option, nextValue());
+        }
+        else if (option == "--fuse") {
+            options.fused = ParseSwitch(option, nextValue());
+        }
+        else if (option == "--threads") {
+            options.threads = ParseThreads(nextValue());
+        }
+        else if (option == "--backend") {
+            options.backends.clear();
+            for (const auto& backendName : SplitList(nextValue())) {
+                ParallelBackend backend = TileScheduler::ParseBackend(backendName);
+                if (!TileScheduler::IsBackendAvailable(backend))
+                    throw std::invalid_argument("The backend " + backendName + " is not available in this build!");
+                options.backends.push_back(backend);
+            }
+        }
+        else if (option == "--input") {
+            options.inputs.push_back(nextValue());
+        }
+        else if (option == "--repetitions") {
+            options.repetitions = ParseInt(option, nextValue(), 1);
+        }
+        else if (option == "--warmup") {
+            options.warmupRepetitions = ParseInt(option, nextValue(), 0);
+        }
+        else if (option == "--output") {
+            options.outputDir = nextValue();
+        }
+        else if (option == "--output-format") {
+            options.outputFormat = nextValue();
+        }
+        else if (option == "--convert") {
+            options.convertPath = nextValue();
+        }
+        else if (option == "--kernel-benchmark") {
+            options.kernelBaselinePath = nextValue();
+        }
+        else if (option == "--kernel-threshold") {
+            options.kernelThreshold = ParseInt(option, nextValue(), 0) / 100.0;
+        }
+        else if (option == "--update-baseline") {
+            options.updateKernelBaseline = true;
+        }
+        else if (option == "--results") {
+            options.resultsPath = nextValue();
+        }
+        else if (option == "--trace") {
+            options.tracePath = nextValue();
+        }
+        else if (option == "--no-openmp") {
+            options.useOpenMP = false;
+        }
+        else if (option == "--show") {
+            options.showImage = true;
+        }
+        else if (option == "--save") {
+            options.saveImage = true;
+        }
+        else if (option == "--cache-mb") {
+            options.cacheMemoryBudget = static_cast<size_t>(ParseInt(option, nextValue(), 0)) * 1024 * 1024;
+        }
+        else if (option == "--pool-mb") {
+            options.poolMemoryLimit = static_cast<size_t>(ParseInt(option, nextValue(), 0)) * 1024 * 1024;
+        }
+        else if (option == "--numa") {
+            options.numa = true;
+        }
+        else if (option == "--in-memory") {
+            options.inMemory = true;
+        }
+        else if (option == "--lookup-tables") {
+            options.lookupTables = true;
+        }
+        else if (option == "--single-channel-gray") {
+            options.singleChannelGray = true;
+        }
+        else if (option == "--schedule") {
+            std::string value = nextValue();
+            options.tuneSchedule = value == "auto";
+            hasSchedule = true;
+            if (!options.tuneSchedule) options.schedule.policy = TileScheduler::ParsePolicy(value);
+        }
+        else if (option == "--tile-rows") {
+            options.schedule.tileRows = ParseInt(option, nextValue(), 0);
+        }
+        else if (option == "--tile-cols") {
+            options.schedule.tileCols = ParseInt(option, nextValue(), 0);
+        }
+        else if (option == "--tuning-cache") {
+            options.tuningCachePath = nextValue();
+        }
+        else if (option == "--stream-rows") {
+            options.streamStripRows = ParseInt(option, nextValue(), 1);
+        }
+        else if (option == "--batch-workers") {
+            std::vector<std::string> workers = SplitList(nextValue());
+            if (workers.size() != 3)
+                throw std::invalid_argument("The value of " + option + " has to be three worker counts!");
+            options.batchDecodeWorkers = ParseInt(option, workers[0], 1);
+            options.batchFilterWorkers = ParseInt(option, workers[1], 1);
+            options.batchEncodeWorkers = ParseInt(option, workers[2], 1);
+        }
+        else if (option == "--batch-queue") {
+            options.batchQueueCapacity = ParseInt(option, nextValue(), 1);
+        }
+        else if (option == "--batch-mb") {
+            options.batchMemoryBudget = static_cast<size_t>(ParseInt(option, nextValue(), 0)) * 1024 * 1024;
+        }
+        else if (option == "--video-buffers") {
+            options.videoFrameBuffers = ParseInt(option, nextValue(), 2);
+        }
+        else if (option == "--video-max-latency") {
+            options.videoMaxLatency = ParseInt(option, nextValue(), 0);
+        }
+        else if (option == "--video-tiles") {
+            options.videoTileSize = ParseInt(option, nextValue(), 0);
+        }
+        else if (option == "--mpi-strips") {
+            options.mpiStripCount = ParseInt(option, nextValue(), 1);
+        }
+        else if (option == "--mpi-chunk-rows") {
+            options.mpiChunkRows = ParseInt(option, nextValue(), 1);
+        }
+        else if (option == "--mpi-shared-memory") {
+            options.mpiSharedMemory = true;
+        }
+        else if (option == "--mpi-balance") {
+            options.mpiBalanceLoad = true;
+        }
+        else {
+            throw std::invalid_argument("The option " + option + " is unknown!");
+        }
+    }
+
+    // the rows are placed on the nodes of the threads that filter them with a static schedule
+    if (options.numa && !hasSchedule)
+        options.schedule.policy = SchedulePolicy::Static;
+
+    if (!options.showHelp && options.kernelBaselinePath.empty() && options.inputs.empty())
+        throw std::invalid_argument("At least one input has to be given!");
+    if (!options.convertPath.empty() && options.inputs.size() != 1)
+        throw std::invalid_argument("Exactly one input has to be given to be converted!");
+
+    return options;
+}
+
+std::string BenchmarkOptions::GetUsage(const std::string& programName)
+{
+    return "Usage: " + programName + " [options] <input>...\n"
+        "Benchmarks the filters on every input, which is an image or, in the batch modes, a directory of images or\n"
+        "a file listing their paths, and in the video mode a video or an image sequence like frame_%04d.png. The\n"
+        "stream mode reads raw and PPM images in strips. Lists are comma separated, all combinations of their values\n"
+        "are benchmarked.\n"
+        "\n"
+        "  --mode LIST            simple, opencv, stream, batch, video, mpi, mpi-single-loop, mpi-pipelined,\n"
+        "                         mpi-dynamic, mpi-batch\n"
+        "                         (default: simple)\n"
+        "  --filters LIST         the filter chain in order, of hsv, gray and emboss (default: hsv,gray,emboss)\n"
+        "  --collapsed no|yes|both  use the collapsed variants of the filters (default: no)\n"
+        "  --fuse no|yes|both     fuse the filters into a single sweep (default: yes)\n"
+        "  --threads LIST         thread counts, e.g. 1,2,4 or 1-8 (default: number of processors)\n"
+        "  --backend LIST         threading backends of the filters: openmp, pool (work-stealing std::thread pool),\n"
+        "                         opencv (cv::parallel_for_) and std (C++17 parallel algorithms) (default: openmp)\n"
+        "  --input PATH           adds an input, same as a positional argument\n"
+        "  --repetitions N        measured repetitions per configuration (default: 100)\n"
+        "  --warmup N             unmeasured repetitions per configuration (default: 3)\n"
+        "  --output DIR           directory of the saved images (default: .)\n"
+        "  --output-format EXT    format of the saved images, e.g. png, ppm or raw for mapped raw images (default: png)\n"
+        "  --convert FILE         converts the input to FILE instead of benchmarking, e.g. from png to raw or back\n"
+        "  --kernel-benchmark FILE  checks every kernel against golden references and OpenCV on synthetic images instead\n"
+        "                         of benchmarking inputs, and compares its throughput with the baseline in FILE\n"
+        "  --kernel-threshold PCT  drop of the throughput below the baseline that fails the kernel benchmark (default: 10)\n"
+        "  --update-baseline      replace the throughputs of the kernel baseline instead of comparing with them\n"
+        "  --results FILE         saves the results as CSV, or as JSON if FILE ends with .json\n"
+        "  --trace FILE           records the filters, the threads of every parallel loop, the MPI waits and, on Linux,\n"
+        "                         hardware counters as a Chrome trace (chrome://tracing, Perfetto) and prints totals\n"
+        "  --no-openmp            filter on a single thread, with every backend\n"
+        "  --show                 show the resulting images\n"
+        "  --save                 save the resulting images\n"
+        "  --cache-mb N           memory budget of the decoded image cache in MiB, 0 disables it (default: 1024)\n"
+        "  --pool-mb N            memory limit of the pool of reused image buffers in MiB, 0 disables it (default: 1024)\n"
+        "  --numa                 pin the OpenMP threads, place the rows of new images on the nodes of the threads\n"
+        "                         that filter them and print the memory bandwidth of every node (schedule: static)\n"
+        "  --in-memory            decode every image once before its benchmark, so that no repetition decodes it\n"
+        "  --lookup-tables        filter grayscale and hsv with lookup tables instead of computing every pixel\n"
+        "  --single-channel-gray  grayscale outputs single-channel images, so that the following filters and the\n"
+        "                         gather move a third of the bytes, in the simple, batch, mpi and mpi-batch modes\n"
+        "  --schedule POLICY      distribution of the tiles between the threads: static, dynamic, guided, stealing,\n"
+        "                         or auto to tune tiles and policy for every configuration (default: dynamic)\n"
+        "  --tile-rows N          rows per tile, 0 keeps the default of every filter (default: 0)\n"
+        "  --tile-cols N          columns per tile of filters without stencils, 0 for whole rows (default: 0)\n"
+        "  --tuning-cache FILE    tuned schedules of earlier runs, which are reused (default: tuning_cache.txt)\n"
+        "  --stream-rows N        rows per strip of the stream mode (default: 256)\n"
+        "  --batch-workers D,F,E  decode, filter and encode threads of the batch mode (default: 2,1,2)\n"
+        "  --batch-queue N        images waiting between two stages of the batch mode (default: 4)\n"
+        "  --batch-mb N           decoded images in flight in the batch mode in MiB, at least one image (default: 512)\n"
+        "  --video-buffers N      frame buffers shared by capture, filters and writer of the video mode (default: 3)\n"
+        "  --video-max-latency MS  drop frames that waited longer before being filtered, 0 never drops (default: 0)\n"
+        "  --video-tiles N        only filter the N x N pixel tiles that changed since the previous frame, 0 filters\n"
+        "                         whole frames (default: 0)\n"
+        "  --mpi-strips N         strips per process of the mpi-pipelined mode (default: 4)\n"
+        "  --mpi-chunk-rows N     rows per chunk of the mpi-dynamic mode (default: 64)\n"
+        "  --mpi-shared-memory    share the rows of processes on the same node in the mpi mode\n"
+        "  --mpi-balance          balance the rows by the measured throughput in the mpi and mpi-single-loop modes\n"
+        "  --help                 show this help\n";
+}
+
+std::string BenchmarkOptions::GetModeName(BenchmarkMode mode)
+{
+    switch (mode) {
+    case BenchmarkMode::Simple:
+        return "simple";
+    case BenchmarkMode::OpenCV:
+        return "opencv";
+    case BenchmarkMode::Stream:
+        return "stream";
+    case BenchmarkMode::Batch:
+        return "batch";
+    case BenchmarkMode::Video:
+        return "video";
+    case BenchmarkMode::MPI:
+        return "mpi";
+    case BenchmarkMode::MPISingleLoop:
+        return "mpi-single-loop";
+    case BenchmarkMode::MPIPipelined:
+        return "mpi-pipelined";
+    case BenchmarkMode::MPIDynamic:
+        return "mpi-dynamic";
+    case BenchmarkMode::MPIBatch:
+        return "mpi-batch";
+    }
+    return "unknown";
+}
+
+bool BenchmarkOptions::IsMPIMode(BenchmarkMode mode)
+{
+    return mode != BenchmarkMode::Simple && mode != BenchmarkMode::OpenCV && mode != BenchmarkMode::Stream
+        && mode != BenchmarkMode::Batch && mode != BenchmarkMode::Video;
+}
+
+bool BenchmarkOptions::UsesFilterMethods(BenchmarkMode mode)
+{
+    return mode != BenchmarkMode::OpenCV && mode != BenchmarkMode::MPISingleLoop;
+}
+
+bool BenchmarkOptions::SupportsSingleChannel(BenchmarkMode mode)
+{
+    return mode == BenchmarkMode::Simple || mode == BenchmarkMode::Batch || mode == BenchmarkMode::MPI
+        || mode == BenchmarkMode::MPIBatch;
+}
+
+bool BenchmarkOptions::UsesMPI() const
+{
+    return std::any_of(modes.begin(), modes.end(), IsMPIMode);
+}
+
+std::vector<BenchmarkConfiguration> BenchmarkOptions::GetConfigurations() const
+{
+    std::vector<int> threadCounts = threads;
+    if (threadCounts.empty()) threadCounts.push_back(omp_get_num_procs());
+
+    std::vector<BenchmarkConfiguration> configurations;
+    auto add = [&](const BenchmarkConfiguration& configuration) {
+        auto equal = [&](const BenchmarkConfiguration& other) {
+            return other.mode == configuration.mode && other.input == configuration.input
+                && other.threads == configuration.threads && other.collapsed == configuration.collapsed
+                && other.fused == configuration.fused && other.backend == configuration.backend;
+        };
+        if (std::none_of(configurations.begin(), configurations.end(), equal))
+            configurations.push_back(configuration);
+    };
+
+    for (BenchmarkMode mode : modes) {
+        for (const auto& input : inputs) {
+            for (int threadCount : threadCounts) {
+                if (!UsesFilterMethods(mode)) {
+                    add({ mode, input, threadCount, false, false });
+                    continue;
+                }
+
+                for (bool isCollapsed : collapsed) {
+                    for (bool isFused : fused) {
+                        for (ParallelBackend backend : backends) {
+                            add({ mode, input, threadCount, isCollapsed, isFused && !isCollapsed, backend });
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return configurations;
+}
+
+std::vector<BenchmarkOptions::FilterMethod> BenchmarkOptions::GetFilterMethods(bool collapsed, bool fused, bool singleChannelGray) const
+{
+    std::vector<FilterMethod> filterMethods;
+    for (const auto& filter : filters) {
+        if (filter == "hsv")
+            filterMethods.push_back(collapsed ? &ImageFilter::HSVImageCollapsed : &ImageFilter::HSVImage);
+        else if (filter == "gray" && singleChannelGray && !collapsed)
+            filterMethods.push_back(&ImageFilter::GrayscaleImageSingleChannel);
+        else if (filter == "gray")
+            filterMethods.push_back(collapsed ? &ImageFilter::GrayscaleImageCollapsed : &ImageFilter::GrayscaleImage);
+        else if (filter == "emboss")
+            filterMethods.push_back(collapsed ? &ImageFilter::EmbossImageCollapsed : &ImageFilter::EmbossImage);
+    }
+
+    // fuse the filter methods into a single sweep over the image
+    if (fused)
+        filterMethods = { FilterPipeline::FromFilterMethods(filterMethods) };
+
+    return filterMethods;
+}
+
+std::vector<BenchmarkOptions::FilterMethod> BenchmarkOptions::GetFilterMethods(const BenchmarkConfiguration& configuration) const
+{
+    // modes that preallocate their images for the layout of the input keep three channels after grayscale
+    return GetFilterMethods(configuration.collapsed, configuration.fused,
+        singleChannelGray && SupportsSingleChannel(configuration.mode));
+}
+
+bool BenchmarkOptions::HasFilter(const std::string& filter) const
+{
+    return std::find(filters.begin(), filters.end(), filter) != filters.end();
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "TileScheduler.h"
+
+/// <summary>
+/// The implementations of the filters that can be benchmarked.
+/// </summary>
+enum class BenchmarkMode
+{
+    Simple,
+    OpenCV,
+    Stream,
+    Batch,
+    Video,
+    MPI,
+    MPISingleLoop,
+    MPIPipelined,
+    MPIDynamic,
+    MPIBatch,
+};
+
+/// <summary>
+/// A single point of the benchmark matrix.
+/// </summary>
+struct BenchmarkConfiguration
+{
+    BenchmarkMode mode;
+    std::string input;
+    int threads;
+    bool collapsed;
+    bool fused;
+    ParallelBackend backend = ParallelBackend::OpenMP;
+
+    /// <summary>
+    /// Returns the name of the configuration, under which its results are printed and saved. The results files keep
+    /// the input in a field of its own, since paths may contain separators and quotes.
+    /// </summary>
+    /// <param name="withInput">Wether the name ends with the input</param>
+    /// <returns></returns>
+    std::string GetName(bool withInput = true) const;
+};
+
+/// <summary>
+/// Options of the benchmark driver, which are read from the command line. Options that take a list of values, like
+/// the modes, thread counts and inputs, span a matrix whose points are all benchmarked in one run.
+/// </summary>
+class BenchmarkOptions
+{
+public:
+    typedef std::function<void(cv::Mat&, bool)> FilterMethod;
+
+    std::vector<BenchmarkMode> modes = { BenchmarkMode::Simple };
+    std::vector<std::string> filters = { "hsv", "gray", "emboss" };
+    std::vector<bool> collapsed = { false };
+    std::vector<bool> fused = { true };
+    std::vector<int> threads;
+    std::vector<ParallelBackend> backends = { ParallelBackend::OpenMP };
+    std::vector<std::string> inputs;
+    std::string outputDir = ".";
+    std::string resultsPath;
+    std::string tracePath;
+    std::string outputFormat = "png";
+    std::string convertPath;
+    std::string kernelBaselinePath;
+    double kernelThreshold = 0.1;
+    bool updateKernelBaseline = false;
+    int repetitions = 100;
+    int warmupRepetitions = 3;
+    bool useOpenMP = true;
+    bool showImage = false;
+    bool saveImage = false;
+    bool showHelp = false;
+    size_t cacheMemoryBudget = size_t(1024) * 1024 * 1024;
+    size_t poolMemoryLimit = size_t(1024) * 1024 * 1024;
+    bool numa = false;
+    bool inMemory = false;
+    bool lookupTables = false;
+    bool singleChannelGray = false;
+    TileSchedule schedule;
+    bool tuneSchedule = false;
+    std::string tuningCachePath = "tuning_cache.txt";
+
+    int streamStripRows = 256;
+    int batchDecodeWorkers = 2;
+    int batchFilterWorkers = 1;
+    int batchEncodeWorkers = 2;
+    int batchQueueCapacity = 4;
+    size_t batchMemoryBudget = size_t(512) * 1024 * 1024;
+    int videoFrameBuffers = 3;
+    int videoMaxLatency = 0;
+    int videoTileSize = 0;
+    int mpiStripCount = 4;
+    int mpiChunkRows = 64;
+    bool mpiSharedMemory = false;
+    bool mpiBalanceLoad = false;
+
+    /// <summary>
+    /// Reads the options from the command line arguments.
+    /// Throws an invalid_argument exception for unknown options and invalid values.
+    /// </summary>
+    /// <param name="argc"></param>
+    /// <param name="argv"></param>
+    /// <returns></returns>
+    static BenchmarkOptions Parse(int argc, char** argv);
+
+    /// <summary>
+    /// Returns the description of all options.
+    /// </summary>
+    /// <param name="programName">The name the program was called with</param>
+    /// <returns></returns>
+    static std::string GetUsage(const std::string& programName);
+
+    /// <summary>
+    /// Returns the name of a mode as it is given on the command line.
+    /// </summary>
+    /// <param name="mode"></param>
+    /// <returns></returns>
+    static std::string GetModeName(BenchmarkMode mode);
+
+    /// <summary>
+    /// Returns wether a mode runs on all MPI processes.
+    /// </summary>
+    /// <param name="mode"></param>
+    /// <returns></returns>
+    static bool IsMPIMode(BenchmarkMode mode);
+
+    /// <summary>
+    /// Returns wether a mode applies the filter methods of the chain, instead of its own filters in a fixed order.
+    /// Only these modes can use the collapsed and fused filters.
+    /// </summary>
+    /// <param name="mode"></param>
+    /// <returns></returns>
+    static bool UsesFilterMethods(BenchmarkMode mode);
+
+    /// <summary>
+    /// Returns wether a mode can filter single-channel gray images, which requires the images to be allocated by the
+    /// filters instead of being preallocated for the layout of the input.
+    /// </summary>
+    /// <param name="mode"></param>
+    /// <returns></returns>
+    static bool SupportsSingleChannel(BenchmarkMode mode);
+
+    /// <summary>
+    /// Returns wether any of the modes needs MPI to be initialized.
+    /// </summary>
+    /// <returns></returns>
+    bool UsesMPI() const;
+
+    /// <summary>
+    /// Returns all points of the benchmark matrix. Collapsed filters are never fused, since the pipeline would
+    /// replace them with its own kernels, and modes with their own filters only depend on the mode, input and threads.
+    /// </summary>
+    /// <returns></returns>
+    std::vector<BenchmarkConfiguration> GetConfigurations() const;
+
+    /// <summary>
+    /// Returns the filter methods of the filter chain.
+    /// </summary>
+    /// <param name="collapsed">Wether to use the collapsed variants of the filters</param>
+    /// <param name="fused">Wether to fuse the filters into a pipeline</param>
+    /// <param name="singleChannelGray">Wether the grayscale filter outputs single-channel images, which has no
+    /// collapsed variant</param>
+    /// <returns></returns>
+    std::vector<FilterMethod> GetFilterMethods(bool collapsed, bool fused, bool singleChannelGray = false) const;
+
+    /// <summary>
+    /// Returns the filter methods of the filter chain in a configuration, whose grayscale filter outputs
+    /// single-channel images if they are enabled and supported by the mode.
+    /// </summary>
+    /// <param name="configuration"></param>
+    /// <returns></returns>
+    std::vector<FilterMethod> GetFilterMethods(const BenchmarkConfiguration& configuration) const;
+
+    /// <summary>
+    /// Returns wether the filter chain contains a filter.
+    /// </summary>
+    /// <param name="filter">The name of the filter, one of hsv, gray and emboss</param>
+    /// <returns></returns>
+    bool HasFilter(const std::string& filter) const;
+};
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+
+/// <summary>
+/// Bounded lock-free queue for multiple producers and consumers. Every slot carries a sequence number that tells
+/// producers and consumers in which round the slot can be written or read, so pushing and popping only take a
+/// compare and swap on the position and never a lock. A full queue makes producers wait, which passes the
+/// backpressure of a slow consumer up to its producers. Waiting threads sleep on a condition variable, so that idle
+/// stages leave the cores to the busy ones, and are only woken if a thread waits. Once the queue is closed, consumers
+/// drain the remaining values and then stop.
+/// </summary>
+/// <typeparam name="T">The type of the values, which has to be default constructible and movable</typeparam>
+template <typename T>
+class BoundedQueue
+{
+public:
+    /// <summary>
+    /// Creates an empty queue.
+    /// </summary>
+    /// <param name="capacity">The maximum number of values in the queue, rounded up to a power of two of at least two,
+    /// since a single slot could not tell a written from a read value by its sequence number</param>
+    explicit BoundedQueue(size_t capacity)
+    {
+        if (capacity < 1)
+            throw std::invalid_argument("The capacity of a queue has to be at least one!");
+
+        size_t slotCount = 2;
+        while (slotCount < capacity) slotCount *= 2;
+        mask = slotCount - 1;
+        slots = std::make_unique<Slot[]>(slotCount);
+        for (size_t i = 0; i < slotCount; i++) slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    /// <summary>
+    /// Adds a value to the queue if it is not full.
+    /// </summary>
+    /// <param name="value">The value, which is only moved from if it was added</param>
+    /// <returns>Wether the value was added</returns>
+    bool TryPush(T& value)
+    {
+        size_t position = pushPosition.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = slots[position & mask];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+            if (difference == 0) {
+                if (pushPosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    slot.value = std::move(value);
+                    slot.sequence.store(position + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0) {
+                // the slot still holds the value of the previous round
+                return false;
+            }
+            else {
+                position = pushPosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /// <summary>
+    /// Removes the oldest value from the queue if it is not empty.
+    /// </summary>
+    /// <param name="value">Receives the value</param>
+    /// <returns>Wether a value was removed</returns>
+    bool TryPop(T& value)
+    {
+        size_t position = popPosition.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = slots[position & mask];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position + 1);
+            if (difference == 0) {
+                if (popPosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    value = std::move(slot.value);
+                    slot.value = T();
+                    slot.sequence.store(position + mask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0) {
+                // the slot has not been written in this round yet
+                return false;
+            }
+            else {
+                position = popPosition.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /// <summary>
+    /// Adds a value to the queue, waiting while it is full.
+    /// </summary>
+    /// <param name="value"></param>
+    void Push(T value)
+    {
+        if (!TryPush(value)) {
+            std::unique_lock<std::mutex> lock(waitMutex);
+            waitingProducers++;
+            notFull.wait(lock, [&]() { return TryPush(value); });
+            waitingProducers--;
+        }
+        Wake(notEmpty, waitingConsumers);
+    }
+
+    /// <summary>
+    /// Removes the oldest value from the queue, waiting while it is empty and not closed.
+    /// </summary>
+    /// <param name="value">Receives the value</param>
+    /// <returns>Wether a value was removed, false once the queue is closed and empty</returns>
+    bool Pop(T& value)
+    {
+        bool popped = TryPop(value);
+        if (!popped) {
+            std::unique_lock<std::mutex> lock(waitMutex);
+            waitingConsumers++;
+            notEmpty.wait(lock, [&]() {
+                popped = TryPop(value);
+                if (popped || !closed.load(std::memory_order_acquire)) return popped;
+                // values pushed before the queue was closed are still popped
+                popped = TryPop(value);
+                return true;
+            });
+            waitingConsumers--;
+        }
+        if (popped) Wake(notFull, waitingProducers);
+        return popped;
+    }
+
+    /// <summary>
+    /// Marks that no more values are pushed, so that waiting consumers stop once the queue is empty.
+    /// </summary>
+    void Close()
+    {
+        closed.store(true, std::memory_order_release);
+        std::lock_guard<std::mutex> lock(waitMutex);
+        notEmpty.notify_all();
+    }
+
+private:
+    /// <summary>
+    /// Wakes a thread waiting for the push or pop that the calling thread just completed, if any thread waits.
+    /// </summary>
+    void Wake(std::condition_variable& condition, const std::atomic<int>& waitingThreads)
+    {
+        // the fence orders the push or pop before reading the waiting threads, which count themselves under the lock
+        // before they try again, so either the waiting thread sees the change or this thread sees the waiting thread
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waitingThreads.load(std::memory_order_relaxed) == 0) return;
+        std::lock_guard<std::mutex> lock(waitMutex);
+        condition.notify_one();
+    }
+
+    struct Slot
+    {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    // the positions are written by different threads and kept on separate cache lines
+    std::unique_ptr<Slot[]> slots;
+    size_t mask = 0;
+    alignas(64) std::atomic<size_t> pushPosition{ 0 };
+    alignas(64) std::atomic<size_t> popPosition{ 0 };
+    alignas(64) std::atomic<bool> closed{ false };
+    std::atomic<int> waitingProducers{ 0 };
+    std::atomic<int> waitingConsumers{ 0 };
+    std::mutex waitMutex;
+    std::condition_variable notFull;
+    std::condition_variable notEmpty;
+};
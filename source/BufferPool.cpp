@@ -0,0 +1,186 @@
+#include "BufferPool.h"
+#include <algorithm>
+#include "NumaPlacement.h"
+
+BufferPool::BufferPool(size_t memoryLimit)
+    : memoryLimit(memoryLimit)
+{
+}
+
+BufferPool& BufferPool::GetShared()
+{
+    static BufferPool* sharedPool = new BufferPool();
+    return *sharedPool;
+}
+
+void BufferPool::Install(size_t memoryLimit, bool firstTouch)
+{
+    BufferPool& pool = GetShared();
+    pool.SetMemoryLimit(memoryLimit);
+    pool.firstTouch = firstTouch;
+    pool.firstTouchThread = std::this_thread::get_id();
+    // images allocated by the pool before keep it as their allocator, so they are still released to it
+    cv::Mat::setDefaultAllocator((memoryLimit > 0 || firstTouch) ? &pool : nullptr);
+}
+
+void BufferPool::SetMemoryLimit(size_t memoryLimit)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    this->memoryLimit = memoryLimit;
+    Evict(memoryLimit);
+}
+
+void BufferPool::Clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Evict(0);
+}
+
+void BufferPool::ResetStatistics()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    hits = 0;
+    misses = 0;
+    evictions = 0;
+    peakMemoryUsage = memoryUsage;
+}
+
+size_t BufferPool::GetMemoryLimit() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return memoryLimit;
+}
+
+size_t BufferPool::GetMemoryUsage() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return memoryUsage;
+}
+
+size_t BufferPool::GetPeakMemoryUsage() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return peakMemoryUsage;
+}
+
+size_t BufferPool::GetHits() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return hits;
+}
+
+size_t BufferPool::GetMisses() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return misses;
+}
+
+size_t BufferPool::GetEvictions() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return evictions;
+}
+
+cv::UMatData* BufferPool::allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+    cv::AccessFlag /*flags*/, cv::UMatUsageFlags /*usageFlags*/) const
+{
+    // the steps are computed like the standard allocator of OpenCV does, keeping the steps of external data
+    size_t bytes = CV_ELEM_SIZE(type);
+    for (int i = dims - 1; i >= 0; i--) {
+        if (step) {
+            if (data && step[i] != CV_AUTOSTEP) {
+                CV_Assert(bytes <= step[i]);
+                bytes = step[i];
+            }
+            else {
+                step[i] = bytes;
+            }
+        }
+        bytes *= sizes[i];
+    }
+
+    cv::UMatData* u = new cv::UMatData(this);
+    u->size = bytes;
+    if (data) {
+        u->data = u->origdata = static_cast<uchar*>(data);
+        u->flags |= cv::UMatData::USER_ALLOCATED;
+        return u;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (bytes >= MinimumPooledBytes && bytes <= memoryLimit) {
+            // pooled buffers remember their type in the allocator flags, 0 marks buffers outside of the pool
+            u->allocatorFlags_ = type + 1;
+            auto buffers = index.find({ bytes, type });
+            if (buffers != index.end()) {
+                hits++;
+                auto buffer = buffers->second.back();
+                u->data = u->origdata = buffer->data;
+                releasedBuffers.erase(buffer);
+                buffers->second.pop_back();
+                if (buffers->second.empty()) index.erase(buffers);
+                return u;
+            }
+
+            misses++;
+            Evict(memoryLimit - bytes);
+            memoryUsage += bytes;
+            peakMemoryUsage = std::max(peakMemoryUsage, memoryUsage);
+        }
+    }
+
+    // the buffer is allocated without holding the lock, so that other threads can use the pool in the meantime
+    u->data = u->origdata = static_cast<uchar*>(cv::fastMalloc(bytes));
+    if (firstTouch && bytes >= MinimumPooledBytes && std::this_thread::get_id() == firstTouchThread)
+        NumaPlacement::FirstTouch(u->data, bytes);
+    return u;
+}
+
+bool BufferPool::allocate(cv::UMatData* data, cv::AccessFlag /*accessFlags*/, cv::UMatUsageFlags /*usageFlags*/) const
+{
+    return data != nullptr;
+}
+
+void BufferPool::deallocate(cv::UMatData* u) const
+{
+    if (!u) return;
+    CV_Assert(u->urefcount == 0);
+    CV_Assert(u->refcount == 0);
+
+    if (!(u->flags & cv::UMatData::USER_ALLOCATED)) {
+        bool released = false;
+        if (u->allocatorFlags_ != 0) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (u->size <= memoryLimit) {
+                BufferKey key = { u->size, u->allocatorFlags_ - 1 };
+                releasedBuffers.push_front({ key, u->origdata });
+                index[key].push_back(releasedBuffers.begin());
+                released = true;
+                Evict(memoryLimit);
+            }
+            else {
+                memoryUsage -= u->size;
+            }
+        }
+        if (!released) cv::fastFree(u->origdata);
+        u->origdata = nullptr;
+    }
+    delete u;
+}
+
+void BufferPool::Evict(size_t memoryLimit) const
+{
+    while (memoryUsage > memoryLimit && !releasedBuffers.empty()) {
+        const ReleasedBuffer& buffer = releasedBuffers.back();
+        auto buffers = index.find(buffer.key);
+        auto& iterators = buffers->second;
+        iterators.erase(std::find(iterators.begin(), iterators.end(), std::prev(releasedBuffers.end())));
+        if (iterators.empty()) index.erase(buffers);
+
+        cv::fastFree(buffer.data);
+        memoryUsage -= buffer.key.first;
+        evictions++;
+        releasedBuffers.pop_back();
+    }
+}
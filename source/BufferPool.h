@@ -0,0 +1,105 @@
+#pragma once
+
+#include <list>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+/// <summary>
+/// Allocator of the pixel buffers of OpenCV images that keeps released buffers and hands them out again for images
+/// of the same size and type. Large buffers are otherwise mapped and unmapped by the C library on every allocation,
+/// so that every repetition of a benchmark faults in the pages of its input, scratch and output images again.
+/// The pool holds at most its memory limit in buffers that are in use or released; released buffers are freed,
+/// least recently released first, as soon as a buffer would exceed the limit. Buffers in use are never taken away,
+/// so the limit can be exceeded by the images in use, buffers larger than the whole limit are not pooled at all.
+/// </summary>
+class BufferPool : public cv::MatAllocator
+{
+public:
+    /// <summary>
+    /// Creates an empty pool.
+    /// </summary>
+    /// <param name="memoryLimit">The maximum number of bytes of all buffers of the pool, 0 disables pooling</param>
+    explicit BufferPool(size_t memoryLimit = 0);
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    /// <summary>
+    /// Returns the pool that is shared by all images of the process. It is never destroyed, since images may still
+    /// be released while static objects are destroyed.
+    /// </summary>
+    /// <returns></returns>
+    static BufferPool& GetShared();
+
+    /// <summary>
+    /// Sets the memory limit of the shared pool and makes it the default allocator of all images, including the
+    /// images decoded by OpenCV, or restores the standard allocator if the limit is 0 and no pages are touched.
+    /// Has to be called before filtering, while no other thread allocates images.
+    /// </summary>
+    /// <param name="memoryLimit">The maximum number of bytes of all buffers of the pool, 0 disables pooling</param>
+    /// <param name="firstTouch">Wether new buffers of the calling thread are first touched by its OpenMP threads, see NumaPlacement::FirstTouch</param>
+    static void Install(size_t memoryLimit, bool firstTouch = false);
+
+    /// <summary>
+    /// Sets the maximum number of bytes of all buffers and frees released buffers until they fit.
+    /// </summary>
+    /// <param name="memoryLimit">The maximum number of bytes, 0 disables pooling</param>
+    void SetMemoryLimit(size_t memoryLimit);
+
+    /// <summary>
+    /// Frees all released buffers.
+    /// </summary>
+    void Clear();
+
+    /// <summary>
+    /// Resets the hits, misses and evictions and lowers the peak memory usage to the current memory usage.
+    /// </summary>
+    void ResetStatistics();
+
+    size_t GetMemoryLimit() const;
+    size_t GetMemoryUsage() const;
+    size_t GetPeakMemoryUsage() const;
+    size_t GetHits() const;
+    size_t GetMisses() const;
+    size_t GetEvictions() const;
+
+    cv::UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step, cv::AccessFlag flags,
+        cv::UMatUsageFlags usageFlags) const override;
+    bool allocate(cv::UMatData* data, cv::AccessFlag accessFlags, cv::UMatUsageFlags usageFlags) const override;
+    void deallocate(cv::UMatData* data) const override;
+
+    /// <summary>
+    /// Buffers below this size are allocated and freed directly, since the C library keeps them in its heap anyway.
+    /// </summary>
+    static constexpr size_t MinimumPooledBytes = 64 * 1024;
+
+private:
+    // buffers are keyed by their number of bytes and the type of their images
+    typedef std::pair<size_t, int> BufferKey;
+
+    struct ReleasedBuffer
+    {
+        BufferKey key;
+        uchar* data;
+    };
+
+    // the released buffers are ordered from the most to the least recently released
+    mutable std::list<ReleasedBuffer> releasedBuffers;
+    mutable std::map<BufferKey, std::vector<std::list<ReleasedBuffer>::iterator>> index;
+    size_t memoryLimit;
+    // buffers of other threads, e.g. the decoders of the batch mode, are first touched by the thread itself
+    bool firstTouch = false;
+    std::thread::id firstTouchThread;
+    mutable size_t memoryUsage = 0;
+    mutable size_t peakMemoryUsage = 0;
+    mutable size_t hits = 0;
+    mutable size_t misses = 0;
+    mutable size_t evictions = 0;
+    mutable std::mutex mutex;
+
+    void Evict(size_t memoryLimit) const;
+};
@@ -0,0 +1,379 @@
+#include "FilterPipeline.h"
+#include "ImageFilter.h"
+#include "TileScheduler.h"
+
+typedef void (*FilterFunction)(cv::Mat&, bool);
+
+/// <summary>
+/// A single filter of a fused sweep, which is either a pointwise or a stencil row kernel, with the number of channels
+/// of the rows it reads and writes.
+/// </summary>
+struct FusedOperation
+{
+    PointRowKernel point;
+    StencilRowKernel stencil;
+    int inputChannels;
+    int outputChannels;
+};
+
+/// <summary>
+/// Rolling window of a stencil filter. The input row is kept as the previous row for the next row of the sweep.
+/// </summary>
+struct StencilWindow
+{
+    uchar* previous;
+    uchar* input;
+    uchar* output;
+    bool hasPrevious;
+};
+
+/// <summary>
+/// Runs a single row through all operations of a fused sweep. The last operation writes to outputRow,
+/// unless outputRow is nullptr for rows that are only needed to fill the stencil windows.
+/// </summary>
+static void FilterFusedRow(const std::vector<FusedOperation>& operations, std::vector<StencilWindow>& windows,
+    uchar* const workRows[2], const uchar* inputRow, uchar* outputRow, int cols)
+{
+    const uchar* src = inputRow;
+    uchar* current = nullptr;
+    size_t stencil = 0;
+
+    for (size_t i = 0; i < operations.size(); i++) {
+        const FusedOperation& operation = operations[i];
+        bool last = i + 1 == operations.size();
+        size_t nextStencil = operation.stencil ? stencil + 1 : stencil;
+
+        // write directly to where the next operation reads from, so that rows are only copied if unavoidable
+        uchar* dst;
+        if (last && outputRow != nullptr)
+            dst = outputRow;
+        else if (!last && operations[i + 1].stencil)
+            dst = windows[nextStencil].input;
+        else if (operation.stencil)
+            dst = windows[stencil].output;
+        else
+            dst = current != nullptr ? current : workRows[0];
+
+        // expanding single-channel rows overwrites pixels before they are read, so they are expanded into the other row
+        if (operation.outputChannels > operation.inputChannels && dst == src)
+            dst = (dst == workRows[0]) ? workRows[1] : workRows[0];
+
+        if (operation.point) {
+            operation.point(src, dst, cols);
+        }
+        else {
+            StencilWindow& window = windows[stencil];
+            if (src != window.input) memcpy(window.input, src, static_cast<size_t>(cols) * operation.inputChannels);
+            operation.stencil(window.hasPrevious ? window.previous : nullptr, window.input, dst, cols);
+            std::swap(window.previous, window.input);
+            window.hasPrevious = true;
+        }
+
+        src = dst;
+        current = dst;
+        stencil = nextStencil;
+    }
+}
+
+FilterPipeline FilterPipeline::FromFilterMethods(const std::vector<FilterMethod>& filterMethods)
+{
+    FilterPipeline pipeline;
+    for (const auto& filter : filterMethods) {
+        pipeline.Add(filter);
+    }
+    return pipeline;
+}
+
+std::string FilterPipeline::GetFilterName(const FilterMethod& filterMethod)
+{
+    FilterPipeline pipeline = FromFilterMethods({ filterMethod });
+    return pipeline.GetStageNames(0, pipeline.stages.size());
+}
+
+std::string FilterPipeline::GetStageNames(size_t begin, size_t end) const
+{
+    std::string name;
+    for (size_t i = begin; i < end; i++) {
+        if (!name.empty()) name += "+";
+        switch (stages[i].type) {
+        case StageType::Grayscale:
+            name += "Grayscale";
+            break;
+        case StageType::GrayscaleSingleChannel:
+            name += "GrayscaleSingleChannel";
+            break;
+        case StageType::HSV:
+            name += "HSV";
+            break;
+        case StageType::Emboss:
+            name += "Emboss";
+            break;
+        default:
+            name += "Custom";
+            break;
+        }
+    }
+    return name;
+}
+
+FilterPipeline& FilterPipeline::AddGrayscale()
+{
+    stages.push_back({ StageType::Grayscale, &ImageFilter::GrayscaleImage });
+    return *this;
+}
+
+FilterPipeline& FilterPipeline::AddGrayscaleSingleChannel()
+{
+    stages.push_back({ StageType::GrayscaleSingleChannel, &ImageFilter::GrayscaleImageSingleChannel });
+    return *this;
+}
+
+FilterPipeline& FilterPipeline::AddHSV()
+{
+    stages.push_back({ StageType::HSV, &ImageFilter::HSVImage });
+    return *this;
+}
+
+FilterPipeline& FilterPipeline::AddEmboss()
+{
+    stages.push_back({ StageType::Emboss, &ImageFilter::EmbossImage });
+    return *this;
+}
+
+FilterPipeline& FilterPipeline::Add(const FilterMethod& filterMethod)
+{
+    if (const FilterPipeline* pipeline = filterMethod.target<FilterPipeline>()) {
+        stages.insert(stages.end(), pipeline->stages.begin(), pipeline->stages.end());
+        return *this;
+    }
+
+    // the collapsed variants compute the same results and are fused the same way
+    const FilterFunction* function = filterMethod.target<FilterFunction>();
+    if (function != nullptr) {
+        if (*function == &ImageFilter::GrayscaleImage || *function == &ImageFilter::GrayscaleImageCollapsed)
+            return AddGrayscale();
+        if (*function == &ImageFilter::GrayscaleImageSingleChannel)
+            return AddGrayscaleSingleChannel();
+        if (*function == &ImageFilter::HSVImage || *function == &ImageFilter::HSVImageCollapsed)
+            return AddHSV();
+        if (*function == &ImageFilter::EmbossImage || *function == &ImageFilter::EmbossImageCollapsed)
+            return AddEmboss();
+    }
+
+    stages.push_back({ StageType::Custom, filterMethod });
+    return *this;
+}
+
+int FilterPipeline::GetSweepCount() const
+{
+    int sweeps = 0;
+    for (size_t i = 0; i < stages.size(); i++) {
+        if (stages[i].type == StageType::Custom || i == 0 || stages[i - 1].type == StageType::Custom)
+            sweeps++;
+    }
+    return sweeps;
+}
+
+int FilterPipeline::GetStencilCount() const
+{
+    int stencils = 0;
+    for (const Stage& stage : stages) {
+        if (stage.type == StageType::Emboss) stencils++;
+    }
+    return stencils;
+}
+
+void FilterPipeline::Apply(cv::Mat& image, bool useOpenMP, HaloExchange* haloExchange) const
+{
+    const SimdKernelTable& kernels = SimdKernels::GetKernels();
+
+    size_t begin = 0;
+    while (begin < stages.size()) {
+        if (stages[begin].type == StageType::Custom) {
+            ImageFilterTrace trace(Trace::IsEnabled() ? GetStageNames(begin, begin + 1) : std::string(), image);
+            stages[begin].method(image, useOpenMP);
+            begin++;
+            continue;
+        }
+
+        size_t end = begin;
+        while (end < stages.size() && stages[end].type != StageType::Custom) end++;
+
+        if (image.type() == CV_8UC3 || image.type() == CV_8UC1) {
+            // the fused sweep is traced as a single filter, the filters of the other images trace themselves
+            ImageFilterTrace trace(Trace::IsEnabled() ? GetStageNames(begin, end) : std::string(), image);
+            ApplyFused(image, begin, end, kernels, useOpenMP, haloExchange);
+        }
+        else {
+            // the row kernels only support 8-bit BGR and gray images, other images are filtered one by one
+            for (size_t i = begin; i < end; i++) {
+                stages[i].method(image, useOpenMP);
+            }
+        }
+        begin = end;
+    }
+}
+
+/// <summary>
+/// Buffers of a thread sweeping bands of rows. Every thread keeps its buffers between the calls and only grows them,
+/// so that filtering a stream of equally sized frames does not allocate.
+/// </summary>
+struct SweepBuffers
+{
+    std::vector<uchar> rows;
+    std::vector<StencilWindow> windows;
+    uchar* workRows[2] = { nullptr, nullptr };
+
+    static SweepBuffers& ForThread(int stencilCount, size_t rowBytes) {
+        static thread_local SweepBuffers buffers;
+        // previous, input and output row of every stencil and two rows for the pointwise filters
+        buffers.rows.resize((3 * static_cast<size_t>(stencilCount) + 2) * rowBytes);
+        buffers.windows.resize(stencilCount);
+        buffers.workRows[0] = buffers.rows.data() + 3 * static_cast<size_t>(stencilCount) * rowBytes;
+        buffers.workRows[1] = buffers.workRows[0] + rowBytes;
+        return buffers;
+    }
+};
+
+/// <summary>
+/// Sweeps the rows from bandBegin to bandEnd of the image into the output, which is either the image itself or an
+/// image with the number of channels of the last filter. The sweep starts with the given unfiltered rows directly
+/// above the band, which are only run through the filters to fill the stencil windows. Sweeps without stencils
+/// may cover only the columns from colBegin to colEnd.
+/// </summary>
+static void SweepBand(const cv::Mat& image, cv::Mat& output, int bandBegin, int bandEnd, int colBegin, int colEnd,
+    const uchar* rowsAbove, int rowsAboveCount, const std::vector<FusedOperation>& operations, SweepBuffers& buffers,
+    size_t bufferRowBytes)
+{
+    const size_t rowBytes = static_cast<size_t>(image.cols) * image.elemSize();
+    const size_t inputOffset = colBegin * image.elemSize();
+    const size_t outputOffset = colBegin * output.elemSize();
+    const int cols = colEnd - colBegin;
+
+    for (size_t i = 0; i < buffers.windows.size(); i++) {
+        uchar* windowRows = buffers.rows.data() + 3 * i * bufferRowBytes;
+        buffers.windows[i] = { windowRows, windowRows + bufferRowBytes, windowRows + 2 * bufferRowBytes, false };
+    }
+
+    for (int i = 0; i < rowsAboveCount; i++) {
+        FilterFusedRow(operations, buffers.windows, buffers.workRows, rowsAbove + i * rowBytes, nullptr, cols);
+    }
+
+    for (int x = bandBegin; x < bandEnd; x++) {
+        FilterFusedRow(operations, buffers.windows, buffers.workRows, image.ptr<uchar>(x) + inputOffset,
+            output.ptr<uchar>(x) + outputOffset, cols);
+    }
+}
+
+void FilterPipeline::ApplyFused(cv::Mat& image, size_t begin, size_t end, const SimdKernelTable& kernels, bool useOpenMP,
+    HaloExchange* haloExchange) const
+{
+    // the number of channels of the rows is tracked through the filters, single-channel rows are only expanded to
+    // BGR pixels where a filter needs them
+    std::vector<FusedOperation> operations;
+    int stencilCount = 0;
+    int channels = image.channels();
+    for (size_t i = begin; i < end; i++) {
+        switch (stages[i].type) {
+        case StageType::Grayscale:
+        case StageType::GrayscaleSingleChannel:
+            if (channels == 1) {
+                operations.push_back({ kernels.expandPlaneRow, nullptr, 1, 3 });
+                operations.push_back({ kernels.grayscalePlaneRow, nullptr, 3, 1 });
+            }
+            else if (stages[i].type == StageType::GrayscaleSingleChannel) {
+                operations.push_back({ kernels.grayscalePlaneRow, nullptr, 3, 1 });
+                channels = 1;
+            }
+            else {
+                operations.push_back({ kernels.grayscaleRow, nullptr, 3, 3 });
+            }
+            break;
+        case StageType::HSV:
+            if (channels == 1) operations.push_back({ kernels.expandPlaneRow, nullptr, 1, 3 });
+            operations.push_back({ kernels.hsvRow, nullptr, 3, 3 });
+            channels = 3;
+            break;
+        default:
+            operations.push_back({ nullptr, (channels == 1) ? kernels.embossPlaneRow : kernels.embossRow, channels, channels });
+            stencilCount++;
+            break;
+        }
+    }
+
+    // the rows above the image are only needed by stencils. The exchange is started before anything is written,
+    // so that the neighbors receive the unfiltered rows
+    if (stencilCount == 0) haloExchange = nullptr;
+    if (haloExchange != nullptr) haloExchange->Begin(image, stencilCount);
+
+    // the rows are written into a new image if the number of channels changes, the buffers of the sweep hold rows
+    // of either layout
+    const int rows = image.rows;
+    const int cols = image.cols;
+    const size_t rowBytes = static_cast<size_t>(cols) * image.elemSize();
+    const size_t bufferRowBytes = static_cast<size_t>(cols) * 3;
+    cv::Mat output = (channels == image.channels()) ? image : cv::Mat(rows, cols, CV_8UC(channels));
+    if (rows == 0 || cols == 0) {
+        if (haloExchange != nullptr) haloExchange->Finish();
+        image = output;
+        return;
+    }
+
+    // the image is divided into bands of rows, which are swept independently, with the height of the tiles of the
+    // active schedule. When the rows above the image are exchanged, the first band only contains the rows depending
+    // on them and is swept after all others
+    const TileSchedule& schedule = TileScheduler::GetSchedule();
+    std::vector<int> bandBegins = { 0 };
+    if (haloExchange != nullptr) bandBegins.push_back(std::min(rows, stencilCount));
+    int remainingRows = rows - bandBegins.back();
+    if (remainingRows > 0) {
+        int bandCount = useOpenMP ? std::min(remainingRows, TileScheduler::GetThreadCount() * 4) : 1;
+        int bandHeight = (schedule.tileRows > 0) ? schedule.tileRows : (remainingRows + bandCount - 1) / bandCount;
+        for (int x = bandBegins.back() + bandHeight; x < rows; x += bandHeight) bandBegins.push_back(x);
+        bandBegins.push_back(rows);
+    }
+    int bandCount = static_cast<int>(bandBegins.size()) - 1;
+
+    // every stencil depends on one more row above the band, which each band recomputes. Since the image may be
+    // filtered in place these input rows are copied before any band writes its output
+    static thread_local std::vector<uchar> haloRows;
+    haloRows.resize(static_cast<size_t>(bandCount) * stencilCount * rowBytes);
+    for (int band = 1; band < bandCount; band++) {
+        int bandBegin = bandBegins[band];
+        int rowsAboveCount = std::min(stencilCount, bandBegin);
+        for (int i = 0; i < rowsAboveCount; i++) {
+            size_t haloRow = static_cast<size_t>(band) * stencilCount + i;
+            memcpy(haloRows.data() + haloRow * rowBytes, image.ptr<uchar>(bandBegin - rowsAboveCount + i), rowBytes);
+        }
+    }
+
+    // the first band is swept after all others if it has to wait for the rows above the image. The copied rows
+    // are passed by pointer, since every thread that names the thread_local buffer would see its own
+    int firstParallelBand = haloExchange != nullptr ? 1 : 0;
+    const uchar* haloData = haloRows.data();
+
+    // without stencils the bands are also divided into columns, stencils would need the unfiltered columns to the left
+    const int tileCols = (stencilCount == 0 && schedule.tileCols > 0) ? std::min(schedule.tileCols, cols) : cols;
+    const int colTileCount = (cols + tileCols - 1) / tileCols;
+
+    TileScheduler::ForEach((bandCount - firstParallelBand) * colTileCount, schedule.policy, useOpenMP, [&](int tile) {
+        int band = firstParallelBand + tile / colTileCount;
+        int colBegin = (tile % colTileCount) * tileCols;
+        int rowsAboveCount = std::min(stencilCount, bandBegins[band]);
+        const uchar* rowsAbove = haloData + static_cast<size_t>(band) * stencilCount * rowBytes;
+        SweepBuffers& buffers = SweepBuffers::ForThread(stencilCount, bufferRowBytes);
+        SweepBand(image, output, bandBegins[band], bandBegins[band + 1], colBegin, std::min(cols, colBegin + tileCols),
+            rowsAbove, rowsAboveCount, operations, buffers, bufferRowBytes);
+    });
+
+    if (haloExchange != nullptr) {
+        cv::Mat rowsAbove = haloExchange->Finish();
+        if (!rowsAbove.empty() && !rowsAbove.isContinuous()) rowsAbove = rowsAbove.clone();
+
+        SweepBuffers& buffers = SweepBuffers::ForThread(stencilCount, bufferRowBytes);
+        SweepBand(image, output, 0, bandBegins[1], 0, cols, rowsAbove.empty() ? nullptr : rowsAbove.ptr<uchar>(),
+            rowsAbove.rows, operations, buffers, bufferRowBytes);
+    }
+
+    image = output;
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "SimdKernels.h"
+
+/// <summary>
+/// Provides the rows directly above an image that is part of a larger image, e.g. the partial image of an MPI process,
+/// so that stencil filters can compare the first rows of the image with their neighbors.
+/// </summary>
+class HaloExchange
+{
+public:
+    virtual ~HaloExchange() {}
+
+    /// <summary>
+    /// Starts to exchange the rows above the image, before a sweep with the given number of stencil filters begins.
+    /// Called while the image is still unfiltered, every process has to call it for the same sweeps.
+    /// </summary>
+    /// <param name="image">The part of the larger image</param>
+    /// <param name="rowCount">The number of rows above the image that are needed</param>
+    virtual void Begin(const cv::Mat& image, int rowCount) = 0;
+
+    /// <summary>
+    /// Waits for the exchange to finish and returns the unfiltered rows above the image. Fewer rows than requested
+    /// are returned if the image starts less than rowCount rows below the top of the larger image.
+    /// </summary>
+    /// <returns></returns>
+    virtual cv::Mat Finish() = 0;
+};
+
+/// <summary>
+/// An ordered chain of image filters that is applied in as few sweeps over the image as possible.
+/// Consecutive grayscale, hsv and embossing filters are fused into a single sweep: every row is run through all
+/// pointwise filters while it is in cache, and the embossing filter reads its top-left neighbors from a small
+/// rolling window of already filtered rows instead of a clone of the image. Filters that are not known to the
+/// pipeline are applied on their own, splitting the chain into multiple sweeps.
+/// The rows are either interleaved BGR or single-channel gray, which a single-channel grayscale filter produces
+/// and all following filters keep until a hsv filter needs three channels again. The layout of every filter in a
+/// sweep is known in advance, so the rows are only expanded where needed and never converted back.
+/// </summary>
+class FilterPipeline
+{
+public:
+    typedef std::function<void(cv::Mat&, bool)> FilterMethod;
+
+    /// <summary>
+    /// Creates a pipeline from a list of filter methods. ImageFilter methods and their collapsed variants are
+    /// recognized and fused, all other methods are applied as they are.
+    /// </summary>
+    /// <param name="filterMethods">The image filter methods in the order they should be run</param>
+    /// <returns></returns>
+    static FilterPipeline FromFilterMethods(const std::vector<FilterMethod>& filterMethods);
+
+    /// <summary>
+    /// Returns a readable name of a filter method, e.g. for benchmarks. Known ImageFilter methods are named after
+    /// their filter and pipelines after all of their filters.
+    /// </summary>
+    /// <param name="filterMethod"></param>
+    /// <returns></returns>
+    static std::string GetFilterName(const FilterMethod& filterMethod);
+
+    /// <summary>
+    /// Appends a grayscale filter to the pipeline.
+    /// </summary>
+    /// <returns></returns>
+    FilterPipeline& AddGrayscale();
+
+    /// <summary>
+    /// Appends a grayscale filter to the pipeline, which outputs single-channel rows.
+    /// </summary>
+    /// <returns></returns>
+    FilterPipeline& AddGrayscaleSingleChannel();
+
+    /// <summary>
+    /// Appends a hsv filter to the pipeline.
+    /// </summary>
+    /// <returns></returns>
+    FilterPipeline& AddHSV();
+
+    /// <summary>
+    /// Appends an embossing filter to the pipeline.
+    /// </summary>
+    /// <returns></returns>
+    FilterPipeline& AddEmboss();
+
+    /// <summary>
+    /// Appends a filter method to the pipeline, which is fused if it is a known ImageFilter method.
+    /// </summary>
+    /// <param name="filterMethod"></param>
+    /// <returns></returns>
+    FilterPipeline& Add(const FilterMethod& filterMethod);
+
+    /// <summary>
+    /// Applies all filters of the pipeline on the image in order.
+    /// </summary>
+    /// <param name="image">The image, which is filtered in place or replaced by an image with a different number of
+    /// channels</param>
+    /// <param name="useOpenMP">Wether to use OpenMP for the image filter or not</param>
+    /// <param name="haloExchange">Provides the rows above the image if it is part of a larger image. The rows
+    /// that do not depend on them are filtered while the exchange is running</param>
+    void Apply(cv::Mat& image, bool useOpenMP = true, HaloExchange* haloExchange = nullptr) const;
+
+    /// <summary>
+    /// Allows the pipeline to be used as a filter method.
+    /// </summary>
+    void operator()(cv::Mat& image, bool useOpenMP = true) const {
+        Apply(image, useOpenMP);
+    }
+
+    /// <summary>
+    /// Returns the number of sweeps over the image that are needed to apply the pipeline.
+    /// </summary>
+    /// <returns></returns>
+    int GetSweepCount() const;
+
+    /// <summary>
+    /// Returns the number of filters in the pipeline.
+    /// </summary>
+    /// <returns></returns>
+    size_t GetFilterCount() const {
+        return stages.size();
+    }
+
+    /// <summary>
+    /// Returns the number of stencil filters in the pipeline, which is also the number of rows above a part of a
+    /// larger image that are needed to filter the part on its own.
+    /// </summary>
+    /// <returns></returns>
+    int GetStencilCount() const;
+
+private:
+    enum class StageType { Grayscale, GrayscaleSingleChannel, HSV, Emboss, Custom };
+
+    struct Stage
+    {
+        StageType type;
+        FilterMethod method;
+    };
+
+    std::vector<Stage> stages;
+
+    std::string GetStageNames(size_t begin, size_t end) const;
+
+    void ApplyFused(cv::Mat& image, size_t begin, size_t end, const SimdKernelTable& kernels, bool useOpenMP,
+        HaloExchange* haloExchange) const;
+};
@@ -0,0 +1,42 @@
+#include "ImageBatch.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <opencv2/opencv.hpp>
+#include "RawImage.h"
+
+std::vector<std::string> GetBatchImagePaths(const std::string& batchPath)
+{
+    std::vector<std::string> imagePaths;
+
+    if (std::filesystem::is_directory(batchPath)) {
+        for (const auto& entry : std::filesystem::directory_iterator(batchPath)) {
+            std::string imagePath = entry.path().string();
+            if (entry.is_regular_file() && (cv::haveImageReader(imagePath) || RawImageFile::HasRawExtension(imagePath)))
+                imagePaths.push_back(imagePath);
+        }
+        std::sort(imagePaths.begin(), imagePaths.end());
+        return imagePaths;
+    }
+
+    std::ifstream fileList(batchPath);
+    if (!fileList)
+        throw std::invalid_argument("Could not open or find the batch!");
+
+    std::string line;
+    while (std::getline(fileList, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (!line.empty()) imagePaths.push_back(line);
+    }
+    return imagePaths;
+}
+
+std::string GetBatchOutputName(const std::vector<std::string>& imagePaths, int index)
+{
+    // the indices are padded to the same width, so that the outputs are listed in the order of the batch
+    std::string number = std::to_string(index);
+    const size_t width = std::to_string(std::max<size_t>(imagePaths.size(), 1) - 1).size();
+    if (number.size() < width) number.insert(0, width - number.size(), '0');
+    return "resulting_image_" + number + "_" + std::filesystem::path(imagePaths[index]).stem().string();
+}
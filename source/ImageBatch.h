@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/// <summary>
+/// Returns the image paths of a batch, which is either a directory whose readable and raw images are taken in alphabetical
+/// order, or a text file with one image path per line.
+/// Throws an invalid_argument exception if the batch could not be opened.
+/// </summary>
+/// <param name="batchPath">The path of the directory or the file list</param>
+/// <returns></returns>
+std::vector<std::string> GetBatchImagePaths(const std::string& batchPath);
+
+/// <summary>
+/// Returns the name of the filtered image of a batch without extension, e.g. "resulting_image_007_photo" for the
+/// image photo.png at the index 7 of a batch of 120 images. The index keeps images with the same name from different
+/// directories apart, and the prefix keeps the outputs from replacing their inputs if they are saved next to them.
+/// </summary>
+/// <param name="imagePaths">The image paths of the batch</param>
+/// <param name="index">The index of the image in the batch</param>
+/// <returns></returns>
+std::string GetBatchOutputName(const std::vector<std::string>& imagePaths, int index);
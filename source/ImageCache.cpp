@@ -0,0 +1,180 @@
+#include "ImageCache.h"
+#include "RawImage.h"
+
+ImageCache::ImageCache(size_t memoryBudget)
+    : memoryBudget(memoryBudget)
+{
+}
+
+ImageCache& ImageCache::GetShared()
+{
+    static ImageCache sharedCache;
+    return sharedCache;
+}
+
+cv::Mat ImageCache::Read(const std::string& path, bool* cached)
+{
+    if (cached != nullptr) *cached = false;
+
+    // files whose modification time cannot be read are decoded without the cache, imread reports the error
+    std::error_code error;
+    std::filesystem::file_time_type modified = std::filesystem::last_write_time(path, error);
+    if (error)
+        return cv::imread(path);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (memoryBudget == 0)
+            return cv::imread(path);
+
+        auto entry = index.find(path);
+        if (entry != index.end()) {
+            if (entry->second->modified == modified) {
+                hits++;
+                entries.splice(entries.begin(), entries, entry->second);
+                if (cached != nullptr) *cached = true;
+                return entries.front().image;
+            }
+            Remove(entry->second);
+        }
+        misses++;
+    }
+
+    // the image is decoded without holding the lock, so that other threads can use the cache in the meantime
+    cv::Mat image = cv::imread(path);
+    if (image.empty())
+        return image;
+
+    size_t imageBytes = image.total() * image.elemSize();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (imageBytes > memoryBudget)
+        return image;
+
+    // another thread may have decoded the same image in the meantime
+    auto entry = index.find(path);
+    if (entry != index.end()) Remove(entry->second);
+
+    Evict(memoryBudget - imageBytes);
+    entries.push_front({ path, modified, image });
+    index[path] = entries.begin();
+    memoryUsage += imageBytes;
+    if (cached != nullptr) *cached = true;
+    return image;
+}
+
+void ImageCache::SetMemoryBudget(size_t memoryBudget)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    this->memoryBudget = memoryBudget;
+    Evict(memoryBudget);
+}
+
+void ImageCache::Clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Evict(0);
+}
+
+size_t ImageCache::GetMemoryBudget() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return memoryBudget;
+}
+
+size_t ImageCache::GetMemoryUsage() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return memoryUsage;
+}
+
+size_t ImageCache::GetHits() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return hits;
+}
+
+size_t ImageCache::GetMisses() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return misses;
+}
+
+void ImageCache::Evict(size_t memoryLimit)
+{
+    while (memoryUsage > memoryLimit && !entries.empty()) {
+        Remove(std::prev(entries.end()));
+    }
+}
+
+void ImageCache::Remove(std::list<Entry>::iterator entry)
+{
+    memoryUsage -= entry->image.total() * entry->image.elemSize();
+    index.erase(entry->path);
+    entries.erase(entry);
+}
+
+ImageSource::ImageSource(const std::string& path)
+    : path(path)
+{
+}
+
+ImageSource::ImageSource(const char* path)
+    : path(path)
+{
+}
+
+ImageSource::ImageSource(const cv::Mat& image)
+    : image(image)
+{
+}
+
+ImageSource ImageSource::FromBuffer(void* data, int rows, int cols, int type, size_t step)
+{
+    return ImageSource(cv::Mat(rows, cols, type, data, step));
+}
+
+cv::Mat ImageSource::Get() const
+{
+    if (path.empty())
+        return image;
+
+    // raw images are mapped on first use and read from the page cache afterwards
+    if (RawImageFile::HasRawExtension(path)) {
+        try {
+            if (!rawImage) rawImage = std::make_shared<RawImageFile>(path);
+        }
+        catch (const std::exception&) {
+            return cv::Mat();
+        }
+        return rawImage->GetImage();
+    }
+    return ImageCache::GetShared().Read(path);
+}
+
+cv::Mat ImageSource::GetCopy() const
+{
+    if (path.empty() || RawImageFile::HasRawExtension(path))
+        return Get().clone();
+
+    bool cached;
+    cv::Mat decodedImage = ImageCache::GetShared().Read(path, &cached);
+    return cached ? decodedImage.clone() : decodedImage;
+}
+
+cv::Mat ImageSource::Decode() const
+{
+    if (path.empty())
+        return image.clone();
+
+    // the pixels of raw images are copied out of the mapping, which is closed again
+    if (RawImageFile::HasRawExtension(path)) {
+        try {
+            return RawImageFile(path).GetImage().clone();
+        }
+        catch (const std::exception&) {
+            return cv::Mat();
+        }
+    }
+    return cv::imread(path);
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <opencv2/opencv.hpp>
+
+/// <summary>
+/// Cache of decoded images, keyed by their path and the time they were last modified, so that images that are
+/// filtered repeatedly are only decoded once. The least recently used images are evicted as soon as the decoded
+/// images exceed the memory budget, images larger than the whole budget are not cached at all.
+/// </summary>
+class ImageCache
+{
+public:
+    /// <summary>
+    /// Creates an empty cache.
+    /// </summary>
+    /// <param name="memoryBudget">The maximum number of bytes of all cached images, 0 disables the cache</param>
+    explicit ImageCache(size_t memoryBudget = 0);
+
+    ImageCache(const ImageCache&) = delete;
+    ImageCache& operator=(const ImageCache&) = delete;
+
+    /// <summary>
+    /// Returns the cache that is shared by all filters of the process.
+    /// </summary>
+    /// <returns></returns>
+    static ImageCache& GetShared();
+
+    /// <summary>
+    /// Returns the decoded image at the specified path, which is decoded again if the file was modified since it was
+    /// cached. The pixels of a cached image are shared with the cache and must not be modified.
+    /// </summary>
+    /// <param name="path">The file path of the image</param>
+    /// <param name="cached">Receives wether the returned image is shared with the cache</param>
+    /// <returns>The image, which is empty if it could not be read</returns>
+    cv::Mat Read(const std::string& path, bool* cached = nullptr);
+
+    /// <summary>
+    /// Sets the maximum number of bytes of all cached images and evicts images until they fit.
+    /// </summary>
+    /// <param name="memoryBudget">The maximum number of bytes, 0 disables the cache</param>
+    void SetMemoryBudget(size_t memoryBudget);
+
+    /// <summary>
+    /// Removes all images from the cache.
+    /// </summary>
+    void Clear();
+
+    size_t GetMemoryBudget() const;
+    size_t GetMemoryUsage() const;
+    size_t GetHits() const;
+    size_t GetMisses() const;
+
+private:
+    struct Entry
+    {
+        std::string path;
+        std::filesystem::file_time_type modified;
+        cv::Mat image;
+    };
+
+    // the entries are ordered from the most to the least recently used
+    std::list<Entry> entries;
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    size_t memoryBudget;
+    size_t memoryUsage = 0;
+    size_t hits = 0;
+    size_t misses = 0;
+    mutable std::mutex mutex;
+
+    void Evict(size_t memoryLimit);
+    void Remove(std::list<Entry>::iterator entry);
+};
+
+class RawImageFile;
+
+/// <summary>
+/// The input image of a filter, which is either read from a file through the shared image cache, or an image that
+/// is already decoded in memory, so that decoding can be skipped entirely. Raw images are mapped instead of being
+/// cached, their pixels stay mapped as long as the source exists. Paths convert implicitly, so that filters can still
+/// be called with a file path.
+/// </summary>
+class ImageSource
+{
+public:
+    ImageSource(const std::string& path);
+    ImageSource(const char* path);
+
+    /// <summary>
+    /// Creates a source of an image that is already decoded. The pixels are not copied and have to stay unchanged
+    /// while the source is used.
+    /// </summary>
+    /// <param name="image"></param>
+    ImageSource(const cv::Mat& image);
+
+    /// <summary>
+    /// Creates a source of decoded pixels in a raw buffer, e.g. a camera frame or a buffer of another library. The
+    /// buffer is not copied and has to stay valid and unchanged while the source is used.
+    /// </summary>
+    /// <param name="data">The first pixel of the buffer</param>
+    /// <param name="rows">The number of rows</param>
+    /// <param name="cols">The number of pixels per row</param>
+    /// <param name="type">The OpenCV type of the pixels, e.g. CV_8UC3 for BGR pixels</param>
+    /// <param name="step">The number of bytes per row, including padding</param>
+    /// <returns></returns>
+    static ImageSource FromBuffer(void* data, int rows, int cols, int type = CV_8UC3, size_t step = cv::Mat::AUTO_STEP);
+
+    /// <summary>
+    /// Returns the decoded image, whose pixels may be shared and must not be modified.
+    /// </summary>
+    /// <returns>The image, which is empty if it could not be read</returns>
+    cv::Mat Get() const;
+
+    /// <summary>
+    /// Returns the decoded image to be filtered in place. The pixels are only copied if they are shared with the
+    /// cache or the caller.
+    /// </summary>
+    /// <returns>The image, which is empty if it could not be read</returns>
+    cv::Mat GetCopy() const;
+
+    /// <summary>
+    /// Decodes the image into pixels of its own without the shared image cache, for images that are only read
+    /// once, e.g. the images of a batch, which would otherwise fill the cache and be copied out of it.
+    /// </summary>
+    /// <returns>The image, which is empty if it could not be read</returns>
+    cv::Mat Decode() const;
+
+    /// <summary>
+    /// Returns the file path of the image, which is empty for images in memory.
+    /// </summary>
+    /// <returns></returns>
+    const std::string& GetPath() const {
+        return path;
+    }
+
+private:
+    std::string path;
+    cv::Mat image;
+    mutable std::shared_ptr<RawImageFile> rawImage;
+};
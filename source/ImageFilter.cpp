@@ -1,34 +1,110 @@
 #include "ImageFilter.h"
+#include "SimdKernels.h"
+#include "TileScheduler.h"
+
+/// <summary>
+/// Filters the image tile by tile with a pointwise row kernel, in the tiles and order of the active schedule. The
+/// output is either the image itself or an image with the number of channels the kernel writes. Single-channel gray
+/// images are filtered like BGR pixels whose channels all hold the gray value, every row of a tile is expanded into a
+/// buffer of the thread first.
+/// </summary>
+static void FilterPointTiles(const cv::Mat& image, cv::Mat& output, PointRowKernel pointRow, bool useOpenMP)
+{
+    // rows are filtered by the vectorized kernel of the instruction set selected at startup
+    const TileSchedule& schedule = TileScheduler::GetSchedule();
+    const int tileRows = (schedule.tileRows > 0) ? schedule.tileRows : 1;
+    const int tileCount = TileScheduler::GetTileCount(image.rows, image.cols, tileRows, schedule.tileCols);
+    const bool expand = image.channels() == 1;
+    PointRowKernel expandPlaneRow = SimdKernels::GetKernels().expandPlaneRow;
+
+    TileScheduler::ForEach(tileCount, schedule.policy, useOpenMP, [&](int tile) {
+        cv::Rect rect = TileScheduler::GetTile(tile, image.rows, image.cols, tileRows, schedule.tileCols);
+        static thread_local std::vector<uchar> expandedRow;
+        if (expand) expandedRow.resize(static_cast<size_t>(rect.width) * 3);
+
+        for (int x = rect.y; x < rect.y + rect.height; x++) {
+            const uchar* src = image.ptr<uchar>(x) + rect.x * image.elemSize();
+            if (expand) {
+                expandPlaneRow(src, expandedRow.data(), rect.width);
+                src = expandedRow.data();
+            }
+            pointRow(src, output.ptr<uchar>(x) + rect.x * output.elemSize(), rect.width);
+        }
+    });
+}
+
+/// <summary>
+/// Calls the function for one consecutive range of pixels per thread of the active backend, like a static schedule of
+/// a loop over all pixels.
+/// </summary>
+template<typename Function>
+static void ForEachPixelRange(int pixels, bool useOpenMP, const Function& function)
+{
+    const int rangeCount = useOpenMP ? std::max(1, std::min(pixels, TileScheduler::GetThreadCount())) : 1;
+    TileScheduler::ForEach(rangeCount, SchedulePolicy::Static, useOpenMP, [&](int range) {
+        function(static_cast<int>(static_cast<long long>(pixels) * range / rangeCount),
+            static_cast<int>(static_cast<long long>(pixels) * (range + 1) / rangeCount));
+    });
+}
 
 void ImageFilter::GrayscaleImage(cv::Mat& image, bool useOpenMP)
 {
-    #pragma omp parallel for schedule(dynamic) if(useOpenMP)
-    for (int x = 0; x < image.rows; x++) {
-        for (int y = 0; y < image.cols; y++) {
+    ImageFilterTrace trace("Grayscale", image);
+    const SimdKernelTable& kernels = SimdKernels::GetKernels();
+    FilterPointTiles(image, image, (image.channels() == 1) ? kernels.grayscalePlaneRow : kernels.grayscaleRow, useOpenMP);
+}
+
+void ImageFilter::GrayscaleImageCollapsed(cv::Mat& image, bool useOpenMP)
+{
+    ImageFilterTrace trace("GrayscaleCollapsed", image);
+    // the collapsed loop only handles BGR pixels
+    if (image.channels() == 1) return GrayscaleImage(image, useOpenMP);
+
+    ForEachPixelRange(image.rows * image.cols, useOpenMP, [&](int begin, int end) {
+        for (int xy = begin; xy < end; xy++) {
+            int x = xy / image.cols;
+            int y = xy % image.cols;
             cv::Vec3b pixel = image.at<cv::Vec3b>(x, y);
             uchar gray = static_cast<uchar>(0.21 * pixel[2] + 0.72 * pixel[1] + 0.07 * pixel[0]);
             image.at<cv::Vec3b>(x, y) = cv::Vec3b(gray, gray, gray);
         }
-    }
+    });
 }
 
-void ImageFilter::GrayscaleImageCollapsed(cv::Mat& image, bool useOpenMP)
+void ImageFilter::GrayscaleImageSingleChannel(cv::Mat& image, bool useOpenMP)
 {
-    #pragma omp parallel for schedule(static) if(useOpenMP)
-    for (int xy = 0; xy < image.rows * image.cols; xy++) {
-        int x = xy / image.cols;
-        int y = xy % image.cols;
-        cv::Vec3b pixel = image.at<cv::Vec3b>(x, y);
-        uchar gray = static_cast<uchar>(0.21 * pixel[2] + 0.72 * pixel[1] + 0.07 * pixel[0]);
-        image.at<cv::Vec3b>(x, y) = cv::Vec3b(gray, gray, gray);
-    }
+    ImageFilterTrace trace("GrayscaleSingleChannel", image);
+    if (image.channels() == 1) return GrayscaleImage(image, useOpenMP);
+
+    cv::Mat gray(image.rows, image.cols, CV_8UC1);
+    FilterPointTiles(image, gray, SimdKernels::GetKernels().grayscalePlaneRow, useOpenMP);
+    image = gray;
 }
 
 void ImageFilter::HSVImage(cv::Mat& image, bool useOpenMP)
 {
-    #pragma omp parallel for schedule(dynamic) if(useOpenMP)
-    for (int x = 0; x < image.rows; ++x) {
-        for (int y = 0; y < image.cols; ++y) {
+    ImageFilterTrace trace("HSV", image);
+    PointRowKernel hsvRow = SimdKernels::GetKernels().hsvRow;
+    if (image.channels() == 1) {
+        cv::Mat hsv(image.rows, image.cols, CV_8UC3);
+        FilterPointTiles(image, hsv, hsvRow, useOpenMP);
+        image = hsv;
+        return;
+    }
+
+    FilterPointTiles(image, image, hsvRow, useOpenMP);
+}
+
+void ImageFilter::HSVImageCollapsed(cv::Mat& image, bool useOpenMP)
+{
+    ImageFilterTrace trace("HSVCollapsed", image);
+    // the collapsed loop only handles BGR pixels
+    if (image.channels() == 1) return HSVImage(image, useOpenMP);
+
+    ForEachPixelRange(image.rows * image.cols, useOpenMP, [&](int begin, int end) {
+        for (int xy = begin; xy < end; xy++) {
+            int x = xy / image.cols;
+            int y = xy % image.cols;
             cv::Vec3b pixel = image.at<cv::Vec3b>(x, y);
 
             float r = pixel[2] / 255.0f;
@@ -58,102 +134,100 @@ void ImageFilter::HSVImage(cv::Mat& image, bool useOpenMP)
                 static_cast<uchar>(saturation * 255),
                 static_cast<uchar>(value * 255));
         }
-    }
+    });
 }
 
-void ImageFilter::HSVImageCollapsed(cv::Mat& image, bool useOpenMP)
+void ImageFilter::EmbossImage(cv::Mat& image, bool useOpenMP)
 {
-    #pragma omp parallel for schedule(static) if(useOpenMP)
-    for (int xy = 0; xy < image.rows * image.cols; xy++) {
-        int x = xy / image.cols;
-        int y = xy % image.cols;
-        cv::Vec3b pixel = image.at<cv::Vec3b>(x, y);
-
-        float r = pixel[2] / 255.0f;
-        float g = pixel[1] / 255.0f;
-        float b = pixel[0] / 255.0f;
-
-        float cmax = fmax(fmax(r, g), b);
-        float cmin = fmin(fmin(r, g), b);
-        float delta = cmax - cmin;
-
-        float hue = 0.0;
-        if (delta != 0.0) {
-            if (cmax == r)
-                hue = 60 * fmod((g - b) / delta, 6.0f);
-            else if (cmax == g)
-                hue = 60 * (((b - r) / delta) + 2.0f);
-            else if (cmax == b)
-                hue = 60 * (((r - g) / delta) + 4.0f);
-        }
-        if (hue < 0) hue += 360;
-        float saturation = (cmax == 0.0f) ? 0 : (delta / cmax);
-        float value = cmax;
-
-        // multiply saturation and value by 255 to switch from normalized HSV space to pseudo-RGB space
-        image.at<cv::Vec3b>(x, y) = cv::Vec3b(
-            static_cast<uchar>(hue),
-            static_cast<uchar>(saturation * 255),
-            static_cast<uchar>(value * 255));
+    ImageFilterTrace trace("Emboss", image);
+    if (image.empty()) return;
+
+    // since embossing compares with the top-left pixel, the rows of each band are filtered in place from the bottom
+    // up, so that the row above is still unfiltered. Only the row above each band has to be copied beforehand, 
+    // since it belongs to another band that might already have been written. The bands are the whole rows of the
+    // tiles of the active schedule
+    const TileSchedule& schedule = TileScheduler::GetSchedule();
+    const size_t rowBytes = static_cast<size_t>(image.cols) * image.elemSize();
+    int bandCount = useOpenMP ? std::min(image.rows, TileScheduler::GetThreadCount() * 4) : 1;
+    int bandHeight = (schedule.tileRows > 0) ? schedule.tileRows : (image.rows + bandCount - 1) / bandCount;
+    bandCount = (image.rows + bandHeight - 1) / bandHeight;
+
+    // the boundary rows are kept between the calls, so that filtering equally sized frames does not allocate
+    static thread_local std::vector<uchar> boundaryRows;
+    boundaryRows.resize(bandCount * rowBytes);
+    for (int band = 1; band < bandCount; band++) {
+        memcpy(boundaryRows.data() + band * rowBytes, image.ptr<uchar>(band * bandHeight - 1), rowBytes);
     }
+
+    StencilRowKernel embossRow = (image.channels() == 1) ? SimdKernels::GetKernels().embossPlaneRow : SimdKernels::GetKernels().embossRow;
+
+    // the threads read the boundary rows of the calling thread through a pointer, naming the thread_local buffer
+    // would give every thread its own
+    const uchar* boundaryData = boundaryRows.data();
+
+    TileScheduler::ForEach(bandCount, schedule.policy, useOpenMP, [&](int band) {
+        int bandBegin = band * bandHeight;
+        int bandEnd = std::min(image.rows, bandBegin + bandHeight);
+        for (int x = bandEnd - 1; x >= bandBegin; x--) {
+            const uchar* previousRow = (x - 1 < 0) ? nullptr
+                : (x == bandBegin) ? boundaryData + band * rowBytes
+                : image.ptr<uchar>(x - 1);
+            embossRow(previousRow, image.ptr<uchar>(x), image.ptr<uchar>(x), image.cols);
+        }
+    });
 }
 
-void ImageFilter::EmbossImage(cv::Mat& image, bool useOpenMP)
+void ImageFilter::EmbossImageCollapsed(cv::Mat& image, bool useOpenMP)
 {
-    // since embossing compares with other pixels, that might already have been written
-    // changes need to be made on a clone of the original image and then applied once the filter is complete 
-    cv::Mat embossedImage = image.clone();
+    ImageFilterTrace trace("EmbossCollapsed", image);
+    if (image.empty()) return;
+
+    // the collapsed loop only handles BGR pixels
+    if (image.channels() == 1) return EmbossImage(image, useOpenMP);
+
+    // the collapsed loop is divided into one chunk per thread, whose pixels are filtered in place from the last to
+    // the first, so that the top-left pixel is still unfiltered. Only the pixels of the previous row before each chunk
+    // are copied beforehand, since they belong to another chunk that might already have been written
+    const int pixels = image.rows * image.cols;
+    const int lookBack = image.cols + 1;
+    int chunkCount = useOpenMP ? std::min(pixels, TileScheduler::GetThreadCount()) : 1;
+    int chunkSize = (pixels + chunkCount - 1) / chunkCount;
+    chunkCount = (pixels + chunkSize - 1) / chunkSize;
+
+    static thread_local std::vector<cv::Vec3b> boundaryPixels;
+    boundaryPixels.resize(static_cast<size_t>(chunkCount) * lookBack);
+    for (int chunk = 1; chunk < chunkCount; chunk++) {
+        int chunkBegin = chunk * chunkSize;
+        for (int xy = std::max(0, chunkBegin - lookBack); xy < chunkBegin; xy++) {
+            boundaryPixels[chunk * lookBack + xy - (chunkBegin - lookBack)] = image.at<cv::Vec3b>(xy / image.cols, xy % image.cols);
+        }
+    }
+
+    const cv::Vec3b* boundaryData = boundaryPixels.data();
 
-    #pragma omp parallel for schedule(dynamic) if(useOpenMP)
-    for (int x = 0; x < image.rows; x++) {
-        for (int y = 0; y < image.cols; y++) {
+    TileScheduler::ForEach(chunkCount, SchedulePolicy::Static, useOpenMP, [&](int chunk) {
+        int chunkBegin = chunk * chunkSize;
+        int chunkEnd = std::min(pixels, chunkBegin + chunkSize);
+        for (int xy = chunkEnd - 1; xy >= chunkBegin; xy--) {
+            int x = xy / image.cols;
+            int y = xy % image.cols;
             if (x - 1 < 0 || y - 1 < 0) {
                 // initialize pixels without top-left neighbor as gray
-                embossedImage.at<cv::Vec3b>(x, y) = cv::Vec3b(128, 128, 128);
+                image.at<cv::Vec3b>(x, y) = cv::Vec3b(128, 128, 128);
                 continue;
             }
 
+            int compXY = xy - lookBack;
             cv::Vec3b pixel = image.at<cv::Vec3b>(x, y);
-            cv::Vec3b compPixel = image.at<cv::Vec3b>(x - 1, y - 1);
+            cv::Vec3b compPixel = (compXY >= chunkBegin) ? image.at<cv::Vec3b>(x - 1, y - 1)
+                : boundaryData[chunk * lookBack + compXY - (chunkBegin - lookBack)];
 
             double diffR = fabs(compPixel[2] - pixel[2]);
             double diffG = fabs(compPixel[1] - pixel[1]);
             double diffB = fabs(compPixel[0] - pixel[0]);
             uchar diff = static_cast<uchar>(fmax(fmax(diffR, diffG), diffB));
-            uchar gray = static_cast<uchar>(fmin(diff + 128, 255));
-            embossedImage.at<cv::Vec3b>(x, y) = cv::Vec3b(gray, gray, gray);
-        }
-    }
-
-    image = embossedImage;
-}
-
-void ImageFilter::EmbossImageCollapsed(cv::Mat& image, bool useOpenMP)
-{
-    // since embossing compares with other pixels, that might already have been written
-    // changes need to be made on a clone of the original image and then applied once the filter is complete 
-    cv::Mat embossedImage = image.clone();
-
-    #pragma omp parallel for schedule(static) if(useOpenMP)
-    for (int xy = 0; xy < image.rows * image.cols; xy++) {
-        int x = xy / image.cols;
-        int y = xy % image.cols;
-        if (x - 1 < 0 || y - 1 < 0) {
-            // initialize pixels without top-left neighbor as gray
-            embossedImage.at<cv::Vec3b>(x, y) = cv::Vec3b(128, 128, 128);
-            continue;
+            uchar gray = static_cast<uchar>(fmin(fmax(diff + 128, 0), 255));
+            image.at<cv::Vec3b>(x, y) = cv::Vec3b(gray, gray, gray);
         }
-
-        cv::Vec3b pixel = image.at<cv::Vec3b>(x, y);
-        cv::Vec3b compPixel = image.at<cv::Vec3b>(x - 1, y - 1);
-
-        double diffR = fabs(compPixel[2] - pixel[2]);
-        double diffG = fabs(compPixel[1] - pixel[1]);
-        double diffB = fabs(compPixel[0] - pixel[0]);
-        uchar diff = static_cast<uchar>(fmax(fmax(diffR, diffG), diffB));
-        uchar gray = static_cast<uchar>(fmin(fmax(diff + 128, 0), 255));
-        embossedImage.at<cv::Vec3b>(x, y) = cv::Vec3b(gray, gray, gray);
-    }
-
-    image = embossedImage;
+    });
 }
@@ -2,6 +2,7 @@
 
 #include <opencv2/opencv.hpp>
 #include <omp.h>
+#include "Trace.h"
 
 class ImageFilter
 {
@@ -9,6 +10,7 @@ public:
     /// <summary>
     /// Calculate a grayscale using weighted channels based on the perceived luminosity (0.21 R + 0.72 G + 0.07 B)
     /// https://do-marlay-ka-moonh.medium.com/converting-color-images-to-grayscale-ab0120ea2c1e
+    /// Each row is filtered by the vectorized kernel of the instruction set detected at startup (see SimdKernels).
     /// </summary>
     /// <param name="image"></param>
     /// <param name="useOpenMP"></param>
@@ -23,9 +25,21 @@ public:
     /// <param name="useOpenMP"></param>
     static void GrayscaleImageCollapsed(cv::Mat& image, bool useOpenMP = true);
 
+    /// <summary>
+    /// Calculate a grayscale using weighted channels based on the perceived luminosity (0.21 R + 0.72 G + 0.07 B)
+    /// https://do-marlay-ka-moonh.medium.com/converting-color-images-to-grayscale-ab0120ea2c1e
+    /// The image is replaced by a single-channel image, so that all following filters move a third of the bytes.
+    /// Single-channel images are filtered like BGR images whose channels all hold the gray value.
+    /// </summary>
+    /// <param name="image"></param>
+    /// <param name="useOpenMP"></param>
+    static void GrayscaleImageSingleChannel(cv::Mat& image, bool useOpenMP = true);
+
     /// <summary>
     /// Turn an RGB colorspace image to HSV colorspace
     /// https://en.wikipedia.org/wiki/HSL_and_HSV#From_RGB
+    /// Each row is filtered by the vectorized kernel of the instruction set detected at startup (see SimdKernels).
+    /// A single-channel gray image is replaced by a BGR image, since hsv needs three channels.
     /// </summary>
     /// <param name="image"></param>
     /// <param name="useOpenMP"></param>
@@ -42,6 +56,9 @@ public:
 
     /// <summary>
     /// Emboss an RGB colorspace image using a comparison of neighboring pixels
+    /// Each row is filtered by the vectorized kernel of the instruction set detected at startup (see SimdKernels).
+    /// The image is filtered in place, only the row above each band of rows processed by a thread is copied.
+    /// Single-channel gray images stay single-channel.
     /// </summary>
     /// <param name="image"></param>
     /// <param name="useOpenMP"></param>
@@ -50,8 +67,36 @@ public:
     /// <summary>
     /// Emboss an RGB colorspace image using a comparison of neighboring pixels
     /// This embossing filter is done within a single collapsed loop.
+    /// The image is filtered in place, only the pixels above the beginning of each thread's chunk are copied.
     /// </summary>
     /// <param name="image"></param>
     /// <param name="useOpenMP"></param>
     static void EmbossImageCollapsed(cv::Mat& image, bool useOpenMP = true);
 };
+
+/// <summary>
+/// Traces a filter of an image with the bytes of the image it reads and of the image it writes, which may have
+/// another number of channels, see TraceScope.
+/// </summary>
+class ImageFilterTrace
+{
+private:
+    TraceScope scope;
+    const cv::Mat& image;
+
+public:
+    ImageFilterTrace(const char* name, const cv::Mat& image)
+        : scope(TraceCategory::Filter, name, image.total() * image.elemSize()), image(image) {
+    }
+
+    ImageFilterTrace(std::string name, const cv::Mat& image)
+        : scope(TraceCategory::Filter, std::move(name), image.total() * image.elemSize()), image(image) {
+    }
+
+    ~ImageFilterTrace() {
+        if (Trace::IsEnabled()) scope.AddBytes(image.total() * image.elemSize());
+    }
+
+    ImageFilterTrace(const ImageFilterTrace&) = delete;
+    ImageFilterTrace& operator=(const ImageFilterTrace&) = delete;
+};
@@ -0,0 +1,141 @@
+#include "ImageStrips.h"
+#include <cctype>
+#include <cstring>
+#include <stdexcept>
+
+/// <summary>
+/// Returns wether a path ends with the given extension, ignoring its case.
+/// </summary>
+static bool HasExtension(const std::string& path, const std::string& extension)
+{
+    if (path.size() < extension.size()) return false;
+    for (size_t i = 0; i < extension.size(); i++) {
+        if (std::tolower(static_cast<unsigned char>(path[path.size() - extension.size() + i])) != extension[i]) return false;
+    }
+    return true;
+}
+
+/// <summary>
+/// Swaps the first and third channel of a row of 3 channel pixels, which converts between RGB and BGR.
+/// </summary>
+static void SwapRedBlue(const uchar* src, uchar* dst, int cols)
+{
+    for (int i = 0; i < cols; i++, src += 3, dst += 3) {
+        uchar blue = src[0];
+        dst[0] = src[2];
+        dst[1] = src[1];
+        dst[2] = blue;
+    }
+}
+
+std::unique_ptr<StripReader> StripReader::Open(const std::string& path)
+{
+    if (RawImageFile::HasRawExtension(path))
+        return std::make_unique<RawStripReader>(path);
+    if (HasExtension(path, ".ppm"))
+        return std::make_unique<PPMStripReader>(path);
+    throw std::invalid_argument("Only raw and PPM images can be read in strips!");
+}
+
+std::unique_ptr<StripWriter> StripWriter::Create(const std::string& path, int rows, int cols, int type)
+{
+    if (RawImageFile::HasRawExtension(path))
+        return std::make_unique<RawStripWriter>(path, rows, cols, type);
+    if (HasExtension(path, ".ppm") && type == CV_8UC3)
+        return std::make_unique<PPMStripWriter>(path, rows, cols);
+    throw std::invalid_argument("Only raw and PPM images with 8 bit BGR pixels can be written in strips!");
+}
+
+RawStripReader::RawStripReader(const std::string& path)
+    : file(path)
+{
+    rows = file.GetImage().rows;
+    cols = file.GetImage().cols;
+    type = file.GetImage().type();
+}
+
+void RawStripReader::Read(int firstRow, cv::Mat& strip)
+{
+    file.GetImage().rowRange(firstRow, firstRow + strip.rows).copyTo(strip);
+}
+
+RawStripWriter::RawStripWriter(const std::string& path, int rows, int cols, int type)
+    : file(path, rows, cols, type)
+{
+}
+
+void RawStripWriter::Write(const cv::Mat& strip)
+{
+    cv::Mat rows = file.GetImage().rowRange(nextRow, nextRow + strip.rows);
+    strip.copyTo(rows);
+    nextRow += strip.rows;
+}
+
+PPMStripReader::PPMStripReader(const std::string& path)
+    : file(path, std::ios::binary)
+{
+    if (!file)
+        throw std::invalid_argument("Could not open or find the image!");
+
+    // the header consists of the magic number, the width, the height and the maximum value, separated by whitespace
+    // and comments, followed by a single whitespace before the pixels
+    auto readToken = [&]() {
+        std::string token;
+        int character;
+        while ((character = file.get()) != EOF) {
+            if (character == '#') {
+                while ((character = file.get()) != EOF && character != '\n') {}
+                continue;
+            }
+            if (std::isspace(character)) {
+                if (!token.empty()) break;
+                continue;
+            }
+            token += static_cast<char>(character);
+        }
+        return token;
+    };
+
+    std::string magic = readToken();
+    std::string width = readToken();
+    std::string height = readToken();
+    std::string maxValue = readToken();
+    if (magic != "P6" || maxValue != "255" || width.empty() || height.empty()
+        || width.find_first_not_of("0123456789") != std::string::npos
+        || height.find_first_not_of("0123456789") != std::string::npos)
+        throw std::invalid_argument("Only binary PPM images with 8 bits per channel can be read in strips!");
+
+    rows = std::stoi(height);
+    cols = std::stoi(width);
+    type = CV_8UC3;
+    dataOffset = file.tellg();
+    rowBuffer.resize(static_cast<size_t>(cols) * 3);
+}
+
+void PPMStripReader::Read(int firstRow, cv::Mat& strip)
+{
+    file.seekg(dataOffset + static_cast<std::streamoff>(firstRow) * cols * 3);
+    for (int i = 0; i < strip.rows; i++) {
+        if (!file.read(reinterpret_cast<char*>(rowBuffer.data()), rowBuffer.size()))
+            throw std::invalid_argument("The PPM image ends before its last row!");
+        SwapRedBlue(rowBuffer.data(), strip.ptr<uchar>(i), cols);
+    }
+}
+
+PPMStripWriter::PPMStripWriter(const std::string& path, int rows, int cols)
+    : file(path, std::ios::binary)
+{
+    if (!file)
+        throw std::invalid_argument("Could not save the image " + path + "!");
+
+    file << "P6\n" << cols << " " << rows << "\n255\n";
+    rowBuffer.resize(static_cast<size_t>(cols) * 3);
+}
+
+void PPMStripWriter::Write(const cv::Mat& strip)
+{
+    for (int i = 0; i < strip.rows; i++) {
+        SwapRedBlue(strip.ptr<uchar>(i), rowBuffer.data(), strip.cols);
+        file.write(reinterpret_cast<const char*>(rowBuffer.data()), rowBuffer.size());
+    }
+}
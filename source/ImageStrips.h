@@ -0,0 +1,122 @@
+#pragma once
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <opencv2/opencv.hpp>
+#include "RawImage.h"
+
+/// <summary>
+/// Reads an image in horizontal strips of rows, so that images larger than the memory can be filtered.
+/// </summary>
+class StripReader
+{
+public:
+    virtual ~StripReader() {}
+
+    /// <summary>
+    /// Opens an image to be read in strips, which is chosen by the extension of its path.
+    /// Throws an invalid_argument exception if the image could not be opened or its format cannot be read in strips.
+    /// </summary>
+    /// <param name="path">The file path of a raw or binary PPM image</param>
+    /// <returns></returns>
+    static std::unique_ptr<StripReader> Open(const std::string& path);
+
+    int GetRows() const { return rows; }
+    int GetCols() const { return cols; }
+    int GetType() const { return type; }
+
+    /// <summary>
+    /// Reads consecutive rows of the image into the rows of a strip.
+    /// </summary>
+    /// <param name="firstRow">The first row of the image that is read</param>
+    /// <param name="strip">The strip, which has to have the columns and type of the image</param>
+    virtual void Read(int firstRow, cv::Mat& strip) = 0;
+
+protected:
+    int rows = 0;
+    int cols = 0;
+    int type = 0;
+};
+
+/// <summary>
+/// Writes an image in horizontal strips of rows, from top to bottom.
+/// </summary>
+class StripWriter
+{
+public:
+    virtual ~StripWriter() {}
+
+    /// <summary>
+    /// Creates an image to be written in strips, whose format is chosen by the extension of its path.
+    /// Throws an invalid_argument exception if the image could not be created or its format cannot be written in strips.
+    /// </summary>
+    /// <param name="path">The file path of a raw or binary PPM image</param>
+    /// <param name="rows">The number of rows of the image</param>
+    /// <param name="cols">The number of pixels per row</param>
+    /// <param name="type">The OpenCV type of the pixels</param>
+    /// <returns></returns>
+    static std::unique_ptr<StripWriter> Create(const std::string& path, int rows, int cols, int type);
+
+    /// <summary>
+    /// Writes the rows of a strip as the next rows of the image.
+    /// </summary>
+    /// <param name="strip"></param>
+    virtual void Write(const cv::Mat& strip) = 0;
+};
+
+/// <summary>
+/// Reads the rows of a raw image from its mapping, so that only the pages of the read rows are loaded.
+/// </summary>
+class RawStripReader : public StripReader
+{
+public:
+    explicit RawStripReader(const std::string& path);
+    void Read(int firstRow, cv::Mat& strip) override;
+
+private:
+    RawImageFile file;
+};
+
+/// <summary>
+/// Writes the rows of a raw image into its mapping.
+/// </summary>
+class RawStripWriter : public StripWriter
+{
+public:
+    RawStripWriter(const std::string& path, int rows, int cols, int type);
+    void Write(const cv::Mat& strip) override;
+
+private:
+    RawImageFile file;
+    int nextRow = 0;
+};
+
+/// <summary>
+/// Reads the rows of a binary PPM image with 8 bits per channel, converting its RGB pixels to BGR.
+/// </summary>
+class PPMStripReader : public StripReader
+{
+public:
+    explicit PPMStripReader(const std::string& path);
+    void Read(int firstRow, cv::Mat& strip) override;
+
+private:
+    std::ifstream file;
+    std::streamoff dataOffset = 0;
+    std::vector<uchar> rowBuffer;
+};
+
+/// <summary>
+/// Writes the rows of a binary PPM image with 8 bits per channel, converting BGR pixels to RGB.
+/// </summary>
+class PPMStripWriter : public StripWriter
+{
+public:
+    PPMStripWriter(const std::string& path, int rows, int cols);
+    void Write(const cv::Mat& strip) override;
+
+private:
+    std::ofstream file;
+    std::vector<uchar> rowBuffer;
+};
@@ -0,0 +1,137 @@
+#include "IncrementalFilter.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "FilterPipeline.h"
+#include "TileScheduler.h"
+
+IncrementalFilter::IncrementalFilter(const std::vector<FilterMethod>& filterMethods, int tileSize)
+    : filterMethods(filterMethods), tileSize(tileSize)
+{
+    if (tileSize < 1)
+        throw std::invalid_argument("The tiles have to be at least one pixel wide!");
+
+    // all filters that are not known to be stencils are expected to be pointwise filters
+    stencilCount = FilterPipeline::FromFilterMethods(filterMethods).GetStencilCount();
+}
+
+void IncrementalFilter::Reset()
+{
+    previousInput.release();
+    previousOutput.release();
+}
+
+void IncrementalFilter::Apply(cv::Mat& frame, bool useOpenMP)
+{
+    if (frame.empty()) return;
+
+    const int rows = frame.rows;
+    const int cols = frame.cols;
+    const size_t pixelBytes = frame.elemSize();
+    tileRows = (rows + tileSize - 1) / tileSize;
+    tileCols = (cols + tileSize - 1) / tileSize;
+
+    if (previousInput.rows != rows || previousInput.cols != cols || previousInput.type() != frame.type()) {
+        previousInput = frame.clone();
+        for (const auto& filter : filterMethods) {
+            filter(frame, useOpenMP);
+        }
+        previousOutput = frame.clone();
+        filteredTiles = GetTileCount();
+        return;
+    }
+
+    // a tile changed if any of its rows differs from the previous input, which is compared with memcmp since that
+    // is vectorized by the C library and stops at the first difference
+    const int tileCount = GetTileCount();
+    changedTiles.assign(tileCount, 0);
+    TileScheduler::ForEach(tileCount, SchedulePolicy::Dynamic, useOpenMP, [&](int tile) {
+        int rowBegin = (tile / tileCols) * tileSize;
+        int rowEnd = std::min(rows, rowBegin + tileSize);
+        int colBegin = (tile % tileCols) * tileSize;
+        size_t tileBytes = static_cast<size_t>(std::min(cols, colBegin + tileSize) - colBegin) * pixelBytes;
+        for (int x = rowBegin; x < rowEnd; x++) {
+            if (memcmp(frame.ptr<uchar>(x) + colBegin * pixelBytes, previousInput.ptr<uchar>(x) + colBegin * pixelBytes, tileBytes) != 0) {
+                changedTiles[tile] = 1;
+                break;
+            }
+        }
+    });
+
+    // a tile has to be filtered again if a changed pixel is within the reach of the stencils above or to its left
+    const int tileReach = (stencilCount + tileSize - 1) / tileSize;
+    dirtyTiles.clear();
+    for (int tile = 0; tile < tileCount; tile++) {
+        int tileRow = tile / tileCols;
+        int tileCol = tile % tileCols;
+        bool dirty = false;
+        for (int row = std::max(0, tileRow - tileReach); row <= tileRow && !dirty; row++) {
+            for (int col = std::max(0, tileCol - tileReach); col <= tileCol && !dirty; col++) {
+                dirty = changedTiles[row * tileCols + col] != 0;
+            }
+        }
+        if (dirty) dirtyTiles.push_back(tile);
+    }
+    filteredTiles = static_cast<int>(dirtyTiles.size());
+
+    const int dirtyCount = filteredTiles;
+    TileScheduler::ForEach(dirtyCount, SchedulePolicy::Dynamic, useOpenMP, [&](int i) {
+        FilterTile(frame, dirtyTiles[i]);
+    });
+
+    // the changed tiles become the previous input before the frame is replaced by the output
+    TileScheduler::ForEach(tileCount, SchedulePolicy::Dynamic, useOpenMP, [&](int tile) {
+        if (!changedTiles[tile]) return;
+        int rowBegin = (tile / tileCols) * tileSize;
+        int rowEnd = std::min(rows, rowBegin + tileSize);
+        int colBegin = (tile % tileCols) * tileSize;
+        size_t tileBytes = static_cast<size_t>(std::min(cols, colBegin + tileSize) - colBegin) * pixelBytes;
+        for (int x = rowBegin; x < rowEnd; x++) {
+            memcpy(previousInput.ptr<uchar>(x) + colBegin * pixelBytes, frame.ptr<uchar>(x) + colBegin * pixelBytes, tileBytes);
+        }
+    });
+
+    previousOutput.copyTo(frame);
+}
+
+void IncrementalFilter::FilterTile(const cv::Mat& frame, int tile)
+{
+    const size_t pixelBytes = frame.elemSize();
+    const int rowBegin = (tile / tileCols) * tileSize;
+    const int rowEnd = std::min(frame.rows, rowBegin + tileSize);
+    const int colBegin = (tile % tileCols) * tileSize;
+    const int colEnd = std::min(frame.cols, colBegin + tileSize);
+
+    // the tile is filtered together with the rows above and columns to the left that the stencils read, whose own
+    // results are wrong at the border of the copy and thrown away. At the border of the frame they are missing, just
+    // like when the whole frame is filtered
+    const int haloRows = std::min(stencilCount, rowBegin);
+    const int haloCols = std::min(stencilCount, colBegin);
+    const int copyRows = haloRows + rowEnd - rowBegin;
+    const int copyCols = haloCols + colEnd - colBegin;
+    const size_t copyRowBytes = static_cast<size_t>(copyCols) * pixelBytes;
+
+    // every thread keeps its copy between the tiles and frames, the filters run without OpenMP since the tiles are
+    // already filtered in parallel
+    static thread_local std::vector<uchar> copyBuffer;
+    copyBuffer.resize(copyRows * copyRowBytes);
+    cv::Mat copy(copyRows, copyCols, frame.type(), copyBuffer.data());
+    for (int x = 0; x < copyRows; x++) {
+        memcpy(copy.ptr<uchar>(x), frame.ptr<uchar>(rowBegin - haloRows + x) + (colBegin - haloCols) * pixelBytes, copyRowBytes);
+    }
+
+    for (const auto& filter : filterMethods) {
+        filter(copy, false);
+    }
+
+    // the filters may change the channels of the frame, e.g. into a single-channel grayscale, so the tile is copied
+    // with the pixels of the output
+    if (copy.type() != previousOutput.type())
+        throw std::invalid_argument("The filters returned a tile of another type than the previous output!");
+    const size_t outputPixelBytes = previousOutput.elemSize();
+    const size_t tileRowBytes = static_cast<size_t>(colEnd - colBegin) * outputPixelBytes;
+    for (int x = rowBegin; x < rowEnd; x++) {
+        memcpy(previousOutput.ptr<uchar>(x) + colBegin * outputPixelBytes,
+            copy.ptr<uchar>(haloRows + x - rowBegin) + haloCols * outputPixelBytes, tileRowBytes);
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+/// <summary>
+/// Applies a chain of filters on a stream of frames, re-filtering only the tiles that depend on pixels that changed
+/// since the previous frame. The filtered pixels of all other tiles are taken from the previous output. Every stencil
+/// filter in the chain reads the pixels one row above and one column to the left, so a changed pixel also changes
+/// the tiles to the right and below it, and every re-filtered tile is filtered together with that many rows above and
+/// columns to the left of it. The results are identical to filtering the whole frame.
+/// </summary>
+class IncrementalFilter
+{
+public:
+    typedef std::function<void(cv::Mat&, bool)> FilterMethod;
+
+    /// <summary>
+    /// Creates an incremental filter without a previous frame.
+    /// </summary>
+    /// <param name="filterMethods">The image filter methods in the order they should be run</param>
+    /// <param name="tileSize">The width and height of the tiles in pixels</param>
+    IncrementalFilter(const std::vector<FilterMethod>& filterMethods, int tileSize = 64);
+
+    /// <summary>
+    /// Filters a frame in place. The whole frame is filtered if it is the first frame or its size or type differs
+    /// from the previous frame.
+    /// </summary>
+    /// <param name="frame">The frame, which is replaced by the filtered frame</param>
+    /// <param name="useOpenMP">Wether to compare and filter the tiles in parallel</param>
+    void Apply(cv::Mat& frame, bool useOpenMP);
+
+    /// <summary>
+    /// Forgets the previous frame, so that the next frame is filtered as a whole.
+    /// </summary>
+    void Reset();
+
+    int GetTileCount() const { return tileRows * tileCols; }
+    int GetFilteredTileCount() const { return filteredTiles; }
+
+private:
+    std::vector<FilterMethod> filterMethods;
+    int tileSize;
+    int stencilCount;
+    int tileRows = 0;
+    int tileCols = 0;
+    int filteredTiles = 0;
+    cv::Mat previousInput;
+    cv::Mat previousOutput;
+    std::vector<char> changedTiles;
+    std::vector<int> dirtyTiles;
+
+    void FilterTile(const cv::Mat& frame, int tile);
+};
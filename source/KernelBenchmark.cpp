@@ -0,0 +1,508 @@
+#include "KernelBenchmark.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include "FilterPipeline.h"
+#include "ImageFilter.h"
+#include "ScheduleTuner.h"
+#include "SimdKernels.h"
+#include "TileScheduler.h"
+
+// the throughput is only measured on images large enough to be spread over the threads
+static const int MinimumThroughputPixels = 64 * 1024;
+static const int MinimumRepetitions = 5;
+static const double MinimumSeconds = 0.1;
+
+// the checksums of the golden outputs on the images of GetSizes in their order. They were computed once from the
+// original per-pixel ImageFilter methods, which computed every pixel in floating point before any kernel was
+// vectorized, the single-channel grayscale as the first channel of the original grayscale. The references share
+// their pixel functions with the kernels, so only the golden outputs catch a change of the pixel functions
+static const std::map<std::string, std::vector<uint64_t>> GoldenChecksums = {
+    { "Grayscale", {
+        0x78094039b8cb9c22ull, 0x66299e9ccfc0d1dfull, 0x9d2729aed253beaaull, 0xad31b27b171766f7ull,
+        0xf20fb4038c78bc08ull, 0xf3426380027dd684ull, 0x029ff3a83d7bcc8bull, 0x1b7e03d1e1e53c27ull,
+        0x8e10e1fd4e6ca2d4ull, 0xf8a51967331be8d8ull, 0x6684b0f8af63d709ull
+    } },
+    { "GrayscaleSingleChannel", {
+        0x73601f582dbc04ecull, 0x142430570cd10863ull, 0xfcdc046b2f06d9b8ull, 0x679a8efa946572f3ull,
+        0x9c044f1cde89a92cull, 0x2e5ddf6ed78e30a0ull, 0x3127bf36b6586a6bull, 0x776ba37617d1c1adull,
+        0x32094dabe74198daull, 0x52f49e3584feaefeull, 0xe508b3664678b933ull
+    } },
+    { "HSV", {
+        0x02d7503a0779b962ull, 0x193439f6c3b3aef6ull, 0xadbfbc26d4ca2d5dull, 0xe3d2a624699df73full,
+        0xa42e38d01a2fb20full, 0x0034d8570ee2006dull, 0xb88e29bf1a0768aeull, 0xb134b719a5becd78ull,
+        0xbfbbe08ab3b27ad2ull, 0x0b9d96666e4d377cull, 0x2708b0397d2b3ddcull
+    } },
+    { "Emboss", {
+        0xafcd403794ecb6b2ull, 0x4df83f60da986cbcull, 0x910a4df3acba829cull, 0xd8e265a61094f9d0ull,
+        0x7dec78d7ac6dd64dull, 0xb94caa19b1c08a64ull, 0x0eeded7126762260ull, 0x15914d357f328376ull,
+        0x1eee6148256338edull, 0x314164f5578c261aull, 0xa9549466fa6c20abull
+    } },
+    { "HSV+Grayscale+Emboss", {
+        0xafcd403794ecb6b2ull, 0x4df83f60da986cbcull, 0x910a4df3acba829cull, 0x2ccef96ef0056418ull,
+        0x5744fb7be855a7dcull, 0xf0f1f354aa1c38b6ull, 0xe1b0d11262fc7c4aull, 0xdcebb4aa7d358724ull,
+        0x734f6c0834070665ull, 0x7a9057cc2868fd84ull, 0xcc8e8b72b7a90f12ull
+    } },
+    { "GrayscaleSingleChannel+Emboss", {
+        0x7360af582dbcf99cull, 0xe175c6c7b8b65c52ull, 0xdf0d4b59b5611932ull, 0x8da3044723855241ull,
+        0x0063d2d55487b62cull, 0xa0ae3414a7c8bf3bull, 0x09b1e678c1ec253bull, 0xa58c19ad5fbcc47aull,
+        0x06c33ee9b4905cf1ull, 0x84900b37d04a8bc7ull, 0x24b3e0fd0109a0efull
+    } },
+    { "GrayscaleSingleChannel+HSV+Emboss", {
+        0xafcd403794ecb6b2ull, 0x4df83f60da986cbcull, 0x910a4df3acba829cull, 0x2f4ee471b41d3d19ull,
+        0xb378c9596da9d268ull, 0xeac35b6e94321c89ull, 0x9780e7e6faf3bf6bull, 0x5a52b7bfb2280d52ull,
+        0xe7be823b48b550b1ull, 0x2d93a184d9f7e627ull, 0xa44233cb37b20225ull
+    } },
+};
+
+KernelBaseline::KernelBaseline(const std::string& path)
+    : path(path)
+{
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+
+        // the key is everything before the last field, which holds the throughput
+        size_t separator = line.find_last_of(' ');
+        if (separator == std::string::npos)
+            throw std::invalid_argument("The line " + line + " of the kernel baseline " + path + " is invalid!");
+        try {
+            throughputs[line.substr(0, separator)] = std::stod(line.substr(separator + 1));
+        }
+        catch (const std::exception&) {
+            throw std::invalid_argument("The line " + line + " of the kernel baseline " + path + " is invalid!");
+        }
+    }
+}
+
+bool KernelBaseline::Find(const std::string& key, double& megapixelsPerSecond) const
+{
+    auto entry = throughputs.find(key);
+    if (entry == throughputs.end()) return false;
+    megapixelsPerSecond = entry->second;
+    return true;
+}
+
+void KernelBaseline::Set(const std::string& key, double megapixelsPerSecond)
+{
+    throughputs[key] = megapixelsPerSecond;
+}
+
+void KernelBaseline::Save() const
+{
+    std::ofstream file(path);
+    if (!file)
+        throw std::invalid_argument("Could not save the kernel baseline " + path + "!");
+    file << "# kernel size threads backend kernels megapixelsPerSecond" << std::endl;
+    for (const auto& entry : throughputs) {
+        file << entry.first << " " << entry.second << std::endl;
+    }
+}
+
+/// <summary>
+/// Returns the BGR pixels of a row, single-channel rows are expanded into a buffer with three identical channels.
+/// </summary>
+static const uchar* GetBGRRow(const cv::Mat& image, int x, std::vector<uchar>& buffer)
+{
+    if (image.channels() == 3) return image.ptr<uchar>(x);
+    buffer.resize(static_cast<size_t>(image.cols) * 3);
+    SimdKernels::ExpandPlanePixels(image.ptr<uchar>(x), buffer.data(), image.cols);
+    return buffer.data();
+}
+
+static void ReferenceGrayscale(cv::Mat& image)
+{
+    std::vector<uchar> buffer;
+    for (int x = 0; x < image.rows; x++) {
+        if (image.channels() == 1)
+            SimdKernels::GrayscalePlanePixels(GetBGRRow(image, x, buffer), image.ptr<uchar>(x), image.cols);
+        else
+            SimdKernels::GrayscalePixels(image.ptr<uchar>(x), image.ptr<uchar>(x), image.cols);
+    }
+}
+
+static void ReferenceGrayscaleSingleChannel(cv::Mat& image)
+{
+    cv::Mat gray(image.rows, image.cols, CV_8UC1);
+    std::vector<uchar> buffer;
+    for (int x = 0; x < image.rows; x++) {
+        SimdKernels::GrayscalePlanePixels(GetBGRRow(image, x, buffer), gray.ptr<uchar>(x), image.cols);
+    }
+    image = gray;
+}
+
+static void ReferenceHSV(cv::Mat& image)
+{
+    cv::Mat hsv(image.rows, image.cols, CV_8UC3);
+    std::vector<uchar> buffer;
+    for (int x = 0; x < image.rows; x++) {
+        SimdKernels::HSVPixels(GetBGRRow(image, x, buffer), hsv.ptr<uchar>(x), image.cols);
+    }
+    image = hsv;
+}
+
+static void ReferenceEmboss(cv::Mat& image)
+{
+    // the pixels without a top-left neighbor stay gray
+    cv::Mat embossed(image.rows, image.cols, image.type(), cv::Scalar::all(128));
+    const int channels = image.channels();
+    for (int x = 1; x < image.rows; x++) {
+        const uchar* compare = image.ptr<uchar>(x - 1);
+        const uchar* row = image.ptr<uchar>(x) + channels;
+        uchar* dst = embossed.ptr<uchar>(x) + channels;
+        if (channels == 1)
+            SimdKernels::EmbossPlanePixels(compare, row, dst, image.cols - 1);
+        else
+            SimdKernels::EmbossPixels(compare, row, dst, image.cols - 1);
+    }
+    image = embossed;
+}
+
+static std::function<void(cv::Mat&)> ChainReferences(std::vector<std::function<void(cv::Mat&)>> references)
+{
+    return [references](cv::Mat& image) {
+        for (const auto& reference : references) reference(image);
+    };
+}
+
+static void OpenCVGrayscaleSingleChannel(cv::Mat& image)
+{
+    // the weights of the channels in BGR order
+    cv::Mat gray;
+    cv::transform(image, gray, cv::Matx13f(0.07f, 0.72f, 0.21f));
+    image = gray;
+}
+
+static void OpenCVGrayscale(cv::Mat& image)
+{
+    OpenCVGrayscaleSingleChannel(image);
+    cv::cvtColor(image, image, cv::COLOR_GRAY2BGR);
+}
+
+static void OpenCVHSV(cv::Mat& image)
+{
+    // OpenCV halves the hue of 8-bit images to fit it into a byte, the filters save whole degrees truncated to a byte
+    cv::cvtColor(image, image, cv::COLOR_BGR2HSV);
+    for (int x = 0; x < image.rows; x++) {
+        uchar* row = image.ptr<uchar>(x);
+        for (int y = 0; y < image.cols; y++) {
+            row[y * 3] = static_cast<uchar>((row[y * 3] * 2) % 360);
+        }
+    }
+}
+
+static void OpenCVEmboss(cv::Mat& image)
+{
+    cv::Mat embossed(image.rows, image.cols, CV_8UC1, cv::Scalar(128));
+    if (image.rows > 1 && image.cols > 1) {
+        const cv::Rect topLeft(0, 0, image.cols - 1, image.rows - 1);
+        const cv::Rect bottomRight(1, 1, image.cols - 1, image.rows - 1);
+        cv::Mat difference;
+        cv::absdiff(image(bottomRight), image(topLeft), difference);
+
+        std::vector<cv::Mat> channels;
+        cv::split(difference, channels);
+        cv::Mat maximum = channels[0];
+        for (size_t i = 1; i < channels.size(); i++) maximum = cv::max(maximum, channels[i]);
+
+        // the sum saturates at 255 like the filters
+        cv::Mat interior = embossed(bottomRight);
+        cv::add(maximum, cv::Scalar(128), interior);
+    }
+    if (image.channels() == 1) image = embossed;
+    else cv::cvtColor(embossed, image, cv::COLOR_GRAY2BGR);
+}
+
+std::vector<KernelBenchmark::Kernel> KernelBenchmark::GetKernels()
+{
+    const KernelTolerance exact;
+    // OpenCV rounds where the filters truncate, and its hue only has a resolution of two degrees
+    const KernelTolerance rounded{ 1, -1 };
+    const KernelTolerance hsv{ 1, 2 };
+
+    return {
+        { "Grayscale", &ImageFilter::GrayscaleImage, ReferenceGrayscale, "Grayscale", OpenCVGrayscale, rounded, true },
+        { "GrayscaleCollapsed", &ImageFilter::GrayscaleImageCollapsed, ReferenceGrayscale, "Grayscale", OpenCVGrayscale, rounded, false },
+        { "GrayscaleSingleChannel", &ImageFilter::GrayscaleImageSingleChannel, ReferenceGrayscaleSingleChannel,
+            "GrayscaleSingleChannel", OpenCVGrayscaleSingleChannel, rounded, true },
+        { "HSV", &ImageFilter::HSVImage, ReferenceHSV, "HSV", OpenCVHSV, hsv, true },
+        { "HSVCollapsed", &ImageFilter::HSVImageCollapsed, ReferenceHSV, "HSV", OpenCVHSV, hsv, false },
+        { "Emboss", &ImageFilter::EmbossImage, ReferenceEmboss, "Emboss", OpenCVEmboss, exact, true },
+        { "EmbossCollapsed", &ImageFilter::EmbossImageCollapsed, ReferenceEmboss, "Emboss", OpenCVEmboss, exact, false },
+        // the differences to OpenCV would add up over the filters of a pipeline, which are only compared with the golden outputs
+        { "HSV+Grayscale+Emboss", FilterPipeline::FromFilterMethods({ &ImageFilter::HSVImage, &ImageFilter::GrayscaleImage, &ImageFilter::EmbossImage }),
+            ChainReferences({ ReferenceHSV, ReferenceGrayscale, ReferenceEmboss }), "HSV+Grayscale+Emboss", nullptr, exact, true },
+        { "GrayscaleSingleChannel+Emboss", FilterPipeline::FromFilterMethods({ &ImageFilter::GrayscaleImageSingleChannel, &ImageFilter::EmbossImage }),
+            ChainReferences({ ReferenceGrayscaleSingleChannel, ReferenceEmboss }), "GrayscaleSingleChannel+Emboss", nullptr, exact, true },
+        { "GrayscaleSingleChannel+HSV+Emboss", FilterPipeline::FromFilterMethods({ &ImageFilter::GrayscaleImageSingleChannel, &ImageFilter::HSVImage, &ImageFilter::EmbossImage }),
+            ChainReferences({ ReferenceGrayscaleSingleChannel, ReferenceHSV, ReferenceEmboss }), "GrayscaleSingleChannel+HSV+Emboss", nullptr, exact, true },
+    };
+}
+
+std::vector<cv::Size> KernelBenchmark::GetSizes()
+{
+    // the sizes are given as columns and rows
+    return { { 1, 1 }, { 67, 1 }, { 1, 67 }, { 5, 3 }, { 257, 17 }, { 17, 257 }, { 64, 64 }, { 640, 480 },
+        { 4099, 33 }, { 33, 4099 }, { 1920, 1080 } };
+}
+
+cv::Mat KernelBenchmark::CreateImage(int rows, int cols)
+{
+    // gray pixels take the branch of hsv without a hue, saturated pixels the branches of every maximum channel and
+    // the noise next to them the clamping of embossing
+    std::minstd_rand random(static_cast<unsigned>(rows) * 7919u + static_cast<unsigned>(cols));
+    cv::Mat image(rows, cols, CV_8UC3);
+    for (int x = 0; x < rows; x++) {
+        for (int y = 0; y < cols; y++) {
+            cv::Vec3b& pixel = image.at<cv::Vec3b>(x, y);
+            switch ((x * 3 + y) % 16) {
+            case 0:
+                pixel = cv::Vec3b::all(static_cast<uchar>(random()));
+                break;
+            case 1:
+                for (int c = 0; c < 3; c++) pixel[c] = (random() & 1) ? 255 : 0;
+                break;
+            case 2:
+                pixel = cv::Vec3b(static_cast<uchar>(x * 255 / rows), static_cast<uchar>(y * 255 / cols), static_cast<uchar>(x + y));
+                break;
+            default:
+                for (int c = 0; c < 3; c++) pixel[c] = static_cast<uchar>(random());
+                break;
+            }
+        }
+    }
+    return image;
+}
+
+uint64_t KernelBenchmark::GetChecksum(const cv::Mat& image)
+{
+    uint64_t checksum = 14695981039346656037ull;
+    auto add = [&checksum](uchar byte) {
+        checksum = (checksum ^ byte) * 1099511628211ull;
+    };
+    for (int value : { image.rows, image.cols, image.channels() }) {
+        for (int shift = 0; shift < 32; shift += 8) add(static_cast<uchar>(value >> shift));
+    }
+    for (int x = 0; x < image.rows; x++) {
+        const uchar* row = image.ptr<uchar>(x);
+        for (size_t i = 0; i < image.cols * image.elemSize(); i++) add(row[i]);
+    }
+    return checksum;
+}
+
+/// <summary>
+/// Returns the distance of two hues on the hue circle. The filters save the hue in degrees truncated to a byte, so
+/// a saved hue h is either h or h + 256 degrees if that is below 360.
+/// </summary>
+static int GetHueDifference(int first, int second)
+{
+    int difference = 360;
+    for (int firstHue = first; firstHue < 360; firstHue += 256) {
+        for (int secondHue = second; secondHue < 360; secondHue += 256) {
+            int distance = std::abs(firstHue - secondHue);
+            difference = std::min({ difference, distance, 360 - distance });
+        }
+    }
+    return difference;
+}
+
+static std::string GetSizeName(const cv::Mat& image)
+{
+    return std::to_string(image.cols) + "x" + std::to_string(image.rows) + "x" + std::to_string(image.channels());
+}
+
+bool KernelBenchmark::Compare(const cv::Mat& expected, const cv::Mat& actual, const KernelTolerance& tolerance,
+    std::string& mismatch)
+{
+    if (expected.size() != actual.size() || expected.type() != actual.type()) {
+        mismatch = "the image is " + GetSizeName(actual) + " instead of " + GetSizeName(expected);
+        return false;
+    }
+
+    const int channels = expected.channels();
+    for (int x = 0; x < expected.rows; x++) {
+        const uchar* expectedRow = expected.ptr<uchar>(x);
+        const uchar* actualRow = actual.ptr<uchar>(x);
+        for (int i = 0; i < expected.cols * channels; i++) {
+            const bool hue = tolerance.hue >= 0 && i % channels == 0;
+            const int difference = hue ? GetHueDifference(expectedRow[i], actualRow[i]) : std::abs(expectedRow[i] - actualRow[i]);
+            if (difference > (hue ? tolerance.hue : tolerance.value)) {
+                mismatch = "pixel (" + std::to_string(x) + ", " + std::to_string(i / channels) + ") channel "
+                    + std::to_string(i % channels) + " is " + std::to_string(actualRow[i]) + " instead of "
+                    + std::to_string(expectedRow[i]);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+/// <summary>
+/// The settings a kernel is checked with.
+/// </summary>
+struct KernelVariant
+{
+    SimdLevel level;
+    bool lookupTables;
+    TileSchedule schedule;
+    bool useOpenMP;
+
+    std::string GetName() const {
+        return std::string(SimdKernels::GetKernels(level).name) + (lookupTables ? ", lookup tables, " : ", ")
+            + schedule.GetName() + (useOpenMP ? ", threads" : ", single thread");
+    }
+};
+
+/// <summary>
+/// Returns the settings a kernel is checked with. Dispatched kernels are checked with every supported instruction
+/// set level, with and without lookup tables and with whole rows and small tiles whose borders fall inside the
+/// vectors, the other kernels only with the active settings.
+/// </summary>
+static std::vector<KernelVariant> GetVariants(bool dispatched)
+{
+    const SimdLevel activeLevel = SimdKernels::GetKernels().level;
+    const bool activeLookupTables = SimdKernels::IsUsingLookupTables();
+    const TileSchedule activeSchedule = TileScheduler::GetSchedule();
+
+    std::vector<KernelVariant> variants;
+    for (bool useOpenMP : { false, true }) {
+        if (!dispatched) {
+            variants.push_back({ activeLevel, activeLookupTables, activeSchedule, useOpenMP });
+            continue;
+        }
+        for (int level = 0; level <= static_cast<int>(SimdKernels::DetectSimdLevel()); level++) {
+            for (bool lookupTables : { false, true }) {
+                for (const TileSchedule& schedule : { TileSchedule(), TileSchedule{ SchedulePolicy::Static, 3, 7 },
+                    TileSchedule{ SchedulePolicy::WorkStealing, 1, 64 } }) {
+                    variants.push_back({ static_cast<SimdLevel>(level), lookupTables, schedule, useOpenMP });
+                }
+            }
+        }
+    }
+    return variants;
+}
+
+/// <summary>
+/// Returns the median throughput of a filter in megapixels per second. The filter runs once unmeasured and then at
+/// least MinimumRepetitions times, until the repetitions took MinimumSeconds.
+/// </summary>
+static double MeasureThroughput(const KernelBenchmark::FilterMethod& filter, const cv::Mat& image, bool useOpenMP)
+{
+    cv::Mat copy;
+    image.copyTo(copy);
+    filter(copy, useOpenMP);
+
+    std::vector<double> durations;
+    double totalDuration = 0;
+    while (static_cast<int>(durations.size()) < MinimumRepetitions || totalDuration < MinimumSeconds) {
+        image.copyTo(copy);
+        auto begin = std::chrono::high_resolution_clock::now();
+        filter(copy, useOpenMP);
+        double duration = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+        durations.push_back(duration);
+        totalDuration += duration;
+    }
+
+    std::nth_element(durations.begin(), durations.begin() + durations.size() / 2, durations.end());
+    return static_cast<double>(image.total()) / 1e6 / durations[durations.size() / 2];
+}
+
+int KernelBenchmark::Run(KernelBaseline& baseline, double threshold, bool updateBaseline, bool useOpenMP)
+{
+    const SimdLevel activeLevel = SimdKernels::GetKernels().level;
+    const bool activeLookupTables = SimdKernels::IsUsingLookupTables();
+    const TileSchedule activeSchedule = TileScheduler::GetSchedule();
+    const std::vector<Kernel> kernels = GetKernels();
+    const std::vector<cv::Size> sizes = GetSizes();
+    int failures = 0;
+
+    for (const Kernel& kernel : kernels) {
+        const std::vector<KernelVariant> variants = GetVariants(kernel.dispatched);
+        int runs = 0;
+        int kernelFailures = 0;
+        std::string mismatch;
+
+        for (size_t sizeIndex = 0; sizeIndex < sizes.size(); sizeIndex++) {
+            const cv::Mat image = CreateImage(sizes[sizeIndex].height, sizes[sizeIndex].width);
+            cv::Mat expected = image.clone();
+            kernel.reference(expected);
+
+            // the reference is checked against the golden outputs and OpenCV, the kernels against the reference
+            auto golden = GoldenChecksums.find(kernel.golden);
+            if (golden == GoldenChecksums.end() || sizeIndex >= golden->second.size()) {
+                std::cout << "FAIL " << kernel.name << " " << GetSizeName(image) << ": there is no golden output" << std::endl;
+                kernelFailures++;
+            }
+            else if (GetChecksum(expected) != golden->second[sizeIndex]) {
+                std::cout << "FAIL " << kernel.name << " " << GetSizeName(image) << ": the reference differs from the golden output" << std::endl;
+                kernelFailures++;
+            }
+            if (kernel.openCV) {
+                cv::Mat equivalent = image.clone();
+                kernel.openCV(equivalent);
+                if (!Compare(equivalent, expected, kernel.openCVTolerance, mismatch)) {
+                    std::cout << "FAIL " << kernel.name << " " << GetSizeName(image) << " OpenCV: " << mismatch << std::endl;
+                    kernelFailures++;
+                }
+            }
+
+            for (const KernelVariant& variant : variants) {
+                SimdKernels::SetSimdLevel(variant.level);
+                SimdKernels::SetLookupTables(variant.lookupTables);
+                TileScheduler::SetSchedule(variant.schedule);
+
+                cv::Mat output = image.clone();
+                kernel.filter(output, variant.useOpenMP);
+                runs++;
+                if (!Compare(expected, output, KernelTolerance(), mismatch)) {
+                    std::cout << "FAIL " << kernel.name << " " << GetSizeName(image) << " " << variant.GetName() << ": "
+                        << mismatch << std::endl;
+                    kernelFailures++;
+                }
+            }
+        }
+
+        SimdKernels::SetSimdLevel(activeLevel);
+        SimdKernels::SetLookupTables(activeLookupTables);
+        TileScheduler::SetSchedule(activeSchedule);
+
+        std::cout << kernel.name << ": " << runs << " runs on " << sizes.size() << " sizes, "
+            << (kernelFailures == 0 ? "all identical to the golden output" : std::to_string(kernelFailures) + " failed")
+            << (kernel.openCV ? " and within the tolerance of OpenCV" : "") << std::endl;
+        failures += kernelFailures;
+    }
+
+    // the throughputs are measured with the active settings and only compared with baselines of the same settings
+    const int threads = useOpenMP ? TileScheduler::GetThreadCount() : 1;
+    for (const Kernel& kernel : kernels) {
+        for (const cv::Size& size : sizes) {
+            if (size.area() < MinimumThroughputPixels) continue;
+
+            const cv::Mat image = CreateImage(size.height, size.width);
+            const double megapixelsPerSecond = MeasureThroughput(kernel.filter, image, useOpenMP);
+            const std::string key = TuningCache::GetKey(kernel.name, image, threads);
+            std::cout << kernel.name << " " << GetSizeName(image) << ": " << megapixelsPerSecond << " MP/s";
+
+            double baselineMegapixelsPerSecond = 0;
+            if (updateBaseline || !baseline.Find(key, baselineMegapixelsPerSecond)) {
+                baseline.Set(key, megapixelsPerSecond);
+                std::cout << " (new baseline)" << std::endl;
+                continue;
+            }
+
+            std::cout << " (baseline " << baselineMegapixelsPerSecond << " MP/s, "
+                << std::showpos << (megapixelsPerSecond / baselineMegapixelsPerSecond - 1) * 100 << std::noshowpos << "%)";
+            if (megapixelsPerSecond < baselineMegapixelsPerSecond * (1 - threshold)) {
+                std::cout << " FAIL";
+                failures++;
+            }
+            std::cout << std::endl;
+        }
+    }
+
+    return failures;
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+/// <summary>
+/// Throughputs of earlier kernel benchmarks, saved in a text file with one throughput per line. The throughputs are
+/// keyed like the tuned schedules by the kernel, the size and channels of the image, the number of threads, the
+/// active backend and the active kernels, since only measurements of the same configuration can be compared.
+/// </summary>
+class KernelBaseline
+{
+public:
+    /// <summary>
+    /// Creates a baseline backed by a file, which is read if it exists.
+    /// Throws an invalid_argument exception if the file contains invalid lines.
+    /// </summary>
+    /// <param name="path">The file path of the baseline</param>
+    explicit KernelBaseline(const std::string& path);
+
+    /// <summary>
+    /// Looks up the throughput of a key.
+    /// </summary>
+    /// <param name="key">The key, see TuningCache::GetKey</param>
+    /// <param name="megapixelsPerSecond">Receives the throughput if the key was found</param>
+    /// <returns>Wether the key was found</returns>
+    bool Find(const std::string& key, double& megapixelsPerSecond) const;
+
+    /// <summary>
+    /// Sets the throughput of a key, which is kept until the baseline is saved.
+    /// </summary>
+    /// <param name="key"></param>
+    /// <param name="megapixelsPerSecond"></param>
+    void Set(const std::string& key, double megapixelsPerSecond);
+
+    /// <summary>
+    /// Saves the baseline to its file.
+    /// Throws an invalid_argument exception if the file cannot be written.
+    /// </summary>
+    void Save() const;
+
+private:
+    std::string path;
+    std::map<std::string, double> throughputs;
+};
+
+/// <summary>
+/// Differences between the output of a kernel and a reference that are still accepted.
+/// </summary>
+struct KernelTolerance
+{
+    // the largest difference of any channel
+    int value = 0;
+    // the largest difference of the hue channel of hsv images in degrees on the hue circle, -1 if the first channel
+    // is compared like the others
+    int hue = -1;
+};
+
+/// <summary>
+/// Checks the ImageFilter kernels, their collapsed variants and fused pipelines on synthetic images of many sizes and
+/// aspect ratios, which are created in memory. The output of every kernel has to be identical to a reference built
+/// from the scalar pixel functions for every instruction set level, with and without lookup tables, threads and
+/// tiles. The references have to reproduce the frozen checksums of the golden outputs of the original per-pixel
+/// filters and match OpenCV within a tolerance. Afterwards the throughput of every kernel on the larger images is
+/// measured and compared with a baseline of an earlier run.
+/// </summary>
+class KernelBenchmark
+{
+public:
+    typedef std::function<void(cv::Mat&, bool)> FilterMethod;
+
+    /// <summary>
+    /// A kernel that is checked and measured.
+    /// </summary>
+    struct Kernel
+    {
+        std::string name;
+        FilterMethod filter;
+        // applies the same filters with the scalar pixel functions
+        std::function<void(cv::Mat&)> reference;
+        // the name of the golden outputs the reference has to reproduce, which kernels of the same filters share
+        std::string golden;
+        // applies the same filters with OpenCV, or nothing if there is no equivalent
+        std::function<void(cv::Mat&)> openCV;
+        KernelTolerance openCVTolerance;
+        // wether the kernel uses the row kernels of the instruction set levels and the schedule, and is checked with
+        // all of them
+        bool dispatched;
+    };
+
+    /// <summary>
+    /// Returns all kernels that are checked: every ImageFilter method and the fused pipelines of the filter chains.
+    /// </summary>
+    /// <returns></returns>
+    static std::vector<Kernel> GetKernels();
+
+    /// <summary>
+    /// Returns the sizes of the synthetic images as rows and columns, from single pixels and rows to wide, tall and
+    /// full HD images, so that the remaining pixels of the vectorized kernels and the tile borders are covered.
+    /// </summary>
+    /// <returns></returns>
+    static std::vector<cv::Size> GetSizes();
+
+    /// <summary>
+    /// Creates a deterministic BGR image of noise, gradients, gray and fully saturated pixels.
+    /// </summary>
+    /// <param name="rows"></param>
+    /// <param name="cols"></param>
+    /// <returns></returns>
+    static cv::Mat CreateImage(int rows, int cols);
+
+    /// <summary>
+    /// Returns the 64-bit FNV-1a hash of the size, the channels and the pixels of an 8-bit image, as which the golden
+    /// outputs are frozen.
+    /// </summary>
+    /// <param name="image"></param>
+    /// <returns></returns>
+    static uint64_t GetChecksum(const cv::Mat& image);
+
+    /// <summary>
+    /// Compares the output of a kernel with a reference.
+    /// </summary>
+    /// <param name="expected">The output of the reference</param>
+    /// <param name="actual">The output of the kernel</param>
+    /// <param name="tolerance">The accepted differences</param>
+    /// <param name="mismatch">Receives a description of the first pixel that differs too much</param>
+    /// <returns>Wether the images have the same size and channels and all differences are accepted</returns>
+    static bool Compare(const cv::Mat& expected, const cv::Mat& actual, const KernelTolerance& tolerance,
+        std::string& mismatch);
+
+    /// <summary>
+    /// Checks and measures every kernel with the active backend and number of threads and prints the results. The
+    /// throughputs are measured with the active instruction set level, lookup tables and schedule, which are restored
+    /// after the checks.
+    /// </summary>
+    /// <param name="baseline">The throughputs of an earlier run, which receives the throughputs it does not have yet</param>
+    /// <param name="threshold">The fraction by which a throughput may drop below the baseline, e.g. 0.1</param>
+    /// <param name="updateBaseline">Wether to replace the throughputs of the baseline instead of comparing with them</param>
+    /// <param name="useOpenMP">Wether the throughput is measured with threads or not</param>
+    /// <returns>The number of failed checks</returns>
+    static int Run(KernelBaseline& baseline, double threshold, bool updateBaseline, bool useOpenMP);
+};
@@ -0,0 +1,68 @@
+#include "LookupTables.h"
+#include <vector>
+
+const double* LookupTables::GetGrayscaleTables()
+{
+    // the products are computed exactly like in the grayscale kernels, so that their sum is identical
+    static const std::vector<double> tables = []() {
+        std::vector<double> weighted(3 * 256);
+        for (int value = 0; value < 256; value++) {
+            weighted[value] = 0.21 * value;
+            weighted[256 + value] = 0.72 * value;
+            weighted[512 + value] = 0.07 * value;
+        }
+        return weighted;
+    }();
+    return tables.data();
+}
+
+const uchar* LookupTables::GetHSVTable()
+{
+    static const std::vector<uchar> table = []() {
+        // every row of the table holds the 256 blue values of one red and green value, which are filtered by the
+        // vectorized kernel like a row of an image
+        PointRowKernel hsvRow = SimdKernels::GetKernels(SimdKernels::DetectSimdLevel()).hsvRow;
+        std::vector<uchar> colors(size_t(3) << 24);
+
+        #pragma omp parallel for schedule(static)
+        for (int redGreen = 0; redGreen < 65536; redGreen++) {
+            uchar* row = colors.data() + static_cast<size_t>(redGreen) * 256 * 3;
+            for (int blue = 0; blue < 256; blue++) {
+                row[3 * blue] = static_cast<uchar>(blue);
+                row[3 * blue + 1] = static_cast<uchar>(redGreen & 0xFF);
+                row[3 * blue + 2] = static_cast<uchar>(redGreen >> 8);
+            }
+            hsvRow(row, row, 256);
+        }
+        return colors;
+    }();
+    return table.data();
+}
+
+void LookupTables::GrayscaleRow(const uchar* src, uchar* dst, int cols)
+{
+    const double* tables = GetGrayscaleTables();
+    for (int i = 0; i < cols; i++, src += 3, dst += 3) {
+        uchar gray = static_cast<uchar>(tables[src[2]] + tables[256 + src[1]] + tables[512 + src[0]]);
+        dst[0] = dst[1] = dst[2] = gray;
+    }
+}
+
+void LookupTables::GrayscalePlaneRow(const uchar* src, uchar* dst, int cols)
+{
+    const double* tables = GetGrayscaleTables();
+    for (int i = 0; i < cols; i++, src += 3) {
+        dst[i] = static_cast<uchar>(tables[src[2]] + tables[256 + src[1]] + tables[512 + src[0]]);
+    }
+}
+
+void LookupTables::HSVRow(const uchar* src, uchar* dst, int cols)
+{
+    const uchar* table = GetHSVTable();
+    for (int i = 0; i < cols; i++, src += 3, dst += 3) {
+        const uchar* hsv = table + ((static_cast<size_t>(src[2]) << 16) | (src[1] << 8) | src[0]) * 3;
+        dst[0] = hsv[0];
+        dst[1] = hsv[1];
+        dst[2] = hsv[2];
+    }
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include "SimdKernels.h"
+
+/// <summary>
+/// Lookup tables for the pointwise filters, which map every BGR pixel to its filtered pixel with table reads instead
+/// of arithmetic. The tables are built on first use, once per process, and shared by all threads. Their results are
+/// identical to the kernels they replace.
+/// </summary>
+class LookupTables
+{
+public:
+    /// <summary>
+    /// Returns the weighted channel values of the grayscale filter, 256 doubles for red, green and blue each, which
+    /// are added in the same order as the grayscale kernels add the products.
+    /// </summary>
+    /// <returns></returns>
+    static const double* GetGrayscaleTables();
+
+    /// <summary>
+    /// Returns the hsv filtered pixel of every 24-bit color, 3 bytes per color at the index
+    /// (red * 65536 + green * 256 + blue) * 3. The 48 MiB table is computed by the vectorized hsv kernel of the best
+    /// supported instruction set.
+    /// </summary>
+    /// <returns></returns>
+    static const uchar* GetHSVTable();
+
+    /// <summary>
+    /// Applies the grayscale filter to a row of interleaved BGR pixels with the grayscale tables.
+    /// </summary>
+    static void GrayscaleRow(const uchar* src, uchar* dst, int cols);
+
+    /// <summary>
+    /// Applies the grayscale filter to a row of interleaved BGR pixels with the grayscale tables, writing one gray
+    /// byte per pixel.
+    /// </summary>
+    static void GrayscalePlaneRow(const uchar* src, uchar* dst, int cols);
+
+    /// <summary>
+    /// Applies the hsv filter to a row of interleaved BGR pixels with the hsv table.
+    /// </summary>
+    static void HSVRow(const uchar* src, uchar* dst, int cols);
+};
@@ -0,0 +1,297 @@
+#include <algorithm>
+#include <cmath>
+#include "MPIFilterPlan.h"
+#include "Trace.h"
+
+// persistent collectives are part of MPI-4, older Open MPI versions provide them as an extension
+#if MPI_VERSION >= 4
+#define MPI_FILTER_PLAN_PERSISTENT
+#define ScattervInit MPI_Scatterv_init
+#define GathervInit MPI_Gatherv_init
+#elif defined(OPEN_MPI)
+#include <mpi-ext.h>
+#if defined(OMPI_HAVE_MPI_EXT_PCOLLREQ) && OMPI_HAVE_MPI_EXT_PCOLLREQ
+#define MPI_FILTER_PLAN_PERSISTENT
+#define ScattervInit MPIX_Scatterv_init
+#define GathervInit MPIX_Gatherv_init
+#endif
+#endif
+
+MPIFilterPlan::MPIFilterPlan(int rank, int size, const cv::Mat& hostImage, bool useSharedMemory, MPI_Comm comm)
+    : rank(rank), size(size), position(rank), comm(comm), rowCounts(size), rowDispls(size), rowThroughputs(size, 0.0)
+{
+    int imageProperties[3];
+    if (rank == 0) {
+        if (hostImage.empty())
+            throw std::invalid_argument("Could not open or find the image!");
+
+        imageProperties[0] = hostImage.rows;
+        imageProperties[1] = hostImage.cols;
+        imageProperties[2] = hostImage.type();
+    }
+
+    MPI_Bcast(imageProperties, 3, MPI_INT, 0, comm);
+    rows = imageProperties[0];
+    cols = imageProperties[1];
+    type = imageProperties[2];
+
+    // rows are moved as a single element, which keeps the counts small for large images
+    MPI_Type_contiguous(static_cast<int>(cols * CV_ELEM_SIZE(type)), MPI_UNSIGNED_CHAR, &rowType);
+    MPI_Type_commit(&rowType);
+
+    int sizePerProcess = rows / size;
+    int rest = rows % size;
+    for (int i = 0; i < size; i++) {
+        rowDispls[i] = i * sizePerProcess;
+        rowCounts[i] = (i == size - 1) ? sizePerProcess + rest : sizePerProcess;
+    }
+
+    if (useSharedMemory)
+        CreateNodeCommunicators();
+    else
+        MPI_Comm_dup(comm, &orderedComm);
+
+    Allocate();
+}
+
+MPIFilterPlan::~MPIFilterPlan()
+{
+    Release();
+    if (rowType != MPI_DATATYPE_NULL) MPI_Type_free(&rowType);
+    if (replacedRowType != MPI_DATATYPE_NULL) MPI_Type_free(&replacedRowType);
+    if (leaderComm != MPI_COMM_NULL) MPI_Comm_free(&leaderComm);
+    if (orderedComm != MPI_COMM_NULL) MPI_Comm_free(&orderedComm);
+    if (nodeComm != MPI_COMM_NULL) MPI_Comm_free(&nodeComm);
+}
+
+void MPIFilterPlan::CreateNodeCommunicators()
+{
+    // the processes are ordered by the first process of their node, so that every node holds a consecutive block
+    // of rows. The host process is the first of all processes, so its node holds the first rows
+    MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &nodeComm);
+    MPI_Comm_rank(nodeComm, &nodeRank);
+    MPI_Comm_size(nodeComm, &nodeSize);
+
+    int leader = rank;
+    MPI_Bcast(&leader, 1, MPI_INT, 0, nodeComm);
+    MPI_Comm_split(comm, 0, leader * size + rank, &orderedComm);
+    MPI_Comm_rank(orderedComm, &position);
+    MPI_Comm_split(comm, (nodeRank == 0) ? 0 : MPI_UNDEFINED, rank, &leaderComm);
+}
+
+void MPIFilterPlan::Allocate()
+{
+    const size_t rowBytes = static_cast<size_t>(cols) * CV_ELEM_SIZE(type);
+
+    if (!UsesSharedMemory()) {
+        if (rank == 0 && image.empty()) image = cv::Mat(rows, cols, type);
+        partialImage = cv::Mat(rowCounts[rank], cols, type);
+        planPartialImage = partialImage;
+        haloExchange = std::make_unique<MPIHaloExchange>(rank, size, rowCounts, cols, type, orderedComm);
+
+#ifdef MPI_FILTER_PLAN_PERSISTENT
+        // the image on the host process is both the source of the scatter and the destination of the gather, since
+        // the partial images are filtered in between
+        ScattervInit(image.data, rowCounts.data(), rowDispls.data(), rowType,
+            partialImage.data, rowCounts[rank], rowType, 0, comm, MPI_INFO_NULL, &scatterRequest);
+        GathervInit(partialImage.data, rowCounts[rank], rowType,
+            image.data, rowCounts.data(), rowDispls.data(), rowType, 0, comm, MPI_INFO_NULL, &gatherRequest);
+#endif
+        return;
+    }
+
+    int nodeBegin = position - nodeRank;
+    int nodeRowDispl = rowDispls[nodeBegin];
+    int nodeRowCount = 0;
+    for (int i = nodeBegin; i < nodeBegin + nodeSize; i++) nodeRowCount += rowCounts[i];
+
+    if (leaderComm != MPI_COMM_NULL) {
+        int leaderCount;
+        MPI_Comm_size(leaderComm, &leaderCount);
+        nodeRowCounts.resize(leaderCount);
+        nodeRowDispls.resize(leaderCount);
+        MPI_Gather(&nodeRowCount, 1, MPI_INT, nodeRowCounts.data(), 1, MPI_INT, 0, leaderComm);
+        MPI_Gather(&nodeRowDispl, 1, MPI_INT, nodeRowDispls.data(), 1, MPI_INT, 0, leaderComm);
+    }
+
+    // the first process of every node allocates the rows of the node, the host process the whole image, which
+    // the other nodes gather their rows into
+    MPI_Aint windowBytes = (nodeRank != 0) ? 0 : static_cast<MPI_Aint>((rank == 0) ? rows : nodeRowCount) * rowBytes;
+    uchar* windowData;
+    MPI_Win_allocate_shared(windowBytes, 1, MPI_INFO_NULL, nodeComm, &windowData, &window);
+
+    MPI_Aint nodeBytes;
+    int dispUnit;
+    uchar* nodeData;
+    MPI_Win_shared_query(window, 0, &nodeBytes, &dispUnit, &nodeData);
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, window);
+
+    if (rank == 0) image = cv::Mat(rows, cols, type, nodeData);
+    nodeImage = cv::Mat(nodeRowCount, cols, type, nodeData);
+    partialImage = cv::Mat(rowCounts[position], cols, type, nodeData + (rowDispls[position] - nodeRowDispl) * rowBytes);
+    planPartialImage = partialImage;
+    haloExchange = std::make_unique<MPIHaloExchange>(position, size, rowCounts, cols, type, orderedComm);
+}
+
+void MPIFilterPlan::Release()
+{
+    haloExchange.reset();
+    if (scatterRequest != MPI_REQUEST_NULL) MPI_Request_free(&scatterRequest);
+    if (gatherRequest != MPI_REQUEST_NULL) MPI_Request_free(&gatherRequest);
+
+    if (window != MPI_WIN_NULL) {
+        // the image of the host process lives in the window
+        image.release();
+        nodeImage.release();
+        partialImage.release();
+        planPartialImage.release();
+        MPI_Win_unlock_all(window);
+        MPI_Win_free(&window);
+    }
+}
+
+void MPIFilterPlan::SynchronizeNode()
+{
+    // makes the rows written by every process of the node visible to all others
+    MPI_Win_sync(window);
+    MPI_Barrier(nodeComm);
+    MPI_Win_sync(window);
+}
+
+bool MPIFilterPlan::Balance(double filterSeconds)
+{
+    // the throughput is measured in rows per second, processes without rows keep their previous throughput
+    double throughput = (rowCounts[position] > 0 && filterSeconds > 0) ? rowCounts[position] / filterSeconds : 0.0;
+    std::vector<double> throughputs(size);
+    {
+        TraceScope scope(TraceCategory::MPI, "balance");
+        MPI_Allgather(&throughput, 1, MPI_DOUBLE, throughputs.data(), 1, MPI_DOUBLE, orderedComm);
+    }
+
+    // the throughputs are smoothed over the repetitions, so that a single slow repetition does not move all rows
+    double totalThroughput = 0;
+    int measured = 0;
+    for (int i = 0; i < size; i++) {
+        if (throughputs[i] > 0)
+            rowThroughputs[i] = (rowThroughputs[i] > 0) ? 0.5 * rowThroughputs[i] + 0.5 * throughputs[i] : throughputs[i];
+        if (rowThroughputs[i] > 0) {
+            totalThroughput += rowThroughputs[i];
+            measured++;
+        }
+    }
+    if (measured == 0) return false;
+
+    std::vector<double> weights(size);
+    double totalWeight = 0;
+    for (int i = 0; i < size; i++) {
+        weights[i] = (rowThroughputs[i] > 0) ? rowThroughputs[i] : totalThroughput / measured;
+        totalWeight += weights[i];
+    }
+
+    // every process gets rows in proportion to its throughput
+    std::vector<int> balancedCounts(size);
+    std::vector<int> balancedDispls(size);
+    double cumulativeWeight = 0;
+    for (int i = 0; i < size; i++) {
+        balancedDispls[i] = static_cast<int>(std::lround(rows * cumulativeWeight / totalWeight));
+        cumulativeWeight += weights[i];
+        int end = (i == size - 1) ? rows : static_cast<int>(std::lround(rows * cumulativeWeight / totalWeight));
+        balancedCounts[i] = end - balancedDispls[i];
+    }
+
+    double currentTime = 0;
+    double balancedTime = 0;
+    for (int i = 0; i < size; i++) {
+        currentTime = std::max(currentTime, rowCounts[i] / weights[i]);
+        balancedTime = std::max(balancedTime, balancedCounts[i] / weights[i]);
+    }
+    if (balancedTime > 0.95 * currentTime) return false;
+
+    Release();
+    rowCounts = balancedCounts;
+    rowDispls = balancedDispls;
+    Allocate();
+    return true;
+}
+
+bool MPIFilterPlan::Matches(const cv::Mat& image) const
+{
+    return image.rows == rows && image.cols == cols && image.type() == type;
+}
+
+void MPIFilterPlan::Scatter(const cv::Mat& image)
+{
+    if (rank == 0 && !Matches(image))
+        throw std::invalid_argument("The image does not match the geometry of the MPI plan!");
+
+    // every process waits until its own rows arrived, the host until all rows were sent
+    TraceScope scope(TraceCategory::MPI, "scatter", partialImage.total() * partialImage.elemSize());
+    if (UsesSharedMemory()) {
+        // the image is loaded into the window of the host node once, only the rows of other nodes are sent
+        if (rank == 0 && image.data != this->image.data) image.copyTo(this->image);
+        if (leaderComm != MPI_COMM_NULL) {
+            MPI_Scatterv(this->image.data, nodeRowCounts.data(), nodeRowDispls.data(), rowType,
+                (rank == 0) ? MPI_IN_PLACE : nodeImage.data, nodeImage.rows, rowType, 0, leaderComm);
+        }
+        SynchronizeNode();
+        return;
+    }
+
+    if (UsesPersistentCollectives()) {
+        // the persistent scatter always sends from the image of the plan
+        if (rank == 0 && image.data != this->image.data) image.copyTo(this->image);
+        MPI_Start(&scatterRequest);
+        MPI_Wait(&scatterRequest, MPI_STATUS_IGNORE);
+        return;
+    }
+
+    cv::Mat source = (rank == 0 && !image.isContinuous()) ? image.clone() : image;
+    MPI_Scatterv(source.data, rowCounts.data(), rowDispls.data(), rowType,
+        partialImage.data, rowCounts[rank], rowType, 0, comm);
+}
+
+const cv::Mat& MPIFilterPlan::Gather()
+{
+    TraceScope scope(TraceCategory::MPI, "gather", partialImage.total() * partialImage.elemSize());
+    if (partialImage.type() != type) return GatherReplaced();
+
+    if (UsesSharedMemory()) {
+        SynchronizeNode();
+        if (leaderComm != MPI_COMM_NULL) {
+            MPI_Gatherv((rank == 0) ? MPI_IN_PLACE : nodeImage.data, nodeImage.rows, rowType,
+                image.data, nodeRowCounts.data(), nodeRowDispls.data(), rowType, 0, leaderComm);
+        }
+    }
+    else if (UsesPersistentCollectives()) {
+        MPI_Start(&gatherRequest);
+        MPI_Wait(&gatherRequest, MPI_STATUS_IGNORE);
+    }
+    else {
+        MPI_Gatherv(partialImage.data, rowCounts[rank], rowType,
+            image.data, rowCounts.data(), rowDispls.data(), rowType, 0, comm);
+    }
+    return image;
+}
+
+const cv::Mat& MPIFilterPlan::GatherReplaced()
+{
+    // the replaced partial images are not part of the persistent collectives or the shared window, so all processes
+    // send their rows to the host process, which only moves the bytes of the new type, e.g. a third after a
+    // single-channel grayscale filter
+    const int partialType = partialImage.type();
+    if (partialType != replacedType) {
+        if (replacedRowType != MPI_DATATYPE_NULL) MPI_Type_free(&replacedRowType);
+        MPI_Type_contiguous(static_cast<int>(cols * CV_ELEM_SIZE(partialType)), MPI_UNSIGNED_CHAR, &replacedRowType);
+        MPI_Type_commit(&replacedRowType);
+        replacedType = partialType;
+    }
+    if (rank == 0) replacedImage.create(rows, cols, partialType);
+
+    cv::Mat source = partialImage.isContinuous() ? partialImage : partialImage.clone();
+    MPI_Gatherv(source.data, rowCounts[position], replacedRowType,
+        replacedImage.data, rowCounts.data(), rowDispls.data(), replacedRowType, 0, orderedComm);
+
+    // the next image is scattered into the partial image of the plan again
+    partialImage = planPartialImage;
+    return replacedImage;
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include <mpi.h>
+#include "MPIHaloExchange.h"
+
+/// <summary>
+/// Execution plan of MPI processes that filter images of the same geometry, each process holding a block of
+/// consecutive rows. The partition, the MPI datatype of a row, the partial image buffers and, where MPI supports
+/// them, persistent collectives are set up once, so that every filtered image only pays for moving its data.
+/// In shared memory mode the processes on the same node filter their rows in place inside a shared window that
+/// holds the rows of the whole node, so that the image is only scattered and gathered between the nodes.
+/// </summary>
+class MPIFilterPlan
+{
+public:
+    /// <summary>
+    /// Creates the plan for the geometry of the image on the host process, which is broadcast to all processes.
+    /// Has to be called by all processes of the communicator.
+    /// </summary>
+    /// <param name="rank">The rank of the current MPI process</param>
+    /// <param name="size">The size of the MPI processes</param>
+    /// <param name="hostImage">The image whose geometry is used on the host process, ignored on all others</param>
+    /// <param name="useSharedMemory">Wether processes on the same node share their rows in a shared memory window</param>
+    /// <param name="comm">The communicator of the MPI processes</param>
+    MPIFilterPlan(int rank, int size, const cv::Mat& hostImage, bool useSharedMemory = false, MPI_Comm comm = MPI_COMM_WORLD);
+
+    ~MPIFilterPlan();
+
+    MPIFilterPlan(const MPIFilterPlan&) = delete;
+    MPIFilterPlan& operator=(const MPIFilterPlan&) = delete;
+
+    /// <summary>
+    /// Returns wether the image has the geometry the plan was created for.
+    /// </summary>
+    /// <param name="image"></param>
+    /// <returns></returns>
+    bool Matches(const cv::Mat& image) const;
+
+    /// <summary>
+    /// Distributes the image on the host process between the partial images of all processes.
+    /// </summary>
+    /// <param name="image">The image on the host process, ignored on all others</param>
+    void Scatter(const cv::Mat& image);
+
+    /// <summary>
+    /// Collects the partial images of all processes on the host process. The returned image is owned by the plan
+    /// and overwritten by the next scatter or gather, all other processes receive an empty image.
+    /// If the filters replaced the partial images by images of another type, e.g. single-channel gray images, their
+    /// rows are gathered in that type and the partial images of the plan are used again by the next scatter.
+    /// </summary>
+    /// <returns></returns>
+    const cv::Mat& Gather();
+
+    /// <summary>
+    /// Balances the rows between the processes by the throughput they reached in the last repetitions. The rows are
+    /// only repartitioned if the slowest process is expected to become noticeably faster, since all buffers are
+    /// allocated again. Has to be called by all processes between a gather and the next scatter.
+    /// </summary>
+    /// <param name="filterSeconds">The time the current process needed to filter its partial image</param>
+    /// <returns>Wether the rows were repartitioned</returns>
+    bool Balance(double filterSeconds);
+
+    /// <summary>
+    /// Returns the partial image of the current process, which is reused for every image. Filters may replace it by
+    /// an image of another type until the next gather.
+    /// </summary>
+    /// <returns></returns>
+    cv::Mat& GetPartialImage() {
+        return partialImage;
+    }
+
+    /// <summary>
+    /// Returns the exchange of the rows above the partial image of the current process.
+    /// </summary>
+    /// <returns></returns>
+    HaloExchange* GetHaloExchange() {
+        return haloExchange.get();
+    }
+
+    /// <summary>
+    /// Returns the number of rows of the partial image of every process, in the order of the rows.
+    /// </summary>
+    /// <returns></returns>
+    const std::vector<int>& GetRowCounts() const {
+        return rowCounts;
+    }
+
+    /// <summary>
+    /// Returns the rank of the current MPI process.
+    /// </summary>
+    /// <returns></returns>
+    int GetRank() const {
+        return rank;
+    }
+
+    /// <summary>
+    /// Returns the size of the MPI processes.
+    /// </summary>
+    /// <returns></returns>
+    int GetSize() const {
+        return size;
+    }
+
+    /// <summary>
+    /// Returns wether the processes on the same node share their rows in a shared memory window.
+    /// </summary>
+    /// <returns></returns>
+    bool UsesSharedMemory() const {
+        return nodeComm != MPI_COMM_NULL;
+    }
+
+    /// <summary>
+    /// Returns wether the data is moved by persistent collectives, which requires MPI-4 or the Open MPI extension.
+    /// </summary>
+    /// <returns></returns>
+    bool UsesPersistentCollectives() const {
+        return scatterRequest != MPI_REQUEST_NULL;
+    }
+
+private:
+    int rank;
+    int size;
+    // the position of the partial image of the current process in the order of the rows
+    int position;
+    int rows = 0;
+    int cols = 0;
+    int type = 0;
+    MPI_Comm comm;
+    MPI_Datatype rowType = MPI_DATATYPE_NULL;
+    std::vector<int> rowCounts;
+    std::vector<int> rowDispls;
+    std::vector<double> rowThroughputs;
+
+    cv::Mat image;
+    cv::Mat partialImage;
+    cv::Mat planPartialImage;
+    std::unique_ptr<MPIHaloExchange> haloExchange;
+
+    // the image and row type of gathering partial images whose type was changed by the filters
+    cv::Mat replacedImage;
+    MPI_Datatype replacedRowType = MPI_DATATYPE_NULL;
+    int replacedType = -1;
+
+    MPI_Request scatterRequest = MPI_REQUEST_NULL;
+    MPI_Request gatherRequest = MPI_REQUEST_NULL;
+
+    // the processes in the order of the rows, in shared memory mode the processes of a node are ordered consecutively
+    // and the node leaders exchange the rows of their nodes with the host process
+    MPI_Comm orderedComm = MPI_COMM_NULL;
+    MPI_Comm nodeComm = MPI_COMM_NULL;
+    int nodeRank = 0;
+    int nodeSize = 1;
+    MPI_Comm leaderComm = MPI_COMM_NULL;
+    MPI_Win window = MPI_WIN_NULL;
+    cv::Mat nodeImage;
+    std::vector<int> nodeRowCounts;
+    std::vector<int> nodeRowDispls;
+
+    void CreateNodeCommunicators();
+    void Allocate();
+    void Release();
+    void SynchronizeNode();
+    const cv::Mat& GatherReplaced();
+};
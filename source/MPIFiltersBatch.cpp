@@ -0,0 +1,156 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <opencv2/opencv.hpp>
+#include <mpi.h>
+#include "ImageBatch.h"
+#include "ImageCache.h"
+#include "RawImage.h"
+#include "Trace.h"
+
+/// <summary>
+/// Applies the specified filter methods on a batch of images, distributing whole images between the MPI processes.
+/// Every process takes the next image from a counter on the host process as soon as it finished its previous one and
+/// decodes, filters and encodes it on its own, so no pixels are sent between the processes. The timings of all images
+/// are collected on the host process.
+/// </summary>
+/// <param name="rank">The rank of the current MPI process</param>
+/// <param name="size">The size of the MPI processes</param>
+/// <param name="batchPath">The directory of the to be filtered images or a file listing their paths</param>
+/// <param name="outputDir">The output directory path of the filtered images and their timings after saving</param>
+/// <param name="filterMethods">The image filter methods that should be run</param>
+/// <param name="useOpenMP">Wether to use OpenMP for the image filter or not</param>
+/// <param name="saveImage">Wether to save the resulting images and timings or not</param>
+static void MPIFiltersBatch(int& rank, int& size,
+    const std::string& batchPath,
+    const std::string& outputDir,
+    const std::vector<std::function<void(cv::Mat&, bool)>>& filterMethods,
+    bool useOpenMP = true,
+    bool saveImage = false
+) {
+    double batchBegin = MPI_Wtime();
+
+    // the host process reads the batch and broadcasts the paths, the images themselves are read by every process
+    std::string joinedPaths;
+    if (rank == 0) {
+        for (const auto& imagePath : GetBatchImagePaths(batchPath)) joinedPaths += imagePath + '\n';
+    }
+
+    int joinedLength = static_cast<int>(joinedPaths.size());
+    MPI_Bcast(&joinedLength, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    joinedPaths.resize(joinedLength);
+    MPI_Bcast(&joinedPaths[0], joinedLength, MPI_CHAR, 0, MPI_COMM_WORLD);
+
+    std::vector<std::string> imagePaths;
+    std::istringstream pathStream(joinedPaths);
+    for (std::string imagePath; std::getline(pathStream, imagePath);) imagePaths.push_back(imagePath);
+    const int imageCount = static_cast<int>(imagePaths.size());
+
+    // the index of the next image is a counter in a window on the host process, which every process increments
+    // atomically, so that faster processes take more images without a dedicated dispatcher
+    int* nextImage;
+    MPI_Win window;
+    MPI_Win_allocate((rank == 0) ? sizeof(int) : 0, sizeof(int), MPI_INFO_NULL, MPI_COMM_WORLD, &nextImage, &window);
+    if (rank == 0) *nextImage = 0;
+    MPI_Barrier(MPI_COMM_WORLD);
+    MPI_Win_lock_all(0, window);
+
+    // every image records its index, rank and the decode, filter and encode time in milliseconds
+    const int timingValues = 5;
+    std::vector<double> timings;
+    const int one = 1;
+    while (true) {
+        int index;
+        {
+            TraceScope scope(TraceCategory::MPI, "next image");
+            MPI_Fetch_and_op(&one, &index, MPI_INT, 0, 0, MPI_SUM, window);
+            MPI_Win_flush(0, window);
+        }
+        if (index >= imageCount) break;
+
+        double decodeBegin = MPI_Wtime();
+        cv::Mat image = ImageSource(imagePaths[index]).Decode();
+        double filterBegin = MPI_Wtime();
+        if (image.empty()) {
+            // a broken image does not stop the batch, it is reported with negative timings
+            std::cerr << "Could not open or find the image " << imagePaths[index] << "!" << std::endl;
+            timings.insert(timings.end(), { static_cast<double>(index), static_cast<double>(rank), -1, -1, -1 });
+            continue;
+        }
+
+        for (const auto& filter : filterMethods) {
+            filter(image, useOpenMP);
+        }
+
+        double encodeBegin = MPI_Wtime();
+        if (saveImage) {
+            ImageOutput::Write(ImageOutput::GetPath(outputDir, GetBatchOutputName(imagePaths, index)), image);
+        }
+        double encodeEnd = MPI_Wtime();
+
+        timings.insert(timings.end(), { static_cast<double>(index), static_cast<double>(rank),
+            (filterBegin - decodeBegin) * 1000, (encodeBegin - filterBegin) * 1000, (encodeEnd - encodeBegin) * 1000 });
+    }
+
+    MPI_Win_unlock_all(window);
+    MPI_Win_free(&window);
+
+    // collect the timings of all images on the host process, which waits for the slowest process
+    TraceScope scope(TraceCategory::MPI, "gather timings");
+    int timingCount = static_cast<int>(timings.size());
+    std::vector<int> timingCounts(size);
+    MPI_Gather(&timingCount, 1, MPI_INT, timingCounts.data(), 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+    std::vector<int> timingDispls(size, 0);
+    for (int i = 1; i < size; i++) timingDispls[i] = timingDispls[i - 1] + timingCounts[i - 1];
+    std::vector<double> allTimings((rank == 0) ? imageCount * timingValues : 0);
+    MPI_Gatherv(timings.data(), timingCount, MPI_DOUBLE,
+        allTimings.data(), timingCounts.data(), timingDispls.data(), MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+    if (rank != 0) return;
+
+    double batchDuration = (MPI_Wtime() - batchBegin) * 1000;
+    std::vector<int> imagesPerRank(size, 0);
+    double decodeDuration = 0, filterDuration = 0, encodeDuration = 0;
+    int failedImages = 0;
+    for (int i = 0; i < imageCount; i++) {
+        const double* timing = &allTimings[i * timingValues];
+        imagesPerRank[static_cast<int>(timing[1])]++;
+        if (timing[2] < 0) {
+            failedImages++;
+            continue;
+        }
+        decodeDuration += timing[2];
+        filterDuration += timing[3];
+        encodeDuration += timing[4];
+    }
+
+    int filteredImages = std::max(1, imageCount - failedImages);
+    std::cout << "Images: " << imageCount << ", Failed: " << failedImages << std::endl;
+    std::cout << "Batch Duration: " << batchDuration << "ms" << std::endl;
+    std::cout << "Images per Second: " << imageCount / (batchDuration / 1000) << std::endl;
+    std::cout << "Average Decode Duration: " << decodeDuration / filteredImages << "ms" << std::endl;
+    std::cout << "Average Filter Duration: " << filterDuration / filteredImages << "ms" << std::endl;
+    std::cout << "Average Encode Duration: " << encodeDuration / filteredImages << "ms" << std::endl;
+    for (int i = 0; i < size; i++) {
+        std::cout << "Rank " << i << " Images: " << imagesPerRank[i] << std::endl;
+    }
+
+    if (saveImage) {
+        // the timings are saved in the order of the batch
+        std::vector<const double*> orderedTimings(imageCount);
+        for (int i = 0; i < imageCount; i++) {
+            const double* timing = &allTimings[i * timingValues];
+            orderedTimings[static_cast<int>(timing[0])] = timing;
+        }
+
+        std::ofstream timingFile(outputDir + "/batch_timings.csv");
+        timingFile << "image,rank,decode_ms,filter_ms,encode_ms" << std::endl;
+        for (int i = 0; i < imageCount; i++) {
+            const double* timing = orderedTimings[i];
+            timingFile << imagePaths[i] << "," << static_cast<int>(timing[1]) << ","
+                << timing[2] << "," << timing[3] << "," << timing[4] << std::endl;
+        }
+    }
+}
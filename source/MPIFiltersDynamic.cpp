@@ -0,0 +1,182 @@
+#include <deque>
+#include <iostream>
+#include <numeric>
+#include <opencv2/opencv.hpp>
+#include <mpi.h>
+#include "AlgorithmBenchmark.h"
+#include "ImageCache.h"
+#include "RawImage.h"
+#include "FilterPipeline.h"
+#include "Trace.h"
+
+// the tags of the dynamic mode: the index of a chunk and its rows are both sent with the chunk tag, the index first,
+// and an empty message with the stop tag ends a worker. The index is not sent as the tag, since MPI only guarantees
+// tags up to 32767
+static const int DynamicChunkTag = 1;
+static const int DynamicStopTag = 2;
+
+/// <summary>
+/// Applies the specified filter methods on the specified image inside the current MPI process,
+/// balancing the load dynamically. The host process divides the image into chunks of rows and hands them out to the
+/// other processes on demand, so that faster processes filter more chunks. Every process is kept busy with a second
+/// chunk that is already sent while it filters the first one.
+/// </summary>
+/// <param name="rank">The rank of the current MPI process</param>
+/// <param name="size">The size of the MPI processes</param>
+/// <param name="source">The to be filtered image, which is read from a file or already decoded in memory</param>
+/// <param name="outputDir">The output directory path of the to be filtered image after saving</param>
+/// <param name="filterMethods">The image filter methods that should be run</param>
+/// <param name="chunkRows">The number of rows of a chunk</param>
+/// <param name="useOpenMP">Wether to use OpenMP for the image filter or not</param>
+/// <param name="showImage">Wether to show the resulting image or not</param>
+/// <param name="saveImage">Wether to save the resulting image or not</param>
+static void MPIFiltersDynamic(int& rank, int& size,
+    const ImageSource& source,
+    const std::string& outputDir,
+    const std::vector<std::function<void(cv::Mat&, bool)>>& filterMethods,
+    int chunkRows = 64,
+    bool useOpenMP = true,
+    bool showImage = false,
+    bool saveImage = false
+) {
+    if (chunkRows < 1)
+        throw std::invalid_argument("The chunk rows have to be at least one!");
+
+    int imageProperties[4];
+    cv::Mat image;
+
+    if (rank == 0) {
+        // load the image on the host process, which is only read while it is sent, unless the host filters it
+        // itself. The chunks are sent from consecutive rows, so padded rows of an image in memory are copied
+        BenchmarkPhase phase("decode");
+        image = (size == 1) ? source.GetCopy() : source.Get();
+        if (!image.isContinuous()) image = image.clone();
+
+        if (image.empty())
+            throw std::invalid_argument("Could not open or find the image!");
+
+        imageProperties[0] = image.rows;
+        imageProperties[1] = image.cols;
+        imageProperties[2] = image.type();
+        imageProperties[3] = image.channels();
+    }
+
+    MPI_Bcast(imageProperties, 4, MPI_INT, 0, MPI_COMM_WORLD);
+
+    // every chunk is sent together with the rows above it that its stencil filters depend on, which are filtered
+    // along with the chunk but not sent back
+    FilterPipeline pipeline = FilterPipeline::FromFilterMethods(filterMethods);
+    const int haloRows = pipeline.GetStencilCount();
+    const int rowSize = imageProperties[1] * imageProperties[3];
+    const int chunkCount = (imageProperties[0] + chunkRows - 1) / chunkRows;
+    auto chunkBegin = [&](int chunk) { return chunk * chunkRows; };
+    auto chunkEnd = [&](int chunk) { return std::min(imageProperties[0], (chunk + 1) * chunkRows); };
+    auto chunkHaloRows = [&](int chunk) { return std::min(haloRows, chunkBegin(chunk)); };
+
+    if (rank != 0) {
+        cv::Mat chunkImage;
+        while (true) {
+            // the time a worker waits for its next chunk is not spent filtering
+            MPI_Status status;
+            {
+                TraceScope scope(TraceCategory::MPI, "probe");
+                MPI_Probe(0, MPI_ANY_TAG, MPI_COMM_WORLD, &status);
+            }
+            if (status.MPI_TAG == DynamicStopTag) {
+                MPI_Recv(nullptr, 0, MPI_UNSIGNED_CHAR, 0, DynamicStopTag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+                break;
+            }
+
+            int chunk = 0;
+            MPI_Recv(&chunk, 1, MPI_INT, 0, DynamicChunkTag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            int chunkHalo = chunkHaloRows(chunk);
+            chunkImage.create(chunkEnd(chunk) - chunkBegin(chunk) + chunkHalo, imageProperties[1], imageProperties[2]);
+            {
+                TraceScope scope(TraceCategory::MPI, "receive chunk", static_cast<size_t>(chunkImage.rows) * rowSize);
+                MPI_Recv(chunkImage.data, chunkImage.rows * rowSize, MPI_UNSIGNED_CHAR, 0, DynamicChunkTag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            }
+
+            pipeline.Apply(chunkImage, useOpenMP);
+
+            TraceScope scope(TraceCategory::MPI, "send chunk", static_cast<size_t>(chunkImage.rows - chunkHalo) * rowSize);
+            MPI_Send(chunkImage.ptr<uchar>(chunkHalo), (chunkImage.rows - chunkHalo) * rowSize, MPI_UNSIGNED_CHAR,
+                0, DynamicChunkTag, MPI_COMM_WORLD);
+        }
+        return;
+    }
+
+    // without workers the host filters the whole image itself
+    cv::Mat resultImage;
+    if (size == 1) {
+        BenchmarkPhase phase("filter " + FilterPipeline::GetFilterName(pipeline));
+        resultImage = image;
+        pipeline.Apply(resultImage, useOpenMP);
+    }
+    else {
+        // the host only distributes the chunks, so all of its time is spent on communication
+        BenchmarkPhase phase("communication");
+        // the chunks are gathered into a separate image, since the rows above a chunk may still be sent when the
+        // chunk before it is received
+        resultImage = cv::Mat(image.rows, image.cols, image.type());
+        std::vector<MPI_Request> sendRequests;
+        // the indices are sent from this buffer, which has to outlive the sends. A worker returns its chunks in the
+        // order it received them, so the chunk of every result is the oldest pending chunk of its worker
+        std::vector<int> chunkIndices(chunkCount);
+        std::iota(chunkIndices.begin(), chunkIndices.end(), 0);
+        std::vector<std::deque<int>> pendingChunks(size);
+        int nextChunk = 0;
+
+        auto sendChunk = [&](int worker) {
+            int chunk = nextChunk++;
+            int chunkHalo = chunkHaloRows(chunk);
+            sendRequests.emplace_back();
+            MPI_Isend(&chunkIndices[chunk], 1, MPI_INT, worker, DynamicChunkTag, MPI_COMM_WORLD, &sendRequests.back());
+            sendRequests.emplace_back();
+            MPI_Isend(image.ptr<uchar>(chunkBegin(chunk) - chunkHalo), (chunkEnd(chunk) - chunkBegin(chunk) + chunkHalo) * rowSize,
+                MPI_UNSIGNED_CHAR, worker, DynamicChunkTag, MPI_COMM_WORLD, &sendRequests.back());
+            pendingChunks[worker].push_back(chunk);
+        };
+        auto stopWorker = [&](int worker) {
+            sendRequests.emplace_back();
+            MPI_Isend(nullptr, 0, MPI_UNSIGNED_CHAR, worker, DynamicStopTag, MPI_COMM_WORLD, &sendRequests.back());
+        };
+
+        // every worker starts with two chunks, so that it never waits for the next one
+        sendRequests.reserve(2 * chunkCount + size);
+        for (int round = 0; round < 2; round++) {
+            for (int worker = 1; worker < size && nextChunk < chunkCount; worker++) sendChunk(worker);
+        }
+        for (int worker = 1; worker < size; worker++) {
+            if (pendingChunks[worker].empty()) stopWorker(worker);
+        }
+
+        for (int received = 0; received < chunkCount; received++) {
+            MPI_Status status;
+            TraceScope scope(TraceCategory::MPI, "receive chunk");
+            MPI_Probe(MPI_ANY_SOURCE, DynamicChunkTag, MPI_COMM_WORLD, &status);
+            int worker = status.MPI_SOURCE;
+            int chunk = pendingChunks[worker].front();
+            pendingChunks[worker].pop_front();
+            MPI_Recv(resultImage.ptr<uchar>(chunkBegin(chunk)), (chunkEnd(chunk) - chunkBegin(chunk)) * rowSize,
+                MPI_UNSIGNED_CHAR, worker, DynamicChunkTag, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+            scope.AddBytes(static_cast<size_t>(chunkEnd(chunk) - chunkBegin(chunk)) * rowSize);
+
+            if (nextChunk < chunkCount)
+                sendChunk(worker);
+            else if (pendingChunks[worker].empty())
+                stopWorker(worker);
+        }
+
+        TraceScope scope(TraceCategory::MPI, "send chunks");
+        MPI_Waitall(static_cast<int>(sendRequests.size()), sendRequests.data(), MPI_STATUSES_IGNORE);
+    }
+
+    if (showImage) {
+        cv::imshow("Final Image MPIFiltersDynamic", resultImage);
+    }
+
+    if (saveImage) {
+        BenchmarkPhase phase("encode");
+        ImageOutput::Write(ImageOutput::GetPath(outputDir, "resulting_image_mpi_dynamic"), resultImage);
+    }
+}
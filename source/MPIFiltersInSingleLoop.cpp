@@ -2,16 +2,20 @@
 #include <opencv2/opencv.hpp>
 #include <mpi.h>
 #include "ImageFilter.h"
+#include "AlgorithmBenchmark.h"
+#include "ImageCache.h"
+#include "RawImage.h"
+#include "FilterPipeline.h"
+#include "MPIFilterPlan.h"
 
 /// <summary>
-/// Early attempt of running all three filters within a single loop. Because the embossing filter has to be applied on 
-/// neighboring pixels that were already filtered by the two other filters and with parallelisation race-conditions 
-/// lead to pixels filtered in random order, the embossing filter has to be done in an additional loop. This
-/// makes the performance gains negligible.
+/// Runs all three filters within a single sweep over the partial image of the current MPI process. Because the
+/// embossing filter has to be applied on neighboring pixels that were already filtered by the two other filters,
+/// the FilterPipeline keeps the previously filtered row in a rolling window instead of running the embossing filter
+/// in an additional loop.
 /// </summary>
-/// <param name="rank">The rank of the current MPI process</param>
-/// <param name="size">The size of the MPI processes</param>
-/// <param name="imagePath">The file path of the to be filtered image</param>
+/// <param name="plan">The plan of the MPI processes, which has to be created for the geometry of the image</param>
+/// <param name="source">The to be filtered image, which is read from a file or already decoded in memory</param>
 /// <param name="outputDir">The output directory path of the to be filtered image after saving</param>
 /// <param name="useOpenMP">Wether to use OpenMP for the image filter or not</param>
 /// <param name="showImage">Wether to show the resulting image or not</param>
@@ -19,122 +23,75 @@
 /// <param name="doHSV">Wether to apply a HSV filter on the image or not</param>
 /// <param name="doGrayscale">Wether to apply a grayscale filter on the image or not</param>
 /// <param name="doEmboss">Wether to apply an embossing filter on the image or not</param>
-static void MPIFiltersInSingleLoop(int& rank, int& size,
-    const std::string& imagePath,
+/// <param name="balanceLoad">Wether to balance the rows between the processes by their measured throughput</param>
+static void MPIFiltersInSingleLoop(MPIFilterPlan& plan,
+    const ImageSource& source,
     const std::string& outputDir,
     bool useOpenMP = true,
     bool showImage = false,
     bool saveImage = false,
     bool doHSV = true,
     bool doGrayscale = true,
-    bool doEmboss = true
+    bool doEmboss = true,
+    bool balanceLoad = false
 ) {
-    int imageProperties[4];
+    const int rank = plan.GetRank();
     cv::Mat image;
-    cv::Mat partialImage;
 
     if (rank == 0) {
-        // load the image on the host process
-        image = cv::imread(imagePath);
+        // load the image on the host process, which is only read by the scatter
+        BenchmarkPhase phase("decode");
+        image = source.Get();
 
         if (image.empty())
             throw std::invalid_argument("Could not open or find the image!");
 
-        imageProperties[0] = image.rows;
-        imageProperties[1] = image.cols;
-        imageProperties[2] = image.type();
-        imageProperties[3] = image.channels();
-
 #ifdef _DEBUG
         // NOTE : only print image values to console in debug mode, since it will skew the benchmark result
         std::cout << "Image width: " << image.cols << std::endl;
         std::cout << "Image height: " << image.rows << std::endl;
         std::cout << "Image pixels: " << image.cols * image.rows << std::endl;
-        std::cout << "Rank: " << rank << ", Size: " << size << std::endl;
+        std::cout << "Rank: " << rank << ", Size: " << plan.GetSize() << std::endl;
 #endif
     }
 
     // distribute the image from the host between the processes
-    MPI_Bcast(imageProperties, 4, MPI_INT, 0, MPI_COMM_WORLD);
-
-    int* sendcounts = new int[size];
-    int* displs = new int[size];
-    int sizePerProcess = imageProperties[0] / size;
-    int rest = imageProperties[0] % size;
-
-    int increment = 0;
-    for (int i = 0; i < size; i++) {
-        displs[i] = increment;
-        sendcounts[i] = (i == size - 1) ? sizePerProcess + rest : sizePerProcess;
-        if (i == rank) partialImage = cv::Mat(sendcounts[i], imageProperties[1], imageProperties[2]);
-        sendcounts[i] *= imageProperties[1] * imageProperties[3];
-        increment += sendcounts[i];
+    {
+        BenchmarkPhase phase("scatter");
+        plan.Scatter(image);
     }
-
-    MPI_Barrier(MPI_COMM_WORLD);
-    MPI_Scatterv(image.data, sendcounts, displs, MPI_UNSIGNED_CHAR,
-        partialImage.data, sendcounts[rank], MPI_UNSIGNED_CHAR,
-        0, MPI_COMM_WORLD);
-
-    // apply the hsv and grayscale filter
-    #pragma omp parallel for schedule(dynamic) if(useOpenMP)
-    for (int x = 0; x < partialImage.rows; x++) {
-        for (int y = 0; y < partialImage.cols; y++) {
-            cv::Vec3b pixel = partialImage.at<cv::Vec3b>(x, y);
-
-            if (doHSV) {
-                float r = pixel[2] / 255.0f;
-                float g = pixel[1] / 255.0f;
-                float b = pixel[0] / 255.0f;
-
-                float cmax = fmax(fmax(r, g), b);
-                float cmin = fmin(fmin(r, g), b);
-                float delta = cmax - cmin;
-
-                float hue = 0.0;
-                if (delta != 0.0) {
-                    if (cmax == r)
-                        hue = 60 * fmod((g - b) / delta, 6.0f);
-                    else if (cmax == g)
-                        hue = 60 * (((b - r) / delta) + 2.0f);
-                    else if (cmax == b)
-                        hue = 60 * (((r - g) / delta) + 4.0f);
-                }
-                if (hue < 0) hue += 360;
-                float saturation = (cmax == 0.0f) ? 0 : (delta / cmax);
-                float value = cmax;
-
-                // multiply saturation and value by 255 to switch from normalized HSV space to pseudo-RGB space
-                partialImage.at<cv::Vec3b>(x, y) = pixel = cv::Vec3b(
-                    static_cast<uchar>(hue),
-                    static_cast<uchar>(saturation * 255),
-                    static_cast<uchar>(value * 255));
-            }
-
-            if (doGrayscale) {
-                uchar gray = static_cast<uchar>(0.21 * pixel[2] + 0.72 * pixel[1] + 0.07 * pixel[0]);
-                partialImage.at<cv::Vec3b>(x, y) = pixel = cv::Vec3b(gray, gray, gray);
-            }
-        }
-    }
-
-    if (doEmboss) {
-        // apply the embossing filter individually
-        ImageFilter::EmbossImage(partialImage, useOpenMP);
+    cv::Mat& partialImage = plan.GetPartialImage();
+
+    // apply all filters in a single fused sweep, exchanging the rows above the partial image with the previous process
+    FilterPipeline pipeline;
+    if (doHSV) pipeline.AddHSV();
+    if (doGrayscale) pipeline.AddGrayscale();
+    if (doEmboss) pipeline.AddEmboss();
+    double filterBegin = MPI_Wtime();
+    {
+        BenchmarkPhase phase("filter " + FilterPipeline::GetFilterName(pipeline));
+        pipeline.Apply(partialImage, useOpenMP, plan.GetHaloExchange());
     }
+    double filterSeconds = MPI_Wtime() - filterBegin;
 
     // gather the partial image back to the full image on the host process
-    MPI_Gatherv(partialImage.data, sendcounts[rank], MPI_UNSIGNED_CHAR,
-        image.data, sendcounts, displs, MPI_UNSIGNED_CHAR,
-        0, MPI_COMM_WORLD);
+    cv::Mat resultImage;
+    {
+        BenchmarkPhase phase("gather");
+        resultImage = plan.Gather();
+    }
 
     if (rank == 0) {
         if (showImage) {
-            cv::imshow("Final Image MPIFiltersInSingleLoop", image);
+            cv::imshow("Final Image MPIFiltersInSingleLoop", resultImage);
         }
 
         if (saveImage) {
-            cv::imwrite(outputDir + "/resulting_image_mpi_single_loop.png", image);
+            BenchmarkPhase phase("encode");
+            ImageOutput::Write(ImageOutput::GetPath(outputDir, "resulting_image_mpi_single_loop"), resultImage);
         }
     }
+
+    // the rows of the next image are distributed by the throughput the processes reached on this one
+    if (balanceLoad) plan.Balance(filterSeconds);
 }
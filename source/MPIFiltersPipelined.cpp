@@ -0,0 +1,147 @@
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <mpi.h>
+#include "AlgorithmBenchmark.h"
+#include "ImageCache.h"
+#include "RawImage.h"
+#include "FilterPipeline.h"
+#include "Trace.h"
+
+/// <summary>
+/// Applies the specified filter methods on the specified image inside the current MPI process,
+/// overlapping the communication with the filtering. The partial image of every process is divided into strips, which
+/// are scattered with non-blocking collectives. Every strip is filtered as soon as it arrived and gathered back while
+/// the following strips are still being filtered.
+/// </summary>
+/// <param name="rank">The rank of the current MPI process</param>
+/// <param name="size">The size of the MPI processes</param>
+/// <param name="source">The to be filtered image, which is read from a file or already decoded in memory</param>
+/// <param name="outputDir">The output directory path of the to be filtered image after saving</param>
+/// <param name="filterMethods">The image filter methods that should be run</param>
+/// <param name="stripCount">The number of strips the partial image of every process is divided into</param>
+/// <param name="useOpenMP">Wether to use OpenMP for the image filter or not</param>
+/// <param name="showImage">Wether to show the resulting image or not</param>
+/// <param name="saveImage">Wether to save the resulting image or not</param>
+static void MPIFiltersPipelined(int& rank, int& size,
+    const ImageSource& source,
+    const std::string& outputDir,
+    const std::vector<std::function<void(cv::Mat&, bool)>>& filterMethods,
+    int stripCount = 4,
+    bool useOpenMP = true,
+    bool showImage = false,
+    bool saveImage = false
+) {
+    if (stripCount < 1)
+        throw std::invalid_argument("The strip count has to be at least one!");
+
+    int imageProperties[4];
+    cv::Mat image;
+    cv::Mat resultImage;
+
+    if (rank == 0) {
+        // load the image on the host process, which is only read by the scatter. The strips are sent from
+        // consecutive rows, so padded rows of an image in memory are copied
+        BenchmarkPhase phase("decode");
+        image = source.Get();
+        if (!image.isContinuous()) image = image.clone();
+
+        if (image.empty())
+            throw std::invalid_argument("Could not open or find the image!");
+
+        imageProperties[0] = image.rows;
+        imageProperties[1] = image.cols;
+        imageProperties[2] = image.type();
+        imageProperties[3] = image.channels();
+
+        // the strips are gathered into a separate image, since the rows above a strip are still being scattered
+        // when the strip before it is gathered
+        resultImage = cv::Mat(image.rows, image.cols, image.type());
+    }
+
+    MPI_Bcast(imageProperties, 4, MPI_INT, 0, MPI_COMM_WORLD);
+
+    // every strip is sent together with the rows above it that its stencil filters depend on. These rows are
+    // filtered along with the strip but not gathered, so all filters that are not known to be stencils are expected
+    // to be pointwise filters
+    FilterPipeline pipeline = FilterPipeline::FromFilterMethods(filterMethods);
+    const int haloRows = pipeline.GetStencilCount();
+    const int rowSize = imageProperties[1] * imageProperties[3];
+    int sizePerProcess = imageProperties[0] / size;
+    int rest = imageProperties[0] % size;
+
+    std::vector<std::vector<int>> sendcounts(stripCount, std::vector<int>(size));
+    std::vector<std::vector<int>> senddispls(stripCount, std::vector<int>(size));
+    std::vector<std::vector<int>> recvcounts(stripCount, std::vector<int>(size));
+    std::vector<std::vector<int>> recvdispls(stripCount, std::vector<int>(size));
+    std::vector<cv::Mat> partialStrips(stripCount);
+    std::vector<int> partialHaloRows(stripCount);
+
+    for (int i = 0; i < size; i++) {
+        int processBegin = i * sizePerProcess;
+        int processRows = (i == size - 1) ? sizePerProcess + rest : sizePerProcess;
+
+        for (int strip = 0; strip < stripCount; strip++) {
+            int stripBegin = processBegin + static_cast<int>(static_cast<long long>(processRows) * strip / stripCount);
+            int stripEnd = processBegin + static_cast<int>(static_cast<long long>(processRows) * (strip + 1) / stripCount);
+            int stripHaloRows = (stripEnd > stripBegin) ? std::min(haloRows, stripBegin) : 0;
+
+            sendcounts[strip][i] = (stripEnd - stripBegin + stripHaloRows) * rowSize;
+            senddispls[strip][i] = (stripBegin - stripHaloRows) * rowSize;
+            recvcounts[strip][i] = (stripEnd - stripBegin) * rowSize;
+            recvdispls[strip][i] = stripBegin * rowSize;
+
+            if (i == rank) {
+                partialStrips[strip] = cv::Mat(stripEnd - stripBegin + stripHaloRows, imageProperties[1], imageProperties[2]);
+                partialHaloRows[strip] = stripHaloRows;
+            }
+        }
+    }
+
+    // start to distribute all strips at once, so that later strips are transferred while earlier ones are filtered
+    std::vector<MPI_Request> scatterRequests(stripCount);
+    std::vector<MPI_Request> gatherRequests(stripCount);
+    for (int strip = 0; strip < stripCount; strip++) {
+        MPI_Iscatterv(image.data, sendcounts[strip].data(), senddispls[strip].data(), MPI_UNSIGNED_CHAR,
+            partialStrips[strip].data, sendcounts[strip][rank], MPI_UNSIGNED_CHAR,
+            0, MPI_COMM_WORLD, &scatterRequests[strip]);
+    }
+
+    // filter every strip as soon as it arrived and start to gather it back right away. Only the time spent waiting
+    // for the communication is part of the scatter and gather phases
+    const std::string filterPhaseName = "filter " + FilterPipeline::GetFilterName(pipeline);
+    for (int strip = 0; strip < stripCount; strip++) {
+        {
+            BenchmarkPhase phase("scatter");
+            TraceScope scope(TraceCategory::MPI, "scatter strip", partialStrips[strip].total() * partialStrips[strip].elemSize());
+            MPI_Wait(&scatterRequests[strip], MPI_STATUS_IGNORE);
+        }
+
+        cv::Mat& partialStrip = partialStrips[strip];
+        {
+            BenchmarkPhase phase(filterPhaseName);
+            pipeline.Apply(partialStrip, useOpenMP);
+        }
+
+        const uchar* stripData = partialStrip.empty() ? nullptr : partialStrip.ptr<uchar>(partialHaloRows[strip]);
+        MPI_Igatherv(stripData, recvcounts[strip][rank], MPI_UNSIGNED_CHAR,
+            resultImage.data, recvcounts[strip].data(), recvdispls[strip].data(), MPI_UNSIGNED_CHAR,
+            0, MPI_COMM_WORLD, &gatherRequests[strip]);
+    }
+
+    {
+        BenchmarkPhase phase("gather");
+        TraceScope scope(TraceCategory::MPI, "gather strips");
+        MPI_Waitall(stripCount, gatherRequests.data(), MPI_STATUSES_IGNORE);
+    }
+
+    if (rank == 0) {
+        if (showImage) {
+            cv::imshow("Final Image MPIFiltersPipelined", resultImage);
+        }
+
+        if (saveImage) {
+            BenchmarkPhase phase("encode");
+            ImageOutput::Write(ImageOutput::GetPath(outputDir, "resulting_image_mpi_pipelined"), resultImage);
+        }
+    }
+}
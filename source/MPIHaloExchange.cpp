@@ -0,0 +1,66 @@
+#include "MPIHaloExchange.h"
+#include "Trace.h"
+
+MPIHaloExchange::MPIHaloExchange(int rank, int size, const std::vector<int>& rowCounts, int cols, int type, MPI_Comm comm)
+    : rank(rank), size(size), cols(cols), type(type), rowBytes(static_cast<size_t>(cols) * CV_ELEM_SIZE(type)), comm(comm),
+    rowCounts(rowCounts), rowBegins(size + 1, 0)
+{
+    for (int i = 0; i < size; i++) {
+        rowBegins[i + 1] = rowBegins[i] + rowCounts[i];
+    }
+}
+
+void MPIHaloExchange::Begin(const cv::Mat& image, int rowCount)
+{
+    // the rows are exchanged in the layout of the image, which loses channels after a single-channel grayscale filter
+    type = image.type();
+    rowBytes = static_cast<size_t>(cols) * image.elemSize();
+
+    // the number of rows is limited by the top of the image
+    receiveRows = (rank > 0) ? std::min(rowCount, rowBegins[rank]) : 0;
+    sendRows = (rank < size - 1) ? std::min(rowCount, rowBegins[rank + 1]) : 0;
+    receiveBuffer.resize(receiveRows * rowBytes);
+    sendBuffer.resize(sendRows * rowBytes);
+
+    if (receiveRows > 0) {
+        MPI_Irecv(receiveBuffer.data(), static_cast<int>(receiveRows * rowBytes), MPI_UNSIGNED_CHAR,
+            rank - 1, 0, comm, &receiveRequest);
+    }
+
+    // if the partial image has fewer rows than the next process needs, the received rows have to be forwarded,
+    // so sending is delayed until they arrived
+    pendingImage = image;
+    sendPending = sendRows > 0;
+    if (sendPending && rowCounts[rank] >= sendRows) SendRows();
+}
+
+cv::Mat MPIHaloExchange::Finish()
+{
+    {
+        TraceScope scope(TraceCategory::MPI, "halo exchange", (receiveRows + sendRows) * rowBytes);
+        MPI_Wait(&receiveRequest, MPI_STATUS_IGNORE);
+        if (sendPending) SendRows();
+        MPI_Wait(&sendRequest, MPI_STATUS_IGNORE);
+    }
+    pendingImage.release();
+
+    if (receiveRows == 0) return cv::Mat();
+    return cv::Mat(receiveRows, cols, type, receiveBuffer.data());
+}
+
+void MPIHaloExchange::SendRows()
+{
+    // the rows are copied, since the partial image is filtered in place while they are sent
+    int ownRows = std::min(sendRows, rowCounts[rank]);
+    int forwardedRows = sendRows - ownRows;
+    if (forwardedRows > 0) {
+        memcpy(sendBuffer.data(), receiveBuffer.data() + (receiveRows - forwardedRows) * rowBytes, forwardedRows * rowBytes);
+    }
+    for (int i = 0; i < ownRows; i++) {
+        memcpy(sendBuffer.data() + (forwardedRows + i) * rowBytes, pendingImage.ptr<uchar>(rowCounts[rank] - ownRows + i), rowBytes);
+    }
+
+    MPI_Isend(sendBuffer.data(), static_cast<int>(sendRows * rowBytes), MPI_UNSIGNED_CHAR,
+        rank + 1, 0, comm, &sendRequest);
+    sendPending = false;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include <mpi.h>
+#include "FilterPipeline.h"
+
+/// <summary>
+/// Exchanges the rows above the partial images of MPI processes, which hold consecutive blocks of rows of an image.
+/// Every process sends the last rows of its partial image to the next process using non-blocking point-to-point
+/// communication, so that the rows which do not depend on the previous process are filtered in the meantime.
+/// </summary>
+class MPIHaloExchange : public HaloExchange
+{
+public:
+    /// <summary>
+    /// Creates the exchange for the current MPI process.
+    /// </summary>
+    /// <param name="rank">The rank of the current MPI process</param>
+    /// <param name="size">The size of the MPI processes</param>
+    /// <param name="rowCounts">The number of rows of the partial image of every process, in the order of the image</param>
+    /// <param name="cols">The number of columns of the image</param>
+    /// <param name="type">The OpenCV type of the image, which is replaced by the type of the partial image passed to Begin</param>
+    /// <param name="comm">The communicator of the MPI processes</param>
+    MPIHaloExchange(int rank, int size, const std::vector<int>& rowCounts, int cols, int type, MPI_Comm comm = MPI_COMM_WORLD);
+
+    void Begin(const cv::Mat& image, int rowCount) override;
+
+    cv::Mat Finish() override;
+
+private:
+    int rank;
+    int size;
+    int cols;
+    int type;
+    size_t rowBytes;
+    MPI_Comm comm;
+    std::vector<int> rowCounts;
+    std::vector<int> rowBegins;
+
+    int sendRows = 0;
+    int receiveRows = 0;
+    bool sendPending = false;
+    cv::Mat pendingImage;
+    std::vector<uchar> sendBuffer;
+    std::vector<uchar> receiveBuffer;
+    MPI_Request sendRequest = MPI_REQUEST_NULL;
+    MPI_Request receiveRequest = MPI_REQUEST_NULL;
+
+    void SendRows();
+};
@@ -1,96 +1,523 @@
-#define RUN_SIMPLE
-#undef RUN_MPI
-#undef RUN_OPENCV
-
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <limits>
+#include <mpi.h>
 #include "AlgorithmBenchmark.h"
+#include "BenchmarkOptions.h"
+#include "BufferPool.h"
+#include "ImageCache.h"
+#include "RawImage.h"
 #include "ImageFilter.h"
+#include "FilterPipeline.h"
+#include "KernelBenchmark.h"
+#include "LookupTables.h"
+#include "NumaPlacement.h"
+#include "ScheduleTuner.h"
+#include "Trace.h"
 #include "SimpleFilters.cpp"
 #include "MPIFilters.cpp"
 #include "MPIFiltersInSingleLoop.cpp"
+#include "MPIFiltersPipelined.cpp"
+#include "MPIFiltersDynamic.cpp"
+#include "MPIFiltersBatch.cpp"
+#include "MPIFilterPlan.h"
 #include "OpenCVFilters.cpp"
+#include "StreamFilters.cpp"
+#include "BatchFilters.cpp"
+#include "VideoFilters.cpp"
 
-#ifdef RUN_MPI
-#include <mpi.h>
-#include <chrono>
-using std::chrono::duration;
-using std::chrono::high_resolution_clock;
-#endif
+/// <summary>
+/// Prints the statistics of a benchmark and the median duration of each of its phases.
+/// </summary>
+/// <param name="benchmark"></param>
+static void PrintBenchmarkStatistics(const AlgorithmBenchmark& benchmark) {
+    BenchmarkStatistics statistics = benchmark.GetStatistics();
+    std::cout << "Min / Median / P95 / P99 Duration: " << statistics.min << " / " << statistics.median << " / "
+        << statistics.p95 << " / " << statistics.p99 << "ms" << std::endl;
+    std::cout << "Standard Deviation: " << statistics.stdDev << "ms" << std::endl;
+    for (const auto& phaseName : benchmark.GetPhaseNames()) {
+        std::cout << "Median " << phaseName << ": " << benchmark.GetPhaseStatistics(phaseName).median << "ms" << std::endl;
+    }
+}
 
-int main(int argc, char** argv) {
-    const std::string imagePath = "";
-    const std::string outputDir = "";
-    const int numberOfRepetitions = 100;
+/// <summary>
+/// Prints the hits and misses of the buffer pool and the most memory it held, if it is used.
+/// </summary>
+/// <param name="pool"></param>
+static void PrintBufferPoolStatistics(const BufferPool& pool) {
+    if (pool.GetMemoryLimit() == 0) return;
+    std::cout << "Buffer Pool Hits / Misses / Evictions: " << pool.GetHits() << " / " << pool.GetMisses() << " / "
+        << pool.GetEvictions() << std::endl;
+    std::cout << "Buffer Pool Peak Memory: " << pool.GetPeakMemoryUsage() / (1024.0 * 1024.0) << "MiB" << std::endl;
+}
 
-    const bool useOpenMP = true;
-    const bool showImage = false;
-    const bool saveImage = false;
+/// <summary>
+/// Collects the totals of the trace of every process on the host process, or only of the host process if the
+/// configuration does not use MPI.
+/// </summary>
+/// <param name="usesMPI">Wether all processes ran the configuration</param>
+/// <param name="rank">The rank of the current MPI process</param>
+/// <param name="size">The size of the MPI processes</param>
+/// <returns>The totals of every process on the host process</returns>
+static std::vector<TraceTotals> GatherTraceTotals(bool usesMPI, int rank, int size) {
+    TraceTotals totals = Trace::GetTotals();
+    if (!usesMPI) return { totals };
 
-    if (useOpenMP)
-        omp_set_num_threads(omp_get_num_procs());
+    // the totals only consist of doubles, so they are sent as an array of doubles
+    const int values = static_cast<int>(sizeof(TraceTotals) / sizeof(double));
+    std::vector<TraceTotals> allTotals((rank == 0) ? size : 0);
+    MPI_Gather(&totals, values, MPI_DOUBLE, allTotals.data(), values, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    return allTotals;
+}
 
-    // defines what filters will be run in what order
-    std::vector<std::function<void(cv::Mat&, bool)>> filterMethods = {
-        &ImageFilter::HSVImage,
-        &ImageFilter::GrayscaleImage,
-        &ImageFilter::EmbossImage,
-    };
+/// <summary>
+/// Prints the time every process spent on computing and waiting for communication, the time its threads were busy
+/// and idle in the parallel loops, the bytes it moved and its hardware counters during the filters.
+/// </summary>
+/// <param name="allTotals">The totals of every process</param>
+static void PrintTraceTotals(const std::vector<TraceTotals>& allTotals) {
+    for (size_t rank = 0; rank < allTotals.size(); rank++) {
+        const TraceTotals& totals = allTotals[rank];
+        const std::string process = (allTotals.size() > 1) ? "Rank " + std::to_string(rank) + " " : "";
+        std::cout << process << "Compute / MPI Wait: " << totals.compute << " / " << totals.communication << "ms" << std::endl;
+        std::cout << process << "Thread Busy / Idle: " << totals.busy << " / " << totals.idle << "ms" << std::endl;
+        std::cout << process << "Filtered / Communicated: " << totals.computeBytes / (1024.0 * 1024.0) << " / "
+            << totals.communicationBytes / (1024.0 * 1024.0) << "MiB" << std::endl;
+        if (totals.cycles > 0) {
+            std::cout << process << "Instructions per Cycle / Cache Misses: " << totals.instructions / totals.cycles << " / "
+                << totals.cacheMisses << std::endl;
+        }
+    }
+}
 
-    AlgorithmBenchmark benchmark{};
+/// <summary>
+/// Saves the events of the traces of all processes as a single Chrome trace on the host process.
+/// </summary>
+/// <param name="tracePath">The file path of the trace</param>
+/// <param name="usesMPI">Wether MPI was initialized</param>
+/// <param name="rank">The rank of the current MPI process</param>
+/// <param name="size">The size of the MPI processes</param>
+static void SaveTrace(const std::string& tracePath, bool usesMPI, int rank, int size) {
+    std::ostringstream eventStream;
+    Trace::WriteEvents(eventStream);
+    std::string events = eventStream.str();
 
-#ifdef RUN_SIMPLE
-    // run a benchmark of the defined filter methods
-    std::cout << "Simple Filters: " << std::endl;
-    auto simpleAlgorithm = std::bind(SimpleFilters, imagePath, outputDir, filterMethods, useOpenMP, showImage, saveImage);
-    benchmark.RunBenchmark(simpleAlgorithm, numberOfRepetitions);
-    std::cout << "Total Duration: " << benchmark.GetTotalDuration() << "ms" << std::endl;
-    std::cout << "Average Duration: " << benchmark.GetAvgDuration() << "ms" << std::endl;
-    std::cout << std::endl;
-    benchmark.ResetBenchmark();
-#endif
-
-#ifdef RUN_MPI
-    // run a benchmark of the defined filter methods divided between mpi processes
-    auto startTimeMPI = high_resolution_clock::now();
-    int rank, size;
-    MPI_Init(&argc, &argv);
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &size);
+    if (usesMPI) {
+        // the events of every process are joined into the array of events of the host process
+        int length = static_cast<int>(events.size());
+        std::vector<int> lengths(size);
+        MPI_Gather(&length, 1, MPI_INT, lengths.data(), 1, MPI_INT, 0, MPI_COMM_WORLD);
 
+        std::vector<int> displs(size, 0);
+        for (int i = 1; i < size; i++) displs[i] = displs[i - 1] + lengths[i - 1];
+        std::string allEvents((rank == 0) ? displs[size - 1] + lengths[size - 1] : 0, ' ');
+        MPI_Gatherv(events.data(), length, MPI_CHAR, allEvents.data(), lengths.data(), displs.data(), MPI_CHAR, 0, MPI_COMM_WORLD);
+
+        if (rank == 0) {
+            events.clear();
+            for (int i = 0; i < size; i++) {
+                events += (i == 0 ? "" : ",\n") + allEvents.substr(displs[i], lengths[i]);
+            }
+        }
+    }
+
+    if (rank != 0) return;
+    std::ofstream trace(tracePath);
+    trace << "{\"traceEvents\": [\n" << events << "\n], \"displayTimeUnit\": \"ms\"}" << std::endl;
+}
+
+/// <summary>
+/// Pins the OpenMP threads of a configuration to the processors and prints the memory bandwidth of every NUMA node.
+/// The released buffers of the pool are freed, so that the rows of the next images are placed for the new threads.
+/// </summary>
+/// <param name="configuration">The configuration that is benchmarked</param>
+/// <param name="rank">The rank of the current MPI process</param>
+/// <param name="processorShare">The number of the process among the MPI processes that share its processors and
+/// their number</param>
+static void PlaceThreads(const BenchmarkConfiguration& configuration, int rank, std::pair<int, int> processorShare) {
+    BufferPool::GetShared().Clear();
+
+    // the batch and video modes start threads of their own, which would inherit the processor of the main thread
+    if (configuration.mode == BenchmarkMode::Batch || configuration.mode == BenchmarkMode::Video) {
+        NumaPlacement::UnpinThreads();
+        return;
+    }
+
+    // the other modes only run on the host process, which has the processors to itself
+    if (!BenchmarkOptions::IsMPIMode(configuration.mode))
+        processorShare = { 0, 1 };
+    NumaPlacement::PinThreads(processorShare.first, processorShare.second);
     if (rank == 0) {
-        std::cout << "MPI Filters: " << std::endl;
+        for (const auto& node : NumaPlacement::MeasureBandwidth()) {
+            std::cout << "NUMA Node " << node.node << ": " << node.threads << " Threads, " << node.bandwidth << "GB/s" << std::endl;
+        }
+    }
+}
+
+/// <summary>
+/// Returns the number of the process among the MPI processes of its machine that may run on the same processors, and
+/// the number of these processes, which split the processors between them when their threads are pinned. Processes
+/// that the launcher bound to processors of their own do not share them.
+/// </summary>
+/// <param name="rank">The rank of the current MPI process</param>
+/// <returns></returns>
+static std::pair<int, int> GetProcessorShare(int rank) {
+    std::string cpuList;
+    for (const auto& node : NumaPlacement::GetNodes()) {
+        for (int cpu : node.cpus) cpuList += std::to_string(cpu) + ",";
+    }
+
+    MPI_Comm machine, sharing;
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &machine);
+    int color = static_cast<int>(std::hash<std::string>()(cpuList) % std::numeric_limits<int>::max());
+    MPI_Comm_split(machine, color, rank, &sharing);
+
+    std::pair<int, int> share;
+    MPI_Comm_rank(sharing, &share.first);
+    MPI_Comm_size(sharing, &share.second);
+    MPI_Comm_free(&sharing);
+    MPI_Comm_free(&machine);
+    return share;
+}
+
+/// <summary>
+/// Saves the results of all benchmarks as JSON if the path ends with .json and as CSV otherwise.
+/// </summary>
+/// <param name="resultsPath">The file path of the results</param>
+/// <param name="benchmarks">The configurations and results of the benchmarks</param>
+static void SaveBenchmarkResults(const std::string& resultsPath, const std::vector<std::pair<BenchmarkConfiguration, AlgorithmBenchmark>>& benchmarks) {
+    std::ofstream results(resultsPath);
+    bool json = resultsPath.size() >= 5 && resultsPath.compare(resultsPath.size() - 5, 5, ".json") == 0;
+
+    if (json) {
+        results << "[" << std::endl;
+        for (size_t i = 0; i < benchmarks.size(); i++) {
+            benchmarks[i].second.WriteJSON(results, benchmarks[i].first.GetName(false), benchmarks[i].first.input);
+            results << (i + 1 < benchmarks.size() ? "," : "") << std::endl;
+        }
+        results << "]" << std::endl;
+    }
+    else {
+        AlgorithmBenchmark::WriteCSVHeader(results);
+        for (const auto& benchmark : benchmarks) {
+            benchmark.second.WriteCSV(results, benchmark.first.GetName(false), benchmark.first.input);
+        }
+    }
+}
+
+/// <summary>
+/// Creates the algorithm that is benchmarked for a configuration. A plan is created for the MPI modes that reuse
+/// their processes between the repetitions, it has to be kept until the benchmark finished.
+/// </summary>
+/// <param name="configuration">The configuration that is benchmarked</param>
+/// <param name="options">The options of the benchmark</param>
+/// <param name="rank">The rank of the current MPI process</param>
+/// <param name="size">The size of the MPI processes</param>
+/// <param name="mpiPlan">Receives the plan of the MPI processes</param>
+/// <returns></returns>
+static std::function<void()> CreateAlgorithm(const BenchmarkConfiguration& configuration, const BenchmarkOptions& options,
+    int& rank, int& size, std::unique_ptr<MPIFilterPlan>& mpiPlan)
+{
+    const std::string& input = configuration.input;
+    auto filterMethods = options.GetFilterMethods(configuration);
+
+    // images in memory are decoded, or copied out of their raw file, once before the benchmark. All others are read
+    // through the image cache
+    ImageSource source(input);
+    if (options.inMemory && configuration.mode != BenchmarkMode::MPIBatch && configuration.mode != BenchmarkMode::Stream
+        && configuration.mode != BenchmarkMode::Batch && configuration.mode != BenchmarkMode::Video)
+        source = ImageSource((rank == 0) ? source.GetCopy() : cv::Mat());
+
+    switch (configuration.mode) {
+    case BenchmarkMode::Simple:
+        return std::bind(SimpleFilters, source, options.outputDir, filterMethods, options.useOpenMP, options.showImage, options.saveImage);
+    case BenchmarkMode::OpenCV:
+        return std::bind(OpenCVFilters, source, options.outputDir, options.showImage, options.saveImage,
+            options.HasFilter("hsv"), options.HasFilter("gray"), options.HasFilter("emboss"));
+    case BenchmarkMode::Stream:
+        return std::bind(StreamFilters, input, options.outputDir, filterMethods, options.streamStripRows, options.useOpenMP, options.saveImage);
+    case BenchmarkMode::Batch:
+        return std::bind(BatchFilters, input, options.outputDir, filterMethods, options.batchDecodeWorkers,
+            options.batchFilterWorkers, options.batchEncodeWorkers, options.batchQueueCapacity, options.batchMemoryBudget,
+            options.useOpenMP, options.saveImage);
+    case BenchmarkMode::Video:
+        return std::bind(VideoFilters, input, options.outputDir, filterMethods, options.videoFrameBuffers,
+            options.videoMaxLatency, options.videoTileSize, options.useOpenMP, options.saveImage);
+    case BenchmarkMode::MPI:
+    case BenchmarkMode::MPISingleLoop:
+        // the processes are set up once for the geometry of the image and reused by all repetitions, which also
+        // allows to balance the rows by the measured throughput
+        mpiPlan = std::make_unique<MPIFilterPlan>(rank, size, (rank == 0) ? source.Get() : cv::Mat(),
+            configuration.mode == BenchmarkMode::MPI && options.mpiSharedMemory);
+        if (configuration.mode == BenchmarkMode::MPI)
+            return std::bind(MPIFilters, std::ref(*mpiPlan), source, options.outputDir, filterMethods,
+                options.useOpenMP, options.showImage, options.saveImage, options.mpiBalanceLoad);
+        return std::bind(MPIFiltersInSingleLoop, std::ref(*mpiPlan), source, options.outputDir, options.useOpenMP,
+            options.showImage, options.saveImage, options.HasFilter("hsv"), options.HasFilter("gray"),
+            options.HasFilter("emboss"), options.mpiBalanceLoad);
+    case BenchmarkMode::MPIPipelined:
+        return std::bind(MPIFiltersPipelined, rank, size, source, options.outputDir, filterMethods, options.mpiStripCount,
+            options.useOpenMP, options.showImage, options.saveImage);
+    case BenchmarkMode::MPIDynamic:
+        return std::bind(MPIFiltersDynamic, rank, size, source, options.outputDir, filterMethods, options.mpiChunkRows,
+            options.useOpenMP, options.showImage, options.saveImage);
+    case BenchmarkMode::MPIBatch:
+        return std::bind(MPIFiltersBatch, rank, size, input, options.outputDir, filterMethods, options.useOpenMP, options.saveImage);
+    }
+    throw std::invalid_argument("The mode is unknown!");
+}
+
+/// <summary>
+/// Reads the image a schedule is tuned on, which is the part of the input that a single filter call of the mode
+/// filters: the block of rows of a process, a strip, or the first image or frame of a batch or video.
+/// </summary>
+/// <param name="configuration">The configuration that is benchmarked</param>
+/// <param name="options">The options of the benchmark</param>
+/// <param name="size">The size of the MPI processes</param>
+/// <returns>The image, which is empty if the input could not be read</returns>
+static cv::Mat ReadTuningImage(const BenchmarkConfiguration& configuration, const BenchmarkOptions& options, int size)
+{
+    const std::string& input = configuration.input;
+    switch (configuration.mode) {
+    case BenchmarkMode::Batch:
+    case BenchmarkMode::MPIBatch: {
+        std::vector<std::string> imagePaths = GetBatchImagePaths(input);
+        return imagePaths.empty() ? cv::Mat() : ImageSource(imagePaths.front()).Decode();
+    }
+    case BenchmarkMode::Video: {
+        cv::VideoCapture capture(input);
+        cv::Mat frame;
+        if (capture.isOpened()) capture.read(frame);
+        return frame;
+    }
+    case BenchmarkMode::Stream: {
+        auto reader = StripReader::Open(input);
+        cv::Mat strip(std::min(options.streamStripRows, reader->GetRows()), reader->GetCols(), reader->GetType());
+        reader->Read(0, strip);
+        return strip;
+    }
+    default:
+        break;
+    }
+
+    // the source keeps the pixels of raw images mapped until the rows are copied
+    ImageSource source(input);
+    cv::Mat image = source.Get();
+    if (image.empty()) return image;
+    int rows = image.rows;
+    if (configuration.mode == BenchmarkMode::MPI)
+        rows = image.rows / size;
+    else if (configuration.mode == BenchmarkMode::MPIPipelined)
+        rows = image.rows / (size * options.mpiStripCount);
+    else if (configuration.mode == BenchmarkMode::MPIDynamic)
+        rows = options.mpiChunkRows;
+    return image.rowRange(0, std::max(1, std::min(rows, image.rows))).clone();
+}
+
+/// <summary>
+/// Activates the schedule of a configuration. Tuned schedules are looked up in the tuning cache or tuned on the
+/// host process, which shares them with all processes of the MPI modes.
+/// </summary>
+/// <param name="configuration">The configuration that is benchmarked</param>
+/// <param name="options">The options of the benchmark</param>
+/// <param name="rank">The rank of the current MPI process</param>
+/// <param name="size">The size of the MPI processes</param>
+/// <param name="tuningCache">The cache of the tuned schedules, only used on the host process</param>
+static void SelectSchedule(const BenchmarkConfiguration& configuration, const BenchmarkOptions& options,
+    int rank, int size, TuningCache* tuningCache)
+{
+    TileSchedule schedule = options.schedule;
+    if (!options.tuneSchedule || !BenchmarkOptions::UsesFilterMethods(configuration.mode)) {
+        TileScheduler::SetSchedule(schedule);
+        return;
     }
 
-    auto mpiAlgorithm = std::bind(MPIFilters, rank, size, imagePath, outputDir, filterMethods, useOpenMP, showImage, saveImage);
-    benchmark.RunBenchmark(mpiAlgorithm, numberOfRepetitions);
     if (rank == 0) {
-        auto endTimeMPI = high_resolution_clock::now();
-        duration<double, std::milli> duration = endTimeMPI - startTimeMPI;
-        std::cout << "Total Duration: " << duration.count() << "ms" << std::endl;
-        std::cout << "Total Duration Algorithm: " << benchmark.GetTotalDuration() << "ms" << std::endl;
-        std::cout << "Average Duration Algorithm: " << benchmark.GetAvgDuration() << "ms" << std::endl;
-        std::cout << std::endl;
-    }
-    benchmark.ResetBenchmark();
-
-    MPI_Finalize();
-#endif
-
-#ifdef RUN_OPENCV
-    // run a benchmark of all filter methods using opencv
-    const bool doHSV = true;
-    const bool doGrayscale = true;
-    const bool doEmboss = true;
-    std::cout << "OpenCV Filters: " << std::endl;
-    auto openCVAlgorithm = std::bind(OpenCVFilters, imagePath, outputDir, showImage, saveImage, doHSV, doGrayscale, doEmboss);
-    benchmark.RunBenchmark(openCVAlgorithm, numberOfRepetitions);
-    std::cout << "Total Duration: " << benchmark.GetTotalDuration() << "ms" << std::endl;
-    std::cout << "Average Duration: " << benchmark.GetAvgDuration() << "ms" << std::endl;
-    std::cout << std::endl;
-    benchmark.ResetBenchmark();
-#endif
-
-    cv::waitKey(0);
+        cv::Mat image = ReadTuningImage(configuration, options, size);
+        if (!image.empty()) {
+            auto filterMethods = options.GetFilterMethods(configuration);
+            std::string key = TuningCache::GetKey(FilterPipeline::GetFilterName(FilterPipeline::FromFilterMethods(filterMethods)),
+                image, options.useOpenMP ? configuration.threads : 1);
+            bool cached = tuningCache->Find(key, schedule);
+            if (!cached) {
+                schedule = ScheduleTuner::Tune(filterMethods, image, options.useOpenMP);
+                tuningCache->Set(key, schedule);
+            }
+            std::cout << "Schedule: " << schedule.GetName() << (cached ? " (cached)" : " (tuned)") << std::endl;
+        }
+    }
+
+    if (BenchmarkOptions::IsMPIMode(configuration.mode)) {
+        int values[3] = { static_cast<int>(schedule.policy), schedule.tileRows, schedule.tileCols };
+        MPI_Bcast(values, 3, MPI_INT, 0, MPI_COMM_WORLD);
+        schedule = { static_cast<SchedulePolicy>(values[0]), values[1], values[2] };
+    }
+    TileScheduler::SetSchedule(schedule);
+}
+
+/// <summary>
+/// Checks and measures the kernels on every backend and number of threads and saves the throughputs the baseline
+/// did not have yet. Returns the exit code, which is 1 if a kernel differs from its references or got slower than
+/// the threshold allows.
+/// </summary>
+/// <param name="options"></param>
+/// <returns></returns>
+static int RunKernelBenchmark(const BenchmarkOptions& options) {
+    std::unique_ptr<KernelBaseline> baseline;
+    try {
+        baseline = std::make_unique<KernelBaseline>(options.kernelBaselinePath);
+    }
+    catch (const std::invalid_argument& exception) {
+        std::cerr << exception.what() << std::endl;
+        return 1;
+    }
+
+    std::vector<int> threadCounts = options.threads;
+    if (threadCounts.empty()) threadCounts.push_back(omp_get_num_procs());
+
+    int failures = 0;
+    for (ParallelBackend backend : options.backends) {
+        TileScheduler::SetBackend(backend);
+        for (int threads : threadCounts) {
+            if (options.useOpenMP)
+                TileScheduler::SetThreadCount(threads);
+            std::cout << "kernels threads=" << (options.useOpenMP ? threads : 1) << " backend="
+                << TileScheduler::GetBackendName(backend) << " simd=" << SimdKernels::GetKernels().name << ": " << std::endl;
+            failures += KernelBenchmark::Run(*baseline, options.kernelThreshold, options.updateKernelBaseline, options.useOpenMP);
+            std::cout << std::endl;
+        }
+    }
+
+    baseline->Save();
+    std::cout << (failures == 0 ? "All kernel checks passed" : std::to_string(failures) + " kernel checks failed") << std::endl;
+    return (failures == 0) ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    BenchmarkOptions options;
+    try {
+        options = BenchmarkOptions::Parse(argc, argv);
+    }
+    catch (const std::invalid_argument& exception) {
+        std::cerr << exception.what() << std::endl << std::endl << BenchmarkOptions::GetUsage(argv[0]);
+        return 1;
+    }
+
+    if (options.showHelp) {
+        std::cout << BenchmarkOptions::GetUsage(argv[0]);
+        return 0;
+    }
+
+    // images are converted between the raw image format and the formats of OpenCV without running a benchmark
+    if (!options.convertPath.empty()) {
+        try {
+            ImageOutput::Convert(options.inputs[0], options.convertPath);
+        }
+        catch (const std::exception& exception) {
+            std::cerr << exception.what() << std::endl;
+            return 1;
+        }
+        return 0;
+    }
+
+    ImageOutput::SetExtension(options.outputFormat);
+
+    // the kernels are checked and measured on synthetic images instead of benchmarking the inputs
+    if (!options.kernelBaselinePath.empty()) {
+        BufferPool::Install(options.poolMemoryLimit, options.numa);
+        SimdKernels::SetLookupTables(options.lookupTables);
+        TileScheduler::SetSchedule(options.schedule);
+        return RunKernelBenchmark(options);
+    }
+
+    // MPI is only initialized if it is used, all other modes only run on the host process
+    int rank = 0, size = 1;
+    if (options.UsesMPI()) {
+        MPI_Init(&argc, &argv);
+        MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+        MPI_Comm_size(MPI_COMM_WORLD, &size);
+    }
+
+    // the processors are read before any thread is pinned
+    std::pair<int, int> processorShare{ 0, 1 };
+    if (options.numa && options.UsesMPI())
+        processorShare = GetProcessorShare(rank);
+
+    // the trace is enabled before any thread is started, the processes start their clocks at the same time
+    if (!options.tracePath.empty()) {
+        if (options.UsesMPI())
+            MPI_Barrier(MPI_COMM_WORLD);
+        Trace::Enable(rank);
+    }
+
+    // the buffers of all images are pooled, so that repetitions reuse the pages of the previous repetition
+    BufferPool::Install(options.poolMemoryLimit, options.numa);
+    ImageCache::GetShared().SetMemoryBudget(options.cacheMemoryBudget);
+
+    // the lookup tables are built before the benchmarks, so that no repetition measures building them
+    SimdKernels::SetLookupTables(options.lookupTables);
+    if (options.lookupTables && options.HasFilter("hsv"))
+        LookupTables::GetHSVTable();
+
+    // the results of all benchmarks are kept to be saved for comparisons between builds
+    // the tuned schedules are only kept by the host process, which tunes them
+    std::unique_ptr<TuningCache> tuningCache;
+    if (options.tuneSchedule && rank == 0)
+        tuningCache = std::make_unique<TuningCache>(options.tuningCachePath);
+
+    AlgorithmBenchmark benchmark{};
+    benchmark.SetWarmupRepetitions(options.warmupRepetitions);
+    std::vector<std::pair<BenchmarkConfiguration, AlgorithmBenchmark>> benchmarkResults;
+
+    for (const auto& configuration : options.GetConfigurations()) {
+        if (!BenchmarkOptions::IsMPIMode(configuration.mode) && rank != 0)
+            continue;
+
+        TileScheduler::SetBackend(configuration.backend);
+        if (options.useOpenMP)
+            TileScheduler::SetThreadCount(configuration.threads);
+
+        const std::string name = configuration.GetName();
+        if (rank == 0) {
+            std::cout << name << ": " << std::endl;
+        }
+        if (options.numa)
+            PlaceThreads(configuration, rank, processorShare);
+        SelectSchedule(configuration, options, rank, size, tuningCache.get());
+
+        std::unique_ptr<MPIFilterPlan> mpiPlan;
+        auto algorithm = CreateAlgorithm(configuration, options, rank, size, mpiPlan);
+        BufferPool::GetShared().ResetStatistics();
+        Trace::ResetTotals();
+        benchmark.RunBenchmark(algorithm, options.repetitions);
+
+        std::vector<TraceTotals> traceTotals;
+        if (Trace::IsEnabled())
+            traceTotals = GatherTraceTotals(BenchmarkOptions::IsMPIMode(configuration.mode), rank, size);
+        if (rank == 0) {
+            std::cout << "Total Duration: " << benchmark.GetTotalDuration() << "ms" << std::endl;
+            std::cout << "Average Duration: " << benchmark.GetAvgDuration() << "ms" << std::endl;
+            PrintBenchmarkStatistics(benchmark);
+            PrintBufferPoolStatistics(BufferPool::GetShared());
+            PrintTraceTotals(traceTotals);
+            std::cout << std::endl;
+            benchmarkResults.push_back({ configuration, benchmark });
+        }
+        benchmark.ResetBenchmark();
+    }
+
+    if (Trace::IsEnabled())
+        SaveTrace(options.tracePath, options.UsesMPI(), rank, size);
+
+    if (options.UsesMPI())
+        MPI_Finalize();
+
+    if (!options.resultsPath.empty() && !benchmarkResults.empty())
+        SaveBenchmarkResults(options.resultsPath, benchmarkResults);
+
+    if (options.showImage)
+        cv::waitKey(0);
 
     return 0;
 }
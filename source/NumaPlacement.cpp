@@ -0,0 +1,313 @@
+#include "NumaPlacement.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <omp.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <filesystem>
+#include <fstream>
+#include <sched.h>
+#endif
+
+namespace
+{
+    /// <summary>
+    /// The processors of the process ordered by their nodes, which are read before any thread was pinned.
+    /// </summary>
+    struct Topology
+    {
+        std::vector<NumaNode> nodes;
+        std::vector<int> cpus;
+        std::vector<int> cpuNodes;
+#ifdef _WIN32
+        DWORD_PTR processMask = 0;
+#elif defined(__linux__)
+        cpu_set_t processSet;
+#endif
+    };
+
+#if defined(__linux__)
+    /// <summary>
+    /// Parses a list of processors like "0-3,8-11" as the kernel writes it.
+    /// </summary>
+    std::vector<int> ParseCpuList(const std::string& list)
+    {
+        std::vector<int> cpus;
+        size_t begin = 0;
+        while (begin < list.size()) {
+            size_t end = list.find(',', begin);
+            if (end == std::string::npos) end = list.size();
+            std::string range = list.substr(begin, end - begin);
+            size_t dash = range.find('-');
+            try {
+                int first = std::stoi(range.substr(0, dash));
+                int last = (dash == std::string::npos) ? first : std::stoi(range.substr(dash + 1));
+                for (int cpu = first; cpu <= last; cpu++) cpus.push_back(cpu);
+            }
+            catch (const std::exception&) {
+                // an empty or unreadable range contributes no processors
+            }
+            begin = end + 1;
+        }
+        return cpus;
+    }
+#endif
+
+    Topology ReadTopology()
+    {
+        Topology topology;
+        std::vector<int> allowedCpus;
+
+#ifdef _WIN32
+        DWORD_PTR systemMask = 0;
+        GetProcessAffinityMask(GetCurrentProcess(), &topology.processMask, &systemMask);
+        for (int cpu = 0; cpu < static_cast<int>(sizeof(DWORD_PTR) * 8); cpu++) {
+            if (topology.processMask & (DWORD_PTR(1) << cpu)) allowedCpus.push_back(cpu);
+        }
+
+        ULONG highestNode = 0;
+        if (GetNumaHighestNodeNumber(&highestNode)) {
+            for (ULONG node = 0; node <= highestNode; node++) {
+                ULONGLONG nodeMask = 0;
+                if (!GetNumaNodeProcessorMask(static_cast<UCHAR>(node), &nodeMask)) continue;
+                NumaNode numaNode{ static_cast<int>(node), {} };
+                for (int cpu : allowedCpus) {
+                    if (nodeMask & (ULONGLONG(1) << cpu)) numaNode.cpus.push_back(cpu);
+                }
+                if (!numaNode.cpus.empty()) topology.nodes.push_back(numaNode);
+            }
+        }
+#elif defined(__linux__)
+        CPU_ZERO(&topology.processSet);
+        sched_getaffinity(0, sizeof(topology.processSet), &topology.processSet);
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &topology.processSet)) allowedCpus.push_back(cpu);
+        }
+
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator("/sys/devices/system/node", error)) {
+            std::string name = entry.path().filename().string();
+            if (name.size() < 5 || name.compare(0, 4, "node") != 0
+                || !std::all_of(name.begin() + 4, name.end(), [](char c) { return c >= '0' && c <= '9'; }))
+                continue;
+
+            std::ifstream cpuListFile(entry.path() / "cpulist");
+            std::string cpuList;
+            std::getline(cpuListFile, cpuList);
+            NumaNode numaNode{ std::stoi(name.substr(4)), {} };
+            for (int cpu : ParseCpuList(cpuList)) {
+                if (std::find(allowedCpus.begin(), allowedCpus.end(), cpu) != allowedCpus.end()) numaNode.cpus.push_back(cpu);
+            }
+            if (!numaNode.cpus.empty()) topology.nodes.push_back(numaNode);
+        }
+        std::sort(topology.nodes.begin(), topology.nodes.end(), [](const NumaNode& a, const NumaNode& b) { return a.id < b.id; });
+#else
+        for (int cpu = 0; cpu < omp_get_num_procs(); cpu++) allowedCpus.push_back(cpu);
+#endif
+
+        // processors that no node lists, e.g. without NUMA support, belong to a single node
+        std::vector<int> unlistedCpus;
+        for (int cpu : allowedCpus) {
+            bool listed = std::any_of(topology.nodes.begin(), topology.nodes.end(), [&](const NumaNode& node) {
+                return std::find(node.cpus.begin(), node.cpus.end(), cpu) != node.cpus.end();
+            });
+            if (!listed) unlistedCpus.push_back(cpu);
+        }
+        if (topology.nodes.empty() || !unlistedCpus.empty()) {
+            if (topology.nodes.empty()) topology.nodes.push_back({ 0, {} });
+            topology.nodes.front().cpus.insert(topology.nodes.front().cpus.end(), unlistedCpus.begin(), unlistedCpus.end());
+        }
+
+        for (const NumaNode& node : topology.nodes) {
+            for (int cpu : node.cpus) {
+                topology.cpus.push_back(cpu);
+                topology.cpuNodes.push_back(node.id);
+            }
+        }
+        return topology;
+    }
+
+    const Topology& GetTopology()
+    {
+        static const Topology topology = ReadTopology();
+        return topology;
+    }
+
+    // the consecutive processors the threads of the process are pinned to, which are only changed while no
+    // parallel region runs
+    size_t shareBegin = 0;
+    size_t shareCount = 0;
+    std::atomic<bool> pinning{ false };
+    // the processor the thread was pinned to, -1 if it may run on all processors of the process
+    thread_local int pinnedCpu = -1;
+
+    /// <summary>
+    /// Returns wether the OpenMP runtime binds its threads to places itself, e.g. with OMP_PROC_BIND and OMP_PLACES.
+    /// </summary>
+    bool RuntimeBindsThreads()
+    {
+#if defined(_OPENMP) && _OPENMP >= 201307
+        return omp_get_proc_bind() != omp_proc_bind_false;
+#else
+        // runtimes before OpenMP 4.0, e.g. MSVC with /openmp, cannot be asked, so the variables are read instead
+        const char* procBind = std::getenv("OMP_PROC_BIND");
+        const char* places = std::getenv("OMP_PLACES");
+        std::string binding = procBind ? procBind : "";
+        std::transform(binding.begin(), binding.end(), binding.begin(), [](char c) { return static_cast<char>(std::tolower(static_cast<unsigned char>(c))); });
+        return (!binding.empty() && binding != "false") || (binding.empty() && places && *places);
+#endif
+    }
+
+    /// <summary>
+    /// Returns the index of the processor a thread is pinned to in the processors ordered by their nodes.
+    /// </summary>
+    size_t GetCpuIndex(int thread, int threadCount)
+    {
+        const size_t cpuCount = (shareCount > 0) ? shareCount : GetTopology().cpus.size();
+        return shareBegin + static_cast<size_t>(thread) * cpuCount / std::max(1, threadCount) % cpuCount;
+    }
+}
+
+const std::vector<NumaNode>& NumaPlacement::GetNodes()
+{
+    return GetTopology().nodes;
+}
+
+int NumaPlacement::GetNodeOfThread(int thread, int threadCount)
+{
+    return GetTopology().cpuNodes[GetCpuIndex(thread, threadCount)];
+}
+
+void NumaPlacement::PinThreads(int process, int processCount)
+{
+    // processes that share fewer processors than they are take one processor each, which they share in turn
+    const size_t cpuCount = GetTopology().cpus.size();
+    processCount = std::max(1, processCount);
+    size_t begin = static_cast<size_t>(process) * cpuCount / processCount;
+    size_t end = static_cast<size_t>(process + 1) * cpuCount / processCount;
+    shareBegin = begin % cpuCount;
+    shareCount = std::max<size_t>(1, end - begin);
+
+    // a binding of the runtime places the threads itself
+    if (RuntimeBindsThreads()) {
+        pinning = false;
+        return;
+    }
+
+    pinning = true;
+    #pragma omp parallel
+    PinTeamThread();
+}
+
+void NumaPlacement::PinTeamThread()
+{
+    if (!pinning.load(std::memory_order_relaxed)) return;
+
+    int cpu = GetTopology().cpus[GetCpuIndex(omp_get_thread_num(), omp_get_num_threads())];
+    if (cpu == pinnedCpu) return;
+    pinnedCpu = cpu;
+#ifdef _WIN32
+    SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpu);
+#elif defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    sched_setaffinity(0, sizeof(set), &set);
+#endif
+}
+
+void NumaPlacement::UnpinThreads()
+{
+    const Topology& topology = GetTopology();
+    pinning = false;
+    shareBegin = 0;
+    shareCount = 0;
+
+    #pragma omp parallel
+    {
+        pinnedCpu = -1;
+#ifdef _WIN32
+        SetThreadAffinityMask(GetCurrentThread(), topology.processMask);
+#elif defined(__linux__)
+        sched_setaffinity(0, sizeof(topology.processSet), &topology.processSet);
+#else
+        (void)topology;
+#endif
+    }
+}
+
+void NumaPlacement::FirstTouch(uchar* data, size_t bytes)
+{
+    // touching every 4 KiB is enough for the smallest pages, larger pages are touched more often than needed
+    const size_t pageSize = 4096;
+    const size_t firstPage = (pageSize - reinterpret_cast<uintptr_t>(data) % pageSize) % pageSize;
+    const int threadCount = omp_get_max_threads();
+
+    // every page is touched by the thread whose block holds the first byte of the page
+    #pragma omp parallel
+    {
+        PinTeamThread();
+        #pragma omp for schedule(static)
+        for (int thread = 0; thread < threadCount; thread++) {
+            size_t begin = bytes * thread / threadCount;
+            size_t end = bytes * (thread + 1) / threadCount;
+            if (begin == 0 && end > 0) data[0] = 0;
+            size_t offset = (begin <= firstPage) ? firstPage : firstPage + (begin - firstPage + pageSize - 1) / pageSize * pageSize;
+            for (; offset < end; offset += pageSize) data[offset] = 0;
+        }
+    }
+}
+
+std::vector<NumaBandwidth> NumaPlacement::MeasureBandwidth(size_t bytesPerThread)
+{
+    const int passes = 4;
+    const size_t halfBytes = bytesPerThread / 2;
+    std::vector<double> durations(omp_get_max_threads(), 0);
+    int threadCount = 1;
+
+    #pragma omp parallel
+    {
+        PinTeamThread();
+        int thread = omp_get_thread_num();
+        #pragma omp single
+        threadCount = omp_get_num_threads();
+
+        // the buffer is first touched by its thread, which places it on the node of the thread
+        std::vector<uchar> buffer(2 * halfBytes, 1);
+        #pragma omp barrier
+
+        auto begin = std::chrono::high_resolution_clock::now();
+        for (int pass = 0; pass < passes; pass++) {
+            if (pass % 2 == 0) std::memcpy(buffer.data() + halfBytes, buffer.data(), halfBytes);
+            else std::memcpy(buffer.data(), buffer.data() + halfBytes, halfBytes);
+        }
+        durations[thread] = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+    }
+
+    // the threads of a node ran at the same time, so the node moved their bytes in the time of its slowest thread
+    std::vector<NumaBandwidth> bandwidths;
+    for (const NumaNode& node : GetNodes()) {
+        NumaBandwidth nodeBandwidth{ node.id, 0, 0 };
+        double duration = 0;
+        for (int thread = 0; thread < threadCount; thread++) {
+            if (GetNodeOfThread(thread, threadCount) != node.id) continue;
+            nodeBandwidth.threads++;
+            duration = std::max(duration, durations[thread]);
+        }
+        if (nodeBandwidth.threads == 0) continue;
+
+        double bytes = 2.0 * halfBytes * passes * nodeBandwidth.threads;
+        nodeBandwidth.bandwidth = (duration > 0) ? bytes / duration / 1e9 : 0;
+        bandwidths.push_back(nodeBandwidth);
+    }
+    return bandwidths;
+}
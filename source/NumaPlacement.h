@@ -0,0 +1,91 @@
+#pragma once
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+
+/// <summary>
+/// A NUMA node and the processors of the process that belong to it.
+/// </summary>
+struct NumaNode
+{
+    int id;
+    std::vector<int> cpus;
+};
+
+/// <summary>
+/// The memory bandwidth the threads pinned to a NUMA node reached together on memory of their own node.
+/// </summary>
+struct NumaBandwidth
+{
+    int node;
+    int threads;
+    // gigabytes read and written per second
+    double bandwidth;
+};
+
+/// <summary>
+/// Places the OpenMP threads and the rows of the images on the NUMA nodes. The threads of a team are pinned to the
+/// processors in the order of their nodes, so that consecutive threads share a node, and the pages of a buffer are
+/// first touched by the thread that filters them with a static schedule, which places every block of rows on the
+/// node of its thread. Processes that share the processors, e.g. the MPI processes of a machine, are pinned to their
+/// own share of them. Without NUMA support of the operating system all processors belong to a single node.
+/// </summary>
+class NumaPlacement
+{
+public:
+    /// <summary>
+    /// Returns the NUMA nodes with at least one processor the process may run on, which is read once.
+    /// </summary>
+    /// <returns></returns>
+    static const std::vector<NumaNode>& GetNodes();
+
+    /// <summary>
+    /// Returns the node of the processor a thread of a team of the given size is pinned to, within the share of the
+    /// processors of the process.
+    /// </summary>
+    /// <param name="thread">The number of the thread in its team</param>
+    /// <param name="threadCount">The size of the team</param>
+    /// <returns></returns>
+    static int GetNodeOfThread(int thread, int threadCount);
+
+    /// <summary>
+    /// Pins the threads of the OpenMP teams to one processor each, spread evenly over the processors of the process
+    /// or, if several processes share them, over the consecutive share of this process. The runtime may run a
+    /// thread number on another thread between parallel regions, so the threads of the parallel regions of the
+    /// filters pin themselves again. If the binding of the runtime is set, e.g. with OMP_PROC_BIND and OMP_PLACES,
+    /// the runtime places the threads and they are not pinned.
+    /// </summary>
+    /// <param name="process">The number of the process among the processes that share the processors</param>
+    /// <param name="processCount">The number of processes that share the processors</param>
+    static void PinThreads(int process = 0, int processCount = 1);
+
+    /// <summary>
+    /// Pins the calling thread of an OpenMP team to the processor of its thread number, if the threads are pinned
+    /// and the thread was not pinned to that processor yet. Called at the start of every parallel region.
+    /// </summary>
+    static void PinTeamThread();
+
+    /// <summary>
+    /// Stops pinning the threads and lets every thread of the OpenMP team of the calling thread run on all
+    /// processors of the process again, e.g. before threads are started that inherit the processors of the calling
+    /// thread.
+    /// </summary>
+    static void UnpinThreads();
+
+    /// <summary>
+    /// Touches every page of a buffer that was not written yet from the OpenMP thread that filters it with a static
+    /// schedule, so that the operating system places the pages on the node of that thread. The buffer is split into
+    /// one consecutive block per thread, like the rows of an image.
+    /// </summary>
+    /// <param name="data">The first byte of the buffer</param>
+    /// <param name="bytes">The number of bytes of the buffer</param>
+    static void FirstTouch(uchar* data, size_t bytes);
+
+    /// <summary>
+    /// Measures the memory bandwidth of every node, with all threads of the OpenMP team copying a buffer in memory of
+    /// their own node at the same time. Should be called after PinThreads.
+    /// </summary>
+    /// <param name="bytesPerThread">The number of bytes every thread copies per pass, larger than its share of the caches</param>
+    /// <returns>The bandwidth of every node with at least one thread</returns>
+    static std::vector<NumaBandwidth> MeasureBandwidth(size_t bytesPerThread = size_t(16) * 1024 * 1024);
+};
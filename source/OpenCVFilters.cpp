@@ -1,10 +1,13 @@
 #include <iostream>
 #include <opencv2/opencv.hpp>
+#include "AlgorithmBenchmark.h"
+#include "ImageCache.h"
+#include "RawImage.h"
 
 /// <summary>
-/// Applies the specified filter methods on an image located at the specified file path.
+/// Applies the specified filter methods on the specified image.
 /// </summary>
-/// <param name="imagePath">The file path of the to be filtered image</param>
+/// <param name="source">The to be filtered image, which is read from a file or already decoded in memory</param>
 /// <param name="outputDir">The output directory path of the to be filtered image after saving</param>
 /// <param name="showImage">Wether to show the resulting image or not</param>
 /// <param name="saveImage">Wether to save the resulting image or not</param>
@@ -12,7 +15,7 @@
 /// <param name="doGrayscale">Wether to apply a grayscale filter on the image or not</param>
 /// <param name="doEmboss">Wether to apply an embossing filter on the image or not</param>
 static void OpenCVFilters(
-    const std::string& imagePath,
+    const ImageSource& source,
     const std::string& outputDir,
     bool showImage = false,
     bool saveImage = false,
@@ -20,7 +23,11 @@ static void OpenCVFilters(
     bool doGrayscale = true,
     bool doEmboss = true
 ) {
-    cv::Mat image = cv::imread(imagePath);
+    cv::Mat image;
+    {
+        BenchmarkPhase phase("decode");
+        image = source.GetCopy();
+    }
 
     if (image.empty())
         throw std::invalid_argument("Could not open or find the image!");
@@ -34,14 +41,17 @@ static void OpenCVFilters(
 
     // apply the filters
     if (doHSV) {
+        BenchmarkPhase phase("filter HSV");
         cv::cvtColor(image, image, cv::COLOR_RGB2HSV);
     }
 
     if (doGrayscale) {
+        BenchmarkPhase phase("filter Grayscale");
         cv::cvtColor(image, image, cv::COLOR_RGB2GRAY);
     }
 
     if (doEmboss) {
+        BenchmarkPhase phase("filter Emboss");
         cv::Mat kernel = (cv::Mat_<float>(3, 3) << 
             -1, 0, 0, 
              0, 0, 0, 
@@ -56,6 +66,7 @@ static void OpenCVFilters(
     }
 
     if (saveImage) {
-        cv::imwrite(outputDir + "/resulting_image_opencv.png", image);
+        BenchmarkPhase phase("encode");
+        ImageOutput::Write(ImageOutput::GetPath(outputDir, "resulting_image_opencv"), image);
     }
 }
@@ -0,0 +1,209 @@
+#include "RawImage.h"
+#include <cstring>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+const char* const RawImageFile::Extension = ".raw";
+
+static const char rawImageMagic[8] = { 'P', 'K', 'R', 'A', 'W', 'I', 'M', 'G' };
+static const uint32_t rawImageVersion = 1;
+static const uint64_t rawImageAlignment = 4096;
+
+RawImageFile::RawImageFile(const std::string& path, bool writable)
+{
+    Map(path, writable, 0);
+
+    RawImageHeader header;
+    if (mappingSize < sizeof(header)) {
+        Unmap();
+        throw std::invalid_argument("The file " + path + " is not a raw image!");
+    }
+    memcpy(&header, mapping, sizeof(header));
+
+    // the header is checked against the size of the file, so that a broken file never maps pixels outside of it
+    bool valid = memcmp(header.magic, rawImageMagic, sizeof(rawImageMagic)) == 0 && header.version == rawImageVersion
+        && header.rows > 0 && header.cols > 0 && header.type == CV_MAT_TYPE(header.type)
+        && header.step >= static_cast<uint64_t>(header.cols) * CV_ELEM_SIZE(header.type)
+        && header.dataOffset >= sizeof(header) && header.dataOffset <= mappingSize
+        && (mappingSize - header.dataOffset) / header.step >= static_cast<uint64_t>(header.rows);
+    if (!valid) {
+        Unmap();
+        throw std::invalid_argument("The file " + path + " is not a raw image!");
+    }
+
+    image = cv::Mat(header.rows, header.cols, header.type, static_cast<uchar*>(mapping) + header.dataOffset,
+        static_cast<size_t>(header.step));
+}
+
+RawImageFile::RawImageFile(const std::string& path, int rows, int cols, int type)
+{
+    if (rows < 1 || cols < 1)
+        throw std::invalid_argument("The raw image has to have at least one pixel!");
+
+    RawImageHeader header = {};
+    memcpy(header.magic, rawImageMagic, sizeof(rawImageMagic));
+    header.version = rawImageVersion;
+    header.rows = rows;
+    header.cols = cols;
+    header.type = type;
+    header.step = static_cast<uint64_t>(cols) * CV_ELEM_SIZE(type);
+    header.dataOffset = rawImageAlignment;
+
+    Map(path, true, static_cast<size_t>(header.dataOffset + header.step * rows));
+    memcpy(mapping, &header, sizeof(header));
+    image = cv::Mat(rows, cols, type, static_cast<uchar*>(mapping) + header.dataOffset, static_cast<size_t>(header.step));
+}
+
+RawImageFile::~RawImageFile()
+{
+    Unmap();
+}
+
+bool RawImageFile::HasRawExtension(const std::string& path)
+{
+    size_t length = strlen(Extension);
+    return path.size() >= length && path.compare(path.size() - length, length, Extension) == 0;
+}
+
+void RawImageFile::Write(const std::string& path, const cv::Mat& image)
+{
+    RawImageFile file(path, image.rows, image.cols, image.type());
+    image.copyTo(file.GetImage());
+}
+
+void RawImageFile::Map(const std::string& path, bool writable, size_t createSize)
+{
+    bool create = createSize > 0;
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ, FILE_SHARE_READ,
+        nullptr, create ? CREATE_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        throw std::invalid_argument("Could not open or find the raw image " + path + "!");
+    fileHandle = file;
+
+    LARGE_INTEGER fileSize;
+    fileSize.QuadPart = static_cast<LONGLONG>(createSize);
+    if (!create && !GetFileSizeEx(file, &fileSize)) {
+        Unmap();
+        throw std::invalid_argument("Could not open or find the raw image " + path + "!");
+    }
+    mappingSize = static_cast<size_t>(fileSize.QuadPart);
+    if (mappingSize == 0) return;
+
+    // a mapping larger than the file grows the file to the size of the mapping
+    mappingHandle = CreateFileMappingA(file, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY,
+        static_cast<DWORD>(fileSize.HighPart), static_cast<DWORD>(fileSize.LowPart), nullptr);
+    if (mappingHandle != nullptr)
+        mapping = MapViewOfFile(mappingHandle, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, mappingSize);
+#else
+    int descriptor = open(path.c_str(), writable ? O_RDWR | (create ? O_CREAT | O_TRUNC : 0) : O_RDONLY, 0644);
+    if (descriptor < 0)
+        throw std::invalid_argument("Could not open or find the raw image " + path + "!");
+    fileDescriptor = descriptor;
+
+    struct stat status;
+    if (create ? ftruncate(descriptor, static_cast<off_t>(createSize)) != 0 : fstat(descriptor, &status) != 0) {
+        Unmap();
+        throw std::invalid_argument("Could not open or find the raw image " + path + "!");
+    }
+    mappingSize = create ? createSize : static_cast<size_t>(status.st_size);
+    if (mappingSize == 0) return;
+
+    void* address = mmap(nullptr, mappingSize, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, descriptor, 0);
+    if (address != MAP_FAILED)
+        mapping = address;
+#endif
+
+    if (mapping == nullptr) {
+        Unmap();
+        throw std::runtime_error("Could not map the raw image " + path + "!");
+    }
+}
+
+void RawImageFile::Unmap()
+{
+    image.release();
+
+#ifdef _WIN32
+    if (mapping != nullptr) UnmapViewOfFile(mapping);
+    if (mappingHandle != nullptr) CloseHandle(mappingHandle);
+    if (fileHandle != nullptr) CloseHandle(fileHandle);
+    mappingHandle = nullptr;
+    fileHandle = nullptr;
+#else
+    if (mapping != nullptr) munmap(mapping, mappingSize);
+    if (fileDescriptor >= 0) close(fileDescriptor);
+    fileDescriptor = -1;
+#endif
+
+    mapping = nullptr;
+    mappingSize = 0;
+}
+
+std::string& ImageOutput::Extension()
+{
+    static std::string extension = ".png";
+    return extension;
+}
+
+void ImageOutput::SetExtension(const std::string& extension)
+{
+    Extension() = (extension.empty() || extension[0] == '.') ? extension : "." + extension;
+}
+
+const std::string& ImageOutput::GetExtension()
+{
+    return Extension();
+}
+
+bool ImageOutput::IsRaw()
+{
+    return Extension() == RawImageFile::Extension;
+}
+
+std::string ImageOutput::GetPath(const std::string& outputDir, const std::string& name)
+{
+    return outputDir + "/" + name + Extension();
+}
+
+bool ImageOutput::Write(const std::string& path, const cv::Mat& image)
+{
+    if (!RawImageFile::HasRawExtension(path))
+        return cv::imwrite(path, image);
+
+    // like imwrite, a raw image that cannot be saved is only reported by the result
+    try {
+        RawImageFile::Write(path, image);
+        return true;
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+}
+
+void ImageOutput::Convert(const std::string& inputPath, const std::string& outputPath)
+{
+    if (RawImageFile::HasRawExtension(inputPath)) {
+        RawImageFile input(inputPath);
+        if (!Write(outputPath, input.GetImage()))
+            throw std::invalid_argument("Could not save the image " + outputPath + "!");
+        return;
+    }
+
+    cv::Mat image = cv::imread(inputPath, cv::IMREAD_UNCHANGED);
+    if (image.empty())
+        throw std::invalid_argument("Could not open or find the image!");
+    if (!Write(outputPath, image))
+        throw std::invalid_argument("Could not save the image " + outputPath + "!");
+}
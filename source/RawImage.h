@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <opencv2/opencv.hpp>
+
+/// <summary>
+/// Header at the beginning of a raw image file. The pixels follow at the data offset, which is aligned to a page, so
+/// that the mapped pixels can be used by vectorized kernels without copying them.
+/// </summary>
+struct RawImageHeader
+{
+    char magic[8];
+    uint32_t version;
+    int32_t rows;
+    int32_t cols;
+    int32_t type;
+    uint64_t step;
+    uint64_t dataOffset;
+};
+
+/// <summary>
+/// Image in the raw container format that is memory-mapped into a cv::Mat header, so that it is read and written at
+/// page cache speed without decoding, encoding or copying its pixels. The image is only valid as long as the file
+/// stays mapped.
+/// </summary>
+class RawImageFile
+{
+public:
+    static const char* const Extension;
+
+    /// <summary>
+    /// Maps an existing raw image.
+    /// Throws an invalid_argument exception if the file could not be opened or is not a raw image.
+    /// </summary>
+    /// <param name="path">The file path of the raw image</param>
+    /// <param name="writable">Wether changes of the pixels are written back to the file</param>
+    explicit RawImageFile(const std::string& path, bool writable = false);
+
+    /// <summary>
+    /// Creates a raw image of the given geometry, replacing an existing file, and maps it writable. The pixels are
+    /// uninitialized until they are written through the image of the file.
+    /// </summary>
+    /// <param name="path">The file path of the raw image</param>
+    /// <param name="rows">The number of rows</param>
+    /// <param name="cols">The number of pixels per row</param>
+    /// <param name="type">The OpenCV type of the pixels</param>
+    RawImageFile(const std::string& path, int rows, int cols, int type);
+
+    ~RawImageFile();
+
+    RawImageFile(const RawImageFile&) = delete;
+    RawImageFile& operator=(const RawImageFile&) = delete;
+
+    /// <summary>
+    /// Returns the image whose pixels are mapped from the file.
+    /// </summary>
+    /// <returns></returns>
+    cv::Mat& GetImage() {
+        return image;
+    }
+
+    /// <summary>
+    /// Returns wether a path has the extension of raw images.
+    /// </summary>
+    /// <param name="path"></param>
+    /// <returns></returns>
+    static bool HasRawExtension(const std::string& path);
+
+    /// <summary>
+    /// Writes an image as a raw image.
+    /// </summary>
+    /// <param name="path">The file path of the raw image</param>
+    /// <param name="image"></param>
+    static void Write(const std::string& path, const cv::Mat& image);
+
+private:
+    void* mapping = nullptr;
+    size_t mappingSize = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#else
+    int fileDescriptor = -1;
+#endif
+    cv::Mat image;
+
+    void Map(const std::string& path, bool writable, size_t createSize);
+    void Unmap();
+};
+
+/// <summary>
+/// Saves the resulting images of the filters in the output format chosen by its file extension. Raw images are
+/// written through a mapping of the output file, all other formats are encoded by OpenCV.
+/// </summary>
+class ImageOutput
+{
+public:
+    /// <summary>
+    /// Sets the file extension of the output format, e.g. .png, .ppm or .raw.
+    /// </summary>
+    /// <param name="extension"></param>
+    static void SetExtension(const std::string& extension);
+
+    /// <summary>
+    /// Returns the file extension of the output format.
+    /// </summary>
+    /// <returns></returns>
+    static const std::string& GetExtension();
+
+    /// <summary>
+    /// Returns wether the output format is the raw image format.
+    /// </summary>
+    /// <returns></returns>
+    static bool IsRaw();
+
+    /// <summary>
+    /// Returns the path of an output image in the output format.
+    /// </summary>
+    /// <param name="outputDir">The output directory</param>
+    /// <param name="name">The name of the image without extension</param>
+    /// <returns></returns>
+    static std::string GetPath(const std::string& outputDir, const std::string& name);
+
+    /// <summary>
+    /// Saves an image in the format of the extension of its path.
+    /// </summary>
+    /// <param name="path">The file path of the image</param>
+    /// <param name="image"></param>
+    /// <returns>Wether the image could be saved</returns>
+    static bool Write(const std::string& path, const cv::Mat& image);
+
+    /// <summary>
+    /// Converts an image between the raw image format and the formats supported by OpenCV, e.g. PNG and PPM, by the
+    /// extensions of the paths.
+    /// </summary>
+    /// <param name="inputPath">The file path of the image</param>
+    /// <param name="outputPath">The file path of the converted image</param>
+    static void Convert(const std::string& inputPath, const std::string& outputPath);
+
+private:
+    static std::string& Extension();
+};
@@ -0,0 +1,120 @@
+#include "ScheduleTuner.h"
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include "SimdKernels.h"
+
+TuningCache::TuningCache(const std::string& path)
+    : path(path)
+{
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+
+        // the key is everything before the last three fields, which hold the schedule
+        std::istringstream fields(line);
+        std::vector<std::string> values;
+        std::string value;
+        while (fields >> value) values.push_back(value);
+        if (values.size() < 5)
+            throw std::invalid_argument("The line " + line + " of the tuning cache " + path + " is invalid!");
+
+        TileSchedule schedule;
+        size_t keyFields = values.size() - 3;
+        try {
+            schedule.policy = TileScheduler::ParsePolicy(values[keyFields]);
+            schedule.tileRows = std::stoi(values[keyFields + 1]);
+            schedule.tileCols = std::stoi(values[keyFields + 2]);
+        }
+        catch (const std::exception&) {
+            throw std::invalid_argument("The line " + line + " of the tuning cache " + path + " is invalid!");
+        }
+
+        std::string key = values[0];
+        for (size_t i = 1; i < keyFields; i++) key += " " + values[i];
+        schedules[key] = schedule;
+    }
+}
+
+std::string TuningCache::GetKey(const std::string& filterName, const cv::Mat& image, int threads)
+{
+    // the names of the kernels contain spaces, which separate the fields of a line
+    std::string kernels = SimdKernels::GetKernels().name;
+    for (char& c : kernels) {
+        if (c == ' ') c = '-';
+    }
+    return filterName + " " + std::to_string(image.cols) + "x" + std::to_string(image.rows) + "x"
+        + std::to_string(image.channels()) + " " + std::to_string(threads) + " "
+        + TileScheduler::GetBackendName(TileScheduler::GetBackend()) + " " + kernels;
+}
+
+bool TuningCache::Find(const std::string& key, TileSchedule& schedule) const
+{
+    auto entry = schedules.find(key);
+    if (entry == schedules.end()) return false;
+    schedule = entry->second;
+    return true;
+}
+
+void TuningCache::Set(const std::string& key, const TileSchedule& schedule)
+{
+    schedules[key] = schedule;
+
+    std::ofstream file(path);
+    if (!file)
+        throw std::invalid_argument("Could not save the tuning cache " + path + "!");
+    file << "# filters size threads backend kernels policy tileRows tileCols" << std::endl;
+    for (const auto& entry : schedules) {
+        file << entry.first << " " << TileScheduler::GetPolicyName(entry.second.policy) << " "
+            << entry.second.tileRows << " " << entry.second.tileCols << std::endl;
+    }
+}
+
+std::vector<TileSchedule> ScheduleTuner::GetCandidates(int rows, int cols)
+{
+    std::vector<TileSchedule> candidates;
+    for (SchedulePolicy policy : { SchedulePolicy::Static, SchedulePolicy::Dynamic, SchedulePolicy::Guided, SchedulePolicy::WorkStealing }) {
+        for (int tileRows : { 0, 1, 4, 16, 64 }) {
+            if (tileRows > rows) continue;
+            // columns are only divided into tiles that still fill a few cache lines per row
+            for (int tileCols : { 0, 256, 1024 }) {
+                if (tileCols >= cols) continue;
+                candidates.push_back({ policy, tileRows, tileCols });
+            }
+        }
+    }
+    return candidates;
+}
+
+TileSchedule ScheduleTuner::Tune(const std::vector<FilterMethod>& filterMethods, const cv::Mat& image, bool useOpenMP,
+    int repetitions)
+{
+    const TileSchedule activeSchedule = TileScheduler::GetSchedule();
+    TileSchedule bestSchedule = activeSchedule;
+    double bestDuration = -1;
+    cv::Mat copy;
+
+    for (const TileSchedule& candidate : GetCandidates(image.rows, image.cols)) {
+        TileScheduler::SetSchedule(candidate);
+        double duration = -1;
+        for (int i = 0; i < repetitions; i++) {
+            image.copyTo(copy);
+            auto begin = std::chrono::high_resolution_clock::now();
+            for (const auto& filter : filterMethods) {
+                filter(copy, useOpenMP);
+            }
+            double repetitionDuration = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count();
+            if (duration < 0 || repetitionDuration < duration) duration = repetitionDuration;
+        }
+
+        if (bestDuration < 0 || duration < bestDuration) {
+            bestDuration = duration;
+            bestSchedule = candidate;
+        }
+    }
+
+    TileScheduler::SetSchedule(activeSchedule);
+    return bestSchedule;
+}
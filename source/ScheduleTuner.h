@@ -0,0 +1,82 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "TileScheduler.h"
+
+/// <summary>
+/// Schedules that were tuned in earlier runs, saved in a text file with one schedule per line. The schedules are
+/// keyed by the filters, the size and channels of the image, the number of threads, the active backend and the
+/// active kernels, since the best schedule changes with all of them.
+/// </summary>
+class TuningCache
+{
+public:
+    /// <summary>
+    /// Creates a cache backed by a file, which is read if it exists.
+    /// Throws an invalid_argument exception if the file contains invalid lines.
+    /// </summary>
+    /// <param name="path">The file path of the cache</param>
+    explicit TuningCache(const std::string& path);
+
+    /// <summary>
+    /// Returns the key of a schedule for the active backend and kernels, e.g. "HSV+Grayscale+Emboss 1920x1080x3 8 openmp AVX2".
+    /// </summary>
+    /// <param name="filterName">The name of the filters, see FilterPipeline::GetFilterName</param>
+    /// <param name="image">The image that is filtered</param>
+    /// <param name="threads">The number of threads</param>
+    /// <returns></returns>
+    static std::string GetKey(const std::string& filterName, const cv::Mat& image, int threads);
+
+    /// <summary>
+    /// Looks up the schedule of a key.
+    /// </summary>
+    /// <param name="key"></param>
+    /// <param name="schedule">Receives the schedule if the key was found</param>
+    /// <returns>Wether the key was found</returns>
+    bool Find(const std::string& key, TileSchedule& schedule) const;
+
+    /// <summary>
+    /// Sets the schedule of a key and saves the cache to its file.
+    /// </summary>
+    /// <param name="key"></param>
+    /// <param name="schedule"></param>
+    void Set(const std::string& key, const TileSchedule& schedule);
+
+private:
+    std::string path;
+    std::map<std::string, TileSchedule> schedules;
+};
+
+/// <summary>
+/// Finds the fastest schedule of filters on an image by benchmarking a set of candidate tile shapes and policies.
+/// </summary>
+class ScheduleTuner
+{
+public:
+    typedef std::function<void(cv::Mat&, bool)> FilterMethod;
+
+    /// <summary>
+    /// Returns the candidate schedules for an image: every policy with the default tiles, tiles of a few rows and,
+    /// for wide images, tiles of a part of the columns.
+    /// </summary>
+    /// <param name="rows">The rows of the image</param>
+    /// <param name="cols">The columns of the image</param>
+    /// <returns></returns>
+    static std::vector<TileSchedule> GetCandidates(int rows, int cols);
+
+    /// <summary>
+    /// Filters a copy of the image with every candidate and returns the schedule with the shortest duration.
+    /// The active schedule is restored afterwards.
+    /// </summary>
+    /// <param name="filterMethods">The image filter methods in the order they should be run</param>
+    /// <param name="image">The image the schedule is tuned for</param>
+    /// <param name="useOpenMP">Wether the filters use OpenMP or not</param>
+    /// <param name="repetitions">The repetitions of every candidate, of which the shortest counts</param>
+    /// <returns></returns>
+    static TileSchedule Tune(const std::vector<FilterMethod>& filterMethods, const cv::Mat& image, bool useOpenMP,
+        int repetitions = 3);
+};
@@ -0,0 +1,265 @@
+#include "SimdKernels.h"
+#include "LookupTables.h"
+
+#ifdef SIMD_KERNELS_X86
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#ifdef SIMD_KERNELS_X86
+static void Cpuid(unsigned int info[4], unsigned int leaf, unsigned int subleaf)
+{
+#if defined(_MSC_VER)
+    __cpuidex(reinterpret_cast<int*>(info), leaf, subleaf);
+#else
+    __cpuid_count(leaf, subleaf, info[0], info[1], info[2], info[3]);
+#endif
+}
+
+static unsigned long long Xgetbv(unsigned int index)
+{
+#if defined(_MSC_VER)
+    return _xgetbv(index);
+#else
+    unsigned int eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(index));
+    return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+}
+#endif
+
+void SimdKernels::GrayscalePixels(const uchar* src, uchar* dst, int count)
+{
+    for (int i = 0; i < count; i++, src += 3, dst += 3) {
+        uchar gray = static_cast<uchar>(0.21 * src[2] + 0.72 * src[1] + 0.07 * src[0]);
+        dst[0] = dst[1] = dst[2] = gray;
+    }
+}
+
+void SimdKernels::HSVPixels(const uchar* src, uchar* dst, int count)
+{
+    for (int i = 0; i < count; i++, src += 3, dst += 3) {
+        float r = src[2] / 255.0f;
+        float g = src[1] / 255.0f;
+        float b = src[0] / 255.0f;
+
+        float cmax = fmax(fmax(r, g), b);
+        float cmin = fmin(fmin(r, g), b);
+        float delta = cmax - cmin;
+
+        float hue = 0.0;
+        if (delta != 0.0) {
+            if (cmax == r)
+                hue = 60 * fmod((g - b) / delta, 6.0f);
+            else if (cmax == g)
+                hue = 60 * (((b - r) / delta) + 2.0f);
+            else if (cmax == b)
+                hue = 60 * (((r - g) / delta) + 4.0f);
+        }
+        if (hue < 0) hue += 360;
+        float saturation = (cmax == 0.0f) ? 0 : (delta / cmax);
+        float value = cmax;
+
+        // the hue is converted through int like the compilers do for static_cast<uchar>, keeping the lowest byte
+        // for hues above 255 that the vectorized kernels reproduce
+        dst[0] = static_cast<uchar>(static_cast<int>(hue));
+        dst[1] = static_cast<uchar>(saturation * 255);
+        dst[2] = static_cast<uchar>(value * 255);
+    }
+}
+
+void SimdKernels::EmbossPixels(const uchar* compare, const uchar* src, uchar* dst, int count)
+{
+    for (int i = 0; i < count; i++, compare += 3, src += 3, dst += 3) {
+        int diffR = abs(compare[2] - src[2]);
+        int diffG = abs(compare[1] - src[1]);
+        int diffB = abs(compare[0] - src[0]);
+        int diff = std::max(std::max(diffR, diffG), diffB);
+        uchar gray = static_cast<uchar>(std::min(diff + 128, 255));
+        dst[0] = dst[1] = dst[2] = gray;
+    }
+}
+
+void SimdKernels::GrayscalePlanePixels(const uchar* src, uchar* dst, int count)
+{
+    for (int i = 0; i < count; i++, src += 3) {
+        dst[i] = static_cast<uchar>(0.21 * src[2] + 0.72 * src[1] + 0.07 * src[0]);
+    }
+}
+
+void SimdKernels::ExpandPlanePixels(const uchar* src, uchar* dst, int count)
+{
+    for (int i = 0; i < count; i++, dst += 3) {
+        dst[0] = dst[1] = dst[2] = src[i];
+    }
+}
+
+void SimdKernels::EmbossPlanePixels(const uchar* compare, const uchar* src, uchar* dst, int count)
+{
+    for (int i = 0; i < count; i++) {
+        dst[i] = static_cast<uchar>(std::min(abs(compare[i] - src[i]) + 128, 255));
+    }
+}
+
+static void ScalarGrayscaleRow(const uchar* src, uchar* dst, int cols)
+{
+    SimdKernels::GrayscalePixels(src, dst, cols);
+}
+
+static void ScalarHSVRow(const uchar* src, uchar* dst, int cols)
+{
+    SimdKernels::HSVPixels(src, dst, cols);
+}
+
+static void ScalarEmbossRow(const uchar* previousRow, const uchar* row, uchar* dst, int cols)
+{
+    if (previousRow == nullptr) {
+        // initialize pixels without top-left neighbor as gray
+        memset(dst, 128, static_cast<size_t>(cols) * 3);
+        return;
+    }
+
+    // initialize the first pixel without top-left neighbor as gray
+    SimdKernels::EmbossPixels(previousRow, row + 3, dst + 3, cols - 1);
+    dst[0] = dst[1] = dst[2] = 128;
+}
+
+static void ScalarGrayscalePlaneRow(const uchar* src, uchar* dst, int cols)
+{
+    SimdKernels::GrayscalePlanePixels(src, dst, cols);
+}
+
+static void ScalarExpandPlaneRow(const uchar* src, uchar* dst, int cols)
+{
+    SimdKernels::ExpandPlanePixels(src, dst, cols);
+}
+
+static void ScalarEmbossPlaneRow(const uchar* previousRow, const uchar* row, uchar* dst, int cols)
+{
+    if (previousRow == nullptr) {
+        // initialize pixels without top-left neighbor as gray
+        memset(dst, 128, static_cast<size_t>(cols));
+        return;
+    }
+
+    // initialize the first pixel without top-left neighbor as gray
+    SimdKernels::EmbossPlanePixels(previousRow, row + 1, dst + 1, cols - 1);
+    dst[0] = 128;
+}
+
+static const SimdKernelTable scalarKernelTable = {
+    SimdLevel::Scalar, "Scalar", &ScalarGrayscaleRow, &ScalarHSVRow, &ScalarEmbossRow,
+    &ScalarGrayscalePlaneRow, &ScalarExpandPlaneRow, &ScalarEmbossPlaneRow
+};
+
+SimdLevel SimdKernels::DetectSimdLevel()
+{
+#ifdef SIMD_KERNELS_X86
+    unsigned int info[4];
+    Cpuid(info, 0, 0);
+    unsigned int maxLeaf = info[0];
+
+    Cpuid(info, 1, 0);
+    bool sse41 = (info[2] & (1u << 19)) != 0;
+    bool osxsave = (info[2] & (1u << 27)) != 0;
+    bool avx = (info[2] & (1u << 28)) != 0;
+    if (!sse41) return SimdLevel::Scalar;
+    if (!osxsave || !avx || maxLeaf < 7) return SimdLevel::SSE41;
+
+    // the operating system has to save the ymm (and zmm) registers on context switches
+    unsigned long long xcr0 = Xgetbv(0);
+    if ((xcr0 & 0x6) != 0x6) return SimdLevel::SSE41;
+
+    Cpuid(info, 7, 0);
+    bool avx2 = (info[1] & (1u << 5)) != 0;
+    bool avx512f = (info[1] & (1u << 16)) != 0;
+    bool avx512bw = (info[1] & (1u << 30)) != 0;
+    if (!avx2) return SimdLevel::SSE41;
+    if (!avx512f || !avx512bw || (xcr0 & 0xE0) != 0xE0) return SimdLevel::AVX2;
+    return SimdLevel::AVX512;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+const SimdKernelTable& SimdKernels::GetKernels(SimdLevel level)
+{
+    switch (level) {
+#ifdef SIMD_KERNELS_X86
+    case SimdLevel::AVX512:
+        return GetAVX512KernelTable();
+    case SimdLevel::AVX2:
+        return GetAVX2KernelTable();
+    case SimdLevel::SSE41:
+        return GetSSE41KernelTable();
+#endif
+    default:
+        return scalarKernelTable;
+    }
+}
+
+static const SimdKernelTable*& LevelKernelTable()
+{
+    static const SimdKernelTable* levelTable = &SimdKernels::GetKernels(SimdKernels::DetectSimdLevel());
+    return levelTable;
+}
+
+static bool& UseLookupTables()
+{
+    static bool useLookupTables = false;
+    return useLookupTables;
+}
+
+static const SimdKernelTable*& ActiveKernelTable()
+{
+    static const SimdKernelTable* activeTable = LevelKernelTable();
+    return activeTable;
+}
+
+/// <summary>
+/// Activates the kernels of an instruction set level, whose pointwise kernels are replaced by the lookup tables if
+/// they are used. The embossing and expanding kernels do not compute anything to look up and are always taken from
+/// the level.
+/// </summary>
+static void ActivateKernels(const SimdKernelTable& levelTable)
+{
+    static SimdKernelTable lookupTable;
+    LevelKernelTable() = &levelTable;
+    if (!UseLookupTables()) {
+        ActiveKernelTable() = &levelTable;
+        return;
+    }
+
+    lookupTable = levelTable;
+    lookupTable.name = "Lookup tables";
+    lookupTable.grayscaleRow = &LookupTables::GrayscaleRow;
+    lookupTable.hsvRow = &LookupTables::HSVRow;
+    lookupTable.grayscalePlaneRow = &LookupTables::GrayscalePlaneRow;
+    ActiveKernelTable() = &lookupTable;
+}
+
+const SimdKernelTable& SimdKernels::GetKernels()
+{
+    return *ActiveKernelTable();
+}
+
+void SimdKernels::SetSimdLevel(SimdLevel level)
+{
+    SimdLevel supported = DetectSimdLevel();
+    if (level > supported) level = supported;
+    ActivateKernels(GetKernels(level));
+}
+
+void SimdKernels::SetLookupTables(bool useLookupTables)
+{
+    UseLookupTables() = useLookupTables;
+    ActivateKernels(*LevelKernelTable());
+}
+
+bool SimdKernels::IsUsingLookupTables()
+{
+    return UseLookupTables();
+}
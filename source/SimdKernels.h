@@ -0,0 +1,133 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SIMD_KERNELS_X86
+#endif
+
+/// <summary>
+/// Instruction set levels for which vectorized filter kernels are available, ordered from slowest to fastest.
+/// </summary>
+enum class SimdLevel
+{
+    Scalar = 0,
+    SSE41 = 1,
+    AVX2 = 2,
+    AVX512 = 3,
+};
+
+/// <summary>
+/// Kernel applying a pointwise filter to a row of interleaved BGR pixels or single-channel pixels. src and dst may
+/// point to the same row, except for kernels that write more bytes per pixel than they read.
+/// </summary>
+typedef void (*PointRowKernel)(const uchar* src, uchar* dst, int cols);
+
+/// <summary>
+/// Kernel applying the embossing filter to a row of interleaved BGR pixels or single-channel pixels, comparing each pixel to the top-left pixel
+/// in the previous row. previousRow is nullptr for the first row of the image. row and dst may point to the same row,
+/// previousRow has to contain the unfiltered pixels.
+/// </summary>
+typedef void (*StencilRowKernel)(const uchar* previousRow, const uchar* row, uchar* dst, int cols);
+
+/// <summary>
+/// Set of row kernels compiled for one instruction set level. The plane kernels work on single-channel rows:
+/// grayscalePlaneRow writes one gray byte per BGR pixel, expandPlaneRow turns a single-channel row back into BGR
+/// pixels with three identical channels and embossPlaneRow embosses a single-channel row.
+/// </summary>
+struct SimdKernelTable
+{
+    SimdLevel level;
+    const char* name;
+    PointRowKernel grayscaleRow;
+    PointRowKernel hsvRow;
+    StencilRowKernel embossRow;
+    PointRowKernel grayscalePlaneRow;
+    PointRowKernel expandPlaneRow;
+    StencilRowKernel embossPlaneRow;
+};
+
+class SimdKernels
+{
+public:
+    /// <summary>
+    /// Returns the highest instruction set level supported by the CPU and operating system, using CPUID.
+    /// </summary>
+    /// <returns></returns>
+    static SimdLevel DetectSimdLevel();
+
+    /// <summary>
+    /// Returns the kernels of the currently active instruction set level. On first use the best level supported
+    /// by the CPU is selected.
+    /// </summary>
+    /// <returns></returns>
+    static const SimdKernelTable& GetKernels();
+
+    /// <summary>
+    /// Returns the kernels compiled for the given instruction set level, without checking whether the CPU supports them.
+    /// </summary>
+    /// <param name="level"></param>
+    /// <returns></returns>
+    static const SimdKernelTable& GetKernels(SimdLevel level);
+
+    /// <summary>
+    /// Changes the active instruction set level, e.g. to benchmark the variants against each other.
+    /// Levels above the one supported by the CPU are lowered to the supported level.
+    /// </summary>
+    /// <param name="level"></param>
+    static void SetSimdLevel(SimdLevel level);
+
+    /// <summary>
+    /// Changes wether the grayscale and hsv kernels are replaced by lookup tables, which are built on first use.
+    /// Has to be called before filtering, while no other thread uses the kernels.
+    /// </summary>
+    /// <param name="useLookupTables"></param>
+    static void SetLookupTables(bool useLookupTables);
+
+    /// <summary>
+    /// Returns wether the grayscale and hsv kernels are replaced by lookup tables.
+    /// </summary>
+    /// <returns></returns>
+    static bool IsUsingLookupTables();
+
+    /// <summary>
+    /// Applies the grayscale filter to count interleaved BGR pixels without vectorization.
+    /// Used for the scalar kernels and for the remaining pixels of a row in the vectorized kernels.
+    /// </summary>
+    static void GrayscalePixels(const uchar* src, uchar* dst, int count);
+
+    /// <summary>
+    /// Applies the hsv filter to count interleaved BGR pixels without vectorization.
+    /// Used for the scalar kernels and for the remaining pixels of a row in the vectorized kernels.
+    /// </summary>
+    static void HSVPixels(const uchar* src, uchar* dst, int count);
+
+    /// <summary>
+    /// Applies the embossing filter to count interleaved BGR pixels without vectorization, comparing src[i] with compare[i].
+    /// Used for the scalar kernels and for the remaining pixels of a row in the vectorized kernels.
+    /// </summary>
+    static void EmbossPixels(const uchar* compare, const uchar* src, uchar* dst, int count);
+
+    /// <summary>
+    /// Applies the grayscale filter to count interleaved BGR pixels, writing one gray byte per pixel.
+    /// </summary>
+    static void GrayscalePlanePixels(const uchar* src, uchar* dst, int count);
+
+    /// <summary>
+    /// Copies count single-channel pixels into interleaved BGR pixels with three identical channels.
+    /// </summary>
+    static void ExpandPlanePixels(const uchar* src, uchar* dst, int count);
+
+    /// <summary>
+    /// Applies the embossing filter to count single-channel pixels, comparing src[i] with compare[i]. The result is
+    /// identical to embossing BGR pixels whose channels all hold the single-channel value.
+    /// </summary>
+    static void EmbossPlanePixels(const uchar* compare, const uchar* src, uchar* dst, int count);
+};
+
+#ifdef SIMD_KERNELS_X86
+// kernel tables defined in the instruction set specific translation units, which are compiled with the matching flags
+const SimdKernelTable& GetSSE41KernelTable();
+const SimdKernelTable& GetAVX2KernelTable();
+const SimdKernelTable& GetAVX512KernelTable();
+#endif
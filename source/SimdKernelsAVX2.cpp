@@ -0,0 +1,85 @@
+#include "SimdKernels.h"
+
+#ifdef SIMD_KERNELS_X86
+#include <immintrin.h>
+#include "SimdKernelsImpl.h"
+
+namespace {
+
+struct AVX2Traits
+{
+    typedef __m256i Bytes;
+    typedef __m256 Floats;
+    typedef __m256 Mask;
+    typedef __m256d Doubles;
+
+    // two lanes of 16 pixels, the second lane starting 48 bytes after the first
+    static const int Pixels = 32;
+
+    static void LoadPixels(const uchar* src, Bytes chunks[3])
+    {
+        for (int k = 0; k < 3; k++) {
+            __m128i low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16 * k));
+            __m128i high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 48 + 16 * k));
+            chunks[k] = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+        }
+    }
+
+    static void StorePixels(uchar* dst, const Bytes chunks[3])
+    {
+        for (int k = 0; k < 3; k++) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16 * k), _mm256_castsi256_si128(chunks[k]));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 48 + 16 * k), _mm256_extracti128_si256(chunks[k], 1));
+        }
+    }
+
+    // a plane holds one byte per pixel, the lanes are in pixel order
+    static Bytes LoadPlane(const uchar* src) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src)); }
+    static void StorePlane(uchar* dst, Bytes plane) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), plane); }
+
+    static Bytes LanePattern(const signed char* pattern) { return _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(pattern))); }
+    static Bytes Shuffle(Bytes v, Bytes pattern) { return _mm256_shuffle_epi8(v, pattern); }
+    static Bytes Or(Bytes a, Bytes b) { return _mm256_or_si256(a, b); }
+    static Bytes AndInt(Bytes a, Bytes b) { return _mm256_and_si256(a, b); }
+    static Bytes Zero() { return _mm256_setzero_si256(); }
+    static Bytes Set1U8(int v) { return _mm256_set1_epi8(static_cast<char>(v)); }
+    static Bytes Set1Int(int v) { return _mm256_set1_epi32(v); }
+    static Bytes SubsU8(Bytes a, Bytes b) { return _mm256_subs_epu8(a, b); }
+    static Bytes AddsU8(Bytes a, Bytes b) { return _mm256_adds_epu8(a, b); }
+    static Bytes MaxU8(Bytes a, Bytes b) { return _mm256_max_epu8(a, b); }
+    static Bytes UnpackLo8(Bytes a, Bytes b) { return _mm256_unpacklo_epi8(a, b); }
+    static Bytes UnpackHi8(Bytes a, Bytes b) { return _mm256_unpackhi_epi8(a, b); }
+    static Bytes UnpackLo16(Bytes a, Bytes b) { return _mm256_unpacklo_epi16(a, b); }
+    static Bytes UnpackHi16(Bytes a, Bytes b) { return _mm256_unpackhi_epi16(a, b); }
+    static Bytes PackUS32(Bytes a, Bytes b) { return _mm256_packus_epi32(a, b); }
+    static Bytes PackUS16(Bytes a, Bytes b) { return _mm256_packus_epi16(a, b); }
+
+    static Floats ToFloats(Bytes ints) { return _mm256_cvtepi32_ps(ints); }
+    static Bytes ToInt32(Floats v) { return _mm256_cvttps_epi32(v); }
+    static Floats Set1F(float v) { return _mm256_set1_ps(v); }
+    static Floats AddF(Floats a, Floats b) { return _mm256_add_ps(a, b); }
+    static Floats SubF(Floats a, Floats b) { return _mm256_sub_ps(a, b); }
+    static Floats MulF(Floats a, Floats b) { return _mm256_mul_ps(a, b); }
+    static Floats DivF(Floats a, Floats b) { return _mm256_div_ps(a, b); }
+    static Floats MaxF(Floats a, Floats b) { return _mm256_max_ps(a, b); }
+    static Floats MinF(Floats a, Floats b) { return _mm256_min_ps(a, b); }
+    static Mask CmpEq(Floats a, Floats b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+    static Mask CmpNeq(Floats a, Floats b) { return _mm256_cmp_ps(a, b, _CMP_NEQ_UQ); }
+    static Mask CmpLt(Floats a, Floats b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+    static Floats Select(Mask mask, Floats a, Floats b) { return _mm256_blendv_ps(b, a, mask); }
+
+    static Doubles ToDoublesLo(Bytes ints) { return _mm256_cvtepi32_pd(_mm256_castsi256_si128(ints)); }
+    static Doubles ToDoublesHi(Bytes ints) { return _mm256_cvtepi32_pd(_mm256_extracti128_si256(ints, 1)); }
+    static Bytes FromDoubles(Doubles low, Doubles high) { return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm256_cvttpd_epi32(low)), _mm256_cvttpd_epi32(high), 1); }
+    static Doubles Set1D(double v) { return _mm256_set1_pd(v); }
+    static Doubles AddD(Doubles a, Doubles b) { return _mm256_add_pd(a, b); }
+    static Doubles MulD(Doubles a, Doubles b) { return _mm256_mul_pd(a, b); }
+};
+
+}
+
+const SimdKernelTable& GetAVX2KernelTable()
+{
+    return MakeKernelTable<AVX2Traits>(SimdLevel::AVX2, "AVX2");
+}
+#endif
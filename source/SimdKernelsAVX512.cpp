@@ -0,0 +1,93 @@
+#include "SimdKernels.h"
+
+#ifdef SIMD_KERNELS_X86
+#include <immintrin.h>
+#include "SimdKernelsImpl.h"
+
+namespace {
+
+struct AVX512Traits
+{
+    typedef __m512i Bytes;
+    typedef __m512 Floats;
+    typedef __mmask16 Mask;
+    typedef __m512d Doubles;
+
+    // four lanes of 16 pixels, each lane starting 48 bytes after the previous one
+    static const int Pixels = 64;
+
+    // AVX-512 implies FMA, so additions and multiplications use explicit rounding, which keeps compilers from
+    // contracting them to fused multiply-adds with different rounding than the scalar kernels
+    static const int Rounding = _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC;
+
+    static void LoadPixels(const uchar* src, Bytes chunks[3])
+    {
+        for (int k = 0; k < 3; k++) {
+            __m512i v = _mm512_castsi128_si512(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16 * k)));
+            v = _mm512_inserti32x4(v, _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 48 + 16 * k)), 1);
+            v = _mm512_inserti32x4(v, _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 96 + 16 * k)), 2);
+            v = _mm512_inserti32x4(v, _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 144 + 16 * k)), 3);
+            chunks[k] = v;
+        }
+    }
+
+    static void StorePixels(uchar* dst, const Bytes chunks[3])
+    {
+        for (int k = 0; k < 3; k++) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16 * k), _mm512_castsi512_si128(chunks[k]));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 48 + 16 * k), _mm512_extracti32x4_epi32(chunks[k], 1));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 96 + 16 * k), _mm512_extracti32x4_epi32(chunks[k], 2));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 144 + 16 * k), _mm512_extracti32x4_epi32(chunks[k], 3));
+        }
+    }
+
+    // a plane holds one byte per pixel, the lanes are in pixel order
+    static Bytes LoadPlane(const uchar* src) { return _mm512_loadu_si512(src); }
+    static void StorePlane(uchar* dst, Bytes plane) { _mm512_storeu_si512(dst, plane); }
+
+    static Bytes LanePattern(const signed char* pattern) { return _mm512_broadcast_i32x4(_mm_load_si128(reinterpret_cast<const __m128i*>(pattern))); }
+    static Bytes Shuffle(Bytes v, Bytes pattern) { return _mm512_shuffle_epi8(v, pattern); }
+    static Bytes Or(Bytes a, Bytes b) { return _mm512_or_si512(a, b); }
+    static Bytes AndInt(Bytes a, Bytes b) { return _mm512_and_si512(a, b); }
+    static Bytes Zero() { return _mm512_setzero_si512(); }
+    static Bytes Set1U8(int v) { return _mm512_set1_epi8(static_cast<char>(v)); }
+    static Bytes Set1Int(int v) { return _mm512_set1_epi32(v); }
+    static Bytes SubsU8(Bytes a, Bytes b) { return _mm512_subs_epu8(a, b); }
+    static Bytes AddsU8(Bytes a, Bytes b) { return _mm512_adds_epu8(a, b); }
+    static Bytes MaxU8(Bytes a, Bytes b) { return _mm512_max_epu8(a, b); }
+    static Bytes UnpackLo8(Bytes a, Bytes b) { return _mm512_unpacklo_epi8(a, b); }
+    static Bytes UnpackHi8(Bytes a, Bytes b) { return _mm512_unpackhi_epi8(a, b); }
+    static Bytes UnpackLo16(Bytes a, Bytes b) { return _mm512_unpacklo_epi16(a, b); }
+    static Bytes UnpackHi16(Bytes a, Bytes b) { return _mm512_unpackhi_epi16(a, b); }
+    static Bytes PackUS32(Bytes a, Bytes b) { return _mm512_packus_epi32(a, b); }
+    static Bytes PackUS16(Bytes a, Bytes b) { return _mm512_packus_epi16(a, b); }
+
+    static Floats ToFloats(Bytes ints) { return _mm512_cvtepi32_ps(ints); }
+    static Bytes ToInt32(Floats v) { return _mm512_cvttps_epi32(v); }
+    static Floats Set1F(float v) { return _mm512_set1_ps(v); }
+    static Floats AddF(Floats a, Floats b) { return _mm512_add_round_ps(a, b, Rounding); }
+    static Floats SubF(Floats a, Floats b) { return _mm512_sub_round_ps(a, b, Rounding); }
+    static Floats MulF(Floats a, Floats b) { return _mm512_mul_round_ps(a, b, Rounding); }
+    static Floats DivF(Floats a, Floats b) { return _mm512_div_ps(a, b); }
+    static Floats MaxF(Floats a, Floats b) { return _mm512_max_ps(a, b); }
+    static Floats MinF(Floats a, Floats b) { return _mm512_min_ps(a, b); }
+    static Mask CmpEq(Floats a, Floats b) { return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ); }
+    static Mask CmpNeq(Floats a, Floats b) { return _mm512_cmp_ps_mask(a, b, _CMP_NEQ_UQ); }
+    static Mask CmpLt(Floats a, Floats b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+    static Floats Select(Mask mask, Floats a, Floats b) { return _mm512_mask_blend_ps(mask, b, a); }
+
+    static Doubles ToDoublesLo(Bytes ints) { return _mm512_cvtepi32_pd(_mm512_castsi512_si256(ints)); }
+    static Doubles ToDoublesHi(Bytes ints) { return _mm512_cvtepi32_pd(_mm512_extracti64x4_epi64(ints, 1)); }
+    static Bytes FromDoubles(Doubles low, Doubles high) { return _mm512_inserti64x4(_mm512_castsi256_si512(_mm512_cvttpd_epi32(low)), _mm512_cvttpd_epi32(high), 1); }
+    static Doubles Set1D(double v) { return _mm512_set1_pd(v); }
+    static Doubles AddD(Doubles a, Doubles b) { return _mm512_add_round_pd(a, b, Rounding); }
+    static Doubles MulD(Doubles a, Doubles b) { return _mm512_mul_round_pd(a, b, Rounding); }
+};
+
+}
+
+const SimdKernelTable& GetAVX512KernelTable()
+{
+    return MakeKernelTable<AVX512Traits>(SimdLevel::AVX512, "AVX-512");
+}
+#endif
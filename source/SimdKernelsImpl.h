@@ -0,0 +1,308 @@
+#pragma once
+
+#include "SimdKernels.h"
+
+// Vectorized filter kernels written against a traits type that wraps the intrinsics of one instruction set.
+// This header is only included by the instruction set specific translation units, which are compiled with the
+// matching compiler flags. Everything is kept in an anonymous namespace, so that the differently compiled
+// instantiations are never merged by the linker.
+//
+// The traits work on vectors of one or more independent 128-bit lanes. Each lane holds 16 pixels, which are
+// loaded from 48 consecutive bytes as three chunks and split into one plane per channel, so that the same
+// shuffles can be used for all instruction sets. Channel values are widened to 32-bit integers and back with
+// unpack and pack, which restore the pixel order within each lane.
+//
+// All calculations follow the scalar kernels operation for operation, producing identical results. This requires
+// the translation units to be compiled without contracting multiplications and additions to fused multiply-adds
+// (the default of MSVC, -ffp-contract=off for GCC and Clang).
+
+namespace {
+
+alignas(16) const signed char deinterleavePatterns[3][3][16] = {
+    {
+        {  0,  3,  6,  9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+        { -1, -1, -1, -1, -1, -1,  2,  5,  8, 11, 14, -1, -1, -1, -1, -1 },
+        { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  1,  4,  7, 10, 13 },
+    },
+    {
+        {  1,  4,  7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+        { -1, -1, -1, -1, -1,  0,  3,  6,  9, 12, 15, -1, -1, -1, -1, -1 },
+        { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  2,  5,  8, 11, 14 },
+    },
+    {
+        {  2,  5,  8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+        { -1, -1, -1, -1, -1,  1,  4,  7, 10, 13, -1, -1, -1, -1, -1, -1 },
+        { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0,  3,  6,  9, 12, 15 },
+    },
+};
+
+alignas(16) const signed char interleavePatterns[3][3][16] = {
+    {
+        {  0, -1, -1,  1, -1, -1,  2, -1, -1,  3, -1, -1,  4, -1, -1,  5 },
+        { -1, -1,  6, -1, -1,  7, -1, -1,  8, -1, -1,  9, -1, -1, 10, -1 },
+        { -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1 },
+    },
+    {
+        { -1,  0, -1, -1,  1, -1, -1,  2, -1, -1,  3, -1, -1,  4, -1, -1 },
+        {  5, -1, -1,  6, -1, -1,  7, -1, -1,  8, -1, -1,  9, -1, -1, 10 },
+        { -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1 },
+    },
+    {
+        { -1, -1,  0, -1, -1,  1, -1, -1,  2, -1, -1,  3, -1, -1,  4, -1 },
+        { -1,  5, -1, -1,  6, -1, -1,  7, -1, -1,  8, -1, -1,  9, -1, -1 },
+        { 10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15 },
+    },
+};
+
+alignas(16) const signed char broadcastPatterns[3][16] = {
+    {  0,  0,  0,  1,  1,  1,  2,  2,  2,  3,  3,  3,  4,  4,  4,  5 },
+    {  5,  5,  6,  6,  6,  7,  7,  7,  8,  8,  8,  9,  9,  9, 10, 10 },
+    { 10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 14, 14, 14, 15, 15, 15 },
+};
+
+template<typename T>
+inline void Deinterleave(const typename T::Bytes chunks[3], typename T::Bytes planes[3])
+{
+    for (int c = 0; c < 3; c++) {
+        planes[c] = T::Or(T::Or(
+            T::Shuffle(chunks[0], T::LanePattern(deinterleavePatterns[c][0])),
+            T::Shuffle(chunks[1], T::LanePattern(deinterleavePatterns[c][1]))),
+            T::Shuffle(chunks[2], T::LanePattern(deinterleavePatterns[c][2])));
+    }
+}
+
+template<typename T>
+inline void Interleave(const typename T::Bytes planes[3], typename T::Bytes chunks[3])
+{
+    for (int k = 0; k < 3; k++) {
+        chunks[k] = T::Or(T::Or(
+            T::Shuffle(planes[0], T::LanePattern(interleavePatterns[0][k])),
+            T::Shuffle(planes[1], T::LanePattern(interleavePatterns[1][k]))),
+            T::Shuffle(planes[2], T::LanePattern(interleavePatterns[2][k])));
+    }
+}
+
+template<typename T>
+inline void Broadcast(typename T::Bytes plane, typename T::Bytes chunks[3])
+{
+    for (int k = 0; k < 3; k++) {
+        chunks[k] = T::Shuffle(plane, T::LanePattern(broadcastPatterns[k]));
+    }
+}
+
+// widens a plane of 8-bit values to four vectors of 32-bit integers
+template<typename T>
+inline void Widen(typename T::Bytes plane, typename T::Bytes ints[4])
+{
+    typename T::Bytes zero = T::Zero();
+    typename T::Bytes low = T::UnpackLo8(plane, zero);
+    typename T::Bytes high = T::UnpackHi8(plane, zero);
+    ints[0] = T::UnpackLo16(low, zero);
+    ints[1] = T::UnpackHi16(low, zero);
+    ints[2] = T::UnpackLo16(high, zero);
+    ints[3] = T::UnpackHi16(high, zero);
+}
+
+// narrows four vectors of 32-bit integers in the range 0 to 255 back to a plane of 8-bit values
+template<typename T>
+inline typename T::Bytes Narrow(const typename T::Bytes ints[4])
+{
+    return T::PackUS16(T::PackUS32(ints[0], ints[1]), T::PackUS32(ints[2], ints[3]));
+}
+
+// the gray values of the next T::Pixels interleaved BGR pixels as a plane
+template<typename T>
+inline typename T::Bytes GrayscalePlane(const uchar* src)
+{
+    const typename T::Doubles weightR = T::Set1D(0.21);
+    const typename T::Doubles weightG = T::Set1D(0.72);
+    const typename T::Doubles weightB = T::Set1D(0.07);
+
+    typename T::Bytes chunks[3], planes[3];
+    T::LoadPixels(src, chunks);
+    Deinterleave<T>(chunks, planes);
+
+    typename T::Bytes b[4], g[4], r[4], gray[4];
+    Widen<T>(planes[0], b);
+    Widen<T>(planes[1], g);
+    Widen<T>(planes[2], r);
+    for (int i = 0; i < 4; i++) {
+        // 0.21 * r + 0.72 * g + 0.07 * b in double precision, truncated like the scalar cast
+        typename T::Doubles low = T::AddD(T::AddD(
+            T::MulD(weightR, T::ToDoublesLo(r[i])),
+            T::MulD(weightG, T::ToDoublesLo(g[i]))),
+            T::MulD(weightB, T::ToDoublesLo(b[i])));
+        typename T::Doubles high = T::AddD(T::AddD(
+            T::MulD(weightR, T::ToDoublesHi(r[i])),
+            T::MulD(weightG, T::ToDoublesHi(g[i]))),
+            T::MulD(weightB, T::ToDoublesHi(b[i])));
+        gray[i] = T::FromDoubles(low, high);
+    }
+    return Narrow<T>(gray);
+}
+
+template<typename T>
+void GrayscaleRow(const uchar* src, uchar* dst, int cols)
+{
+    int y = 0;
+    for (; y + T::Pixels <= cols; y += T::Pixels) {
+        typename T::Bytes chunks[3];
+        Broadcast<T>(GrayscalePlane<T>(src + 3 * y), chunks);
+        T::StorePixels(dst + 3 * y, chunks);
+    }
+
+    SimdKernels::GrayscalePixels(src + 3 * y, dst + 3 * y, cols - y);
+}
+
+template<typename T>
+void GrayscalePlaneRow(const uchar* src, uchar* dst, int cols)
+{
+    // the plane is stored behind the pixels that are still to be loaded, so src and dst may be the same row
+    int y = 0;
+    for (; y + T::Pixels <= cols; y += T::Pixels) {
+        T::StorePlane(dst + y, GrayscalePlane<T>(src + 3 * y));
+    }
+
+    SimdKernels::GrayscalePlanePixels(src + 3 * y, dst + y, cols - y);
+}
+
+template<typename T>
+void ExpandPlaneRow(const uchar* src, uchar* dst, int cols)
+{
+    int y = 0;
+    for (; y + T::Pixels <= cols; y += T::Pixels) {
+        typename T::Bytes chunks[3];
+        Broadcast<T>(T::LoadPlane(src + y), chunks);
+        T::StorePixels(dst + 3 * y, chunks);
+    }
+
+    SimdKernels::ExpandPlanePixels(src + y, dst + 3 * y, cols - y);
+}
+
+template<typename T>
+void HSVRow(const uchar* src, uchar* dst, int cols)
+{
+    const typename T::Floats zero = T::Set1F(0.0f);
+    const typename T::Floats scale = T::Set1F(255.0f);
+    const typename T::Floats sixty = T::Set1F(60.0f);
+    const typename T::Floats two = T::Set1F(2.0f);
+    const typename T::Floats four = T::Set1F(4.0f);
+    const typename T::Floats fullCircle = T::Set1F(360.0f);
+    const typename T::Bytes lowByte = T::Set1Int(0xFF);
+
+    int y = 0;
+    for (; y + T::Pixels <= cols; y += T::Pixels) {
+        typename T::Bytes chunks[3], planes[3];
+        T::LoadPixels(src + 3 * y, chunks);
+        Deinterleave<T>(chunks, planes);
+
+        typename T::Bytes bInts[4], gInts[4], rInts[4], hueInts[4], saturationInts[4], valueInts[4];
+        Widen<T>(planes[0], bInts);
+        Widen<T>(planes[1], gInts);
+        Widen<T>(planes[2], rInts);
+        for (int i = 0; i < 4; i++) {
+            typename T::Floats r = T::DivF(T::ToFloats(rInts[i]), scale);
+            typename T::Floats g = T::DivF(T::ToFloats(gInts[i]), scale);
+            typename T::Floats b = T::DivF(T::ToFloats(bInts[i]), scale);
+
+            typename T::Floats cmax = T::MaxF(T::MaxF(r, g), b);
+            typename T::Floats cmin = T::MinF(T::MinF(r, g), b);
+            typename T::Floats delta = T::SubF(cmax, cmin);
+
+            // every case is calculated and the first matching one is selected, with (g - b) / delta always
+            // being within [-1, 1], so the fmod of the scalar kernel does not change the value
+            typename T::Floats hueR = T::MulF(sixty, T::DivF(T::SubF(g, b), delta));
+            typename T::Floats hueG = T::MulF(sixty, T::AddF(T::DivF(T::SubF(b, r), delta), two));
+            typename T::Floats hueB = T::MulF(sixty, T::AddF(T::DivF(T::SubF(r, g), delta), four));
+
+            typename T::Mask isB = T::CmpEq(cmax, b);
+            typename T::Mask isG = T::CmpEq(cmax, g);
+            typename T::Mask isR = T::CmpEq(cmax, r);
+            typename T::Floats hue = T::Select(isB, hueB, zero);
+            hue = T::Select(isG, hueG, hue);
+            hue = T::Select(isR, hueR, hue);
+            hue = T::Select(T::CmpNeq(delta, zero), hue, zero);
+            hue = T::Select(T::CmpLt(hue, zero), T::AddF(hue, fullCircle), hue);
+
+            typename T::Floats saturation = T::Select(T::CmpEq(cmax, zero), zero, T::DivF(delta, cmax));
+
+            // hues above 255 keep their lowest byte like the scalar cast
+            hueInts[i] = T::AndInt(T::ToInt32(hue), lowByte);
+            saturationInts[i] = T::ToInt32(T::MulF(saturation, scale));
+            valueInts[i] = T::ToInt32(T::MulF(cmax, scale));
+        }
+
+        planes[0] = Narrow<T>(hueInts);
+        planes[1] = Narrow<T>(saturationInts);
+        planes[2] = Narrow<T>(valueInts);
+        Interleave<T>(planes, chunks);
+        T::StorePixels(dst + 3 * y, chunks);
+    }
+
+    SimdKernels::HSVPixels(src + 3 * y, dst + 3 * y, cols - y);
+}
+
+template<typename T>
+void EmbossRow(const uchar* previousRow, const uchar* row, uchar* dst, int cols)
+{
+    if (previousRow == nullptr) {
+        // initialize pixels without top-left neighbor as gray
+        memset(dst, 128, static_cast<size_t>(cols) * 3);
+        return;
+    }
+
+    const typename T::Bytes offset = T::Set1U8(128);
+
+    // each pixel is compared with the top-left pixel, which is one pixel to the left in the previous row
+    int y = 1;
+    for (; y + T::Pixels <= cols; y += T::Pixels) {
+        typename T::Bytes chunks[3], compareChunks[3], planes[3];
+        T::LoadPixels(row + 3 * y, chunks);
+        T::LoadPixels(previousRow + 3 * (y - 1), compareChunks);
+        for (int k = 0; k < 3; k++) {
+            chunks[k] = T::Or(T::SubsU8(chunks[k], compareChunks[k]), T::SubsU8(compareChunks[k], chunks[k]));
+        }
+        Deinterleave<T>(chunks, planes);
+
+        // maximum difference of all channels, saturated to 255 after adding the offset
+        typename T::Bytes gray = T::AddsU8(T::MaxU8(T::MaxU8(planes[0], planes[1]), planes[2]), offset);
+        Broadcast<T>(gray, chunks);
+        T::StorePixels(dst + 3 * y, chunks);
+    }
+
+    SimdKernels::EmbossPixels(previousRow + 3 * (y - 1), row + 3 * y, dst + 3 * y, cols - y);
+    dst[0] = dst[1] = dst[2] = 128;
+}
+
+template<typename T>
+void EmbossPlaneRow(const uchar* previousRow, const uchar* row, uchar* dst, int cols)
+{
+    if (previousRow == nullptr) {
+        // initialize pixels without top-left neighbor as gray
+        memset(dst, 128, static_cast<size_t>(cols));
+        return;
+    }
+
+    const typename T::Bytes offset = T::Set1U8(128);
+
+    int y = 1;
+    for (; y + T::Pixels <= cols; y += T::Pixels) {
+        typename T::Bytes value = T::LoadPlane(row + y);
+        typename T::Bytes compare = T::LoadPlane(previousRow + y - 1);
+        typename T::Bytes diff = T::Or(T::SubsU8(value, compare), T::SubsU8(compare, value));
+        T::StorePlane(dst + y, T::AddsU8(diff, offset));
+    }
+
+    SimdKernels::EmbossPlanePixels(previousRow + y - 1, row + y, dst + y, cols - y);
+    dst[0] = 128;
+}
+
+template<typename T>
+const SimdKernelTable& MakeKernelTable(SimdLevel level, const char* name)
+{
+    static const SimdKernelTable table = { level, name, &GrayscaleRow<T>, &HSVRow<T>, &EmbossRow<T>,
+        &GrayscalePlaneRow<T>, &ExpandPlaneRow<T>, &EmbossPlaneRow<T> };
+    return table;
+}
+
+}
@@ -0,0 +1,77 @@
+#include "SimdKernels.h"
+
+#ifdef SIMD_KERNELS_X86
+#include <smmintrin.h>
+#include "SimdKernelsImpl.h"
+
+namespace {
+
+struct SSE41Traits
+{
+    typedef __m128i Bytes;
+    typedef __m128 Floats;
+    typedef __m128 Mask;
+    typedef __m128d Doubles;
+
+    static const int Pixels = 16;
+
+    static void LoadPixels(const uchar* src, Bytes chunks[3])
+    {
+        for (int k = 0; k < 3; k++) chunks[k] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16 * k));
+    }
+
+    static void StorePixels(uchar* dst, const Bytes chunks[3])
+    {
+        for (int k = 0; k < 3; k++) _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16 * k), chunks[k]);
+    }
+
+    // a plane holds one byte per pixel in pixel order
+    static Bytes LoadPlane(const uchar* src) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(src)); }
+    static void StorePlane(uchar* dst, Bytes plane) { _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), plane); }
+
+    static Bytes LanePattern(const signed char* pattern) { return _mm_load_si128(reinterpret_cast<const __m128i*>(pattern)); }
+    static Bytes Shuffle(Bytes v, Bytes pattern) { return _mm_shuffle_epi8(v, pattern); }
+    static Bytes Or(Bytes a, Bytes b) { return _mm_or_si128(a, b); }
+    static Bytes AndInt(Bytes a, Bytes b) { return _mm_and_si128(a, b); }
+    static Bytes Zero() { return _mm_setzero_si128(); }
+    static Bytes Set1U8(int v) { return _mm_set1_epi8(static_cast<char>(v)); }
+    static Bytes Set1Int(int v) { return _mm_set1_epi32(v); }
+    static Bytes SubsU8(Bytes a, Bytes b) { return _mm_subs_epu8(a, b); }
+    static Bytes AddsU8(Bytes a, Bytes b) { return _mm_adds_epu8(a, b); }
+    static Bytes MaxU8(Bytes a, Bytes b) { return _mm_max_epu8(a, b); }
+    static Bytes UnpackLo8(Bytes a, Bytes b) { return _mm_unpacklo_epi8(a, b); }
+    static Bytes UnpackHi8(Bytes a, Bytes b) { return _mm_unpackhi_epi8(a, b); }
+    static Bytes UnpackLo16(Bytes a, Bytes b) { return _mm_unpacklo_epi16(a, b); }
+    static Bytes UnpackHi16(Bytes a, Bytes b) { return _mm_unpackhi_epi16(a, b); }
+    static Bytes PackUS32(Bytes a, Bytes b) { return _mm_packus_epi32(a, b); }
+    static Bytes PackUS16(Bytes a, Bytes b) { return _mm_packus_epi16(a, b); }
+
+    static Floats ToFloats(Bytes ints) { return _mm_cvtepi32_ps(ints); }
+    static Bytes ToInt32(Floats v) { return _mm_cvttps_epi32(v); }
+    static Floats Set1F(float v) { return _mm_set1_ps(v); }
+    static Floats AddF(Floats a, Floats b) { return _mm_add_ps(a, b); }
+    static Floats SubF(Floats a, Floats b) { return _mm_sub_ps(a, b); }
+    static Floats MulF(Floats a, Floats b) { return _mm_mul_ps(a, b); }
+    static Floats DivF(Floats a, Floats b) { return _mm_div_ps(a, b); }
+    static Floats MaxF(Floats a, Floats b) { return _mm_max_ps(a, b); }
+    static Floats MinF(Floats a, Floats b) { return _mm_min_ps(a, b); }
+    static Mask CmpEq(Floats a, Floats b) { return _mm_cmpeq_ps(a, b); }
+    static Mask CmpNeq(Floats a, Floats b) { return _mm_cmpneq_ps(a, b); }
+    static Mask CmpLt(Floats a, Floats b) { return _mm_cmplt_ps(a, b); }
+    static Floats Select(Mask mask, Floats a, Floats b) { return _mm_blendv_ps(b, a, mask); }
+
+    static Doubles ToDoublesLo(Bytes ints) { return _mm_cvtepi32_pd(ints); }
+    static Doubles ToDoublesHi(Bytes ints) { return _mm_cvtepi32_pd(_mm_srli_si128(ints, 8)); }
+    static Bytes FromDoubles(Doubles low, Doubles high) { return _mm_unpacklo_epi64(_mm_cvttpd_epi32(low), _mm_cvttpd_epi32(high)); }
+    static Doubles Set1D(double v) { return _mm_set1_pd(v); }
+    static Doubles AddD(Doubles a, Doubles b) { return _mm_add_pd(a, b); }
+    static Doubles MulD(Doubles a, Doubles b) { return _mm_mul_pd(a, b); }
+};
+
+}
+
+const SimdKernelTable& GetSSE41KernelTable()
+{
+    return MakeKernelTable<SSE41Traits>(SimdLevel::SSE41, "SSE4.1");
+}
+#endif
@@ -1,24 +1,45 @@
 #include <iostream>
 #include <opencv2/opencv.hpp>
+#include "AlgorithmBenchmark.h"
+#include "ImageCache.h"
+#include "RawImage.h"
+#include "FilterPipeline.h"
 
 /// <summary>
-/// Applies the specified filter methods on an image located at the specified file path.
+/// Applies the specified filter methods on the specified image.
 /// </summary>
-/// <param name="imagePath">The file path of the to be filtered image</param>
+/// <param name="source">The to be filtered image, which is read from a file or already decoded in memory</param>
 /// <param name="outputDir">The output directory path of the to be filtered image after saving</param>
 /// <param name="filterMethods">The image filter methods that should be run</param>
 /// <param name="useOpenMP">Wether to use OpenMP for the image filter or not</param>
 /// <param name="showImage">Wether to show the resulting image or not</param>
 /// <param name="saveImage">Wether to save the resulting image or not</param>
 static void SimpleFilters(
-    const std::string& imagePath,
+    const ImageSource& source,
     const std::string& outputDir,
     const std::vector<std::function<void(cv::Mat&, bool)>>& filterMethods,
     bool useOpenMP = true,
     bool showImage = false,
     bool saveImage = false
 ) {
-    cv::Mat image = cv::imread(imagePath);
+    // raw output images are mapped before filtering, so that the filters write straight into the output file
+    const std::string outputPath = ImageOutput::GetPath(outputDir, "resulting_image_simple");
+    std::unique_ptr<RawImageFile> outputFile;
+    cv::Mat image;
+    {
+        BenchmarkPhase phase("decode");
+        if (saveImage && ImageOutput::IsRaw()) {
+            cv::Mat sourceImage = source.Get();
+            if (!sourceImage.empty()) {
+                outputFile = std::make_unique<RawImageFile>(outputPath, sourceImage.rows, sourceImage.cols, sourceImage.type());
+                sourceImage.copyTo(outputFile->GetImage());
+                image = outputFile->GetImage();
+            }
+        }
+        else {
+            image = source.GetCopy();
+        }
+    }
 
     if (image.empty())
         throw std::invalid_argument("Could not open or find the image!");
@@ -30,8 +51,9 @@ static void SimpleFilters(
     std::cout << "Image pixels: " << image.cols * image.rows << std::endl;
 #endif
 
-    // apply the filters
+    // apply the filters, each of them timed as a phase of the benchmark
     for (const auto& filter : filterMethods) {
+        BenchmarkPhase phase("filter " + FilterPipeline::GetFilterName(filter));
         filter(image, useOpenMP);
     }
 
@@ -40,6 +62,11 @@ static void SimpleFilters(
     }
 
     if (saveImage) {
-        cv::imwrite(outputDir + "/resulting_image_simple.png", image);
+        // the mapped output file already holds the filtered pixels, unless a filter allocated a new image
+        BenchmarkPhase phase("encode");
+        bool filteredInOutputFile = outputFile && image.data == outputFile->GetImage().data;
+        outputFile.reset();
+        if (!filteredInOutputFile)
+            ImageOutput::Write(outputPath, image);
     }
 }
@@ -0,0 +1,107 @@
+#include <iostream>
+#include <future>
+#include <opencv2/opencv.hpp>
+#include "AlgorithmBenchmark.h"
+#include "FilterPipeline.h"
+#include "ImageStrips.h"
+#include "RawImage.h"
+
+/// <summary>
+/// Applies the specified filter methods on an image that is streamed in horizontal strips, so that images larger than
+/// the memory can be filtered. Every strip is read together with the rows above it that its stencil filters depend
+/// on, filtered and written before the strips that follow it, while the next strip is already read and the previous
+/// strip is still written. Only three strips are held in memory at any time.
+/// </summary>
+/// <param name="imagePath">The file path of the to be filtered raw or PPM image</param>
+/// <param name="outputDir">The output directory path of the to be filtered image after saving</param>
+/// <param name="filterMethods">The image filter methods that should be run</param>
+/// <param name="stripRows">The number of rows of a strip</param>
+/// <param name="useOpenMP">Wether to use OpenMP for the image filter or not</param>
+/// <param name="saveImage">Wether to save the resulting image or not, which is saved as a raw image if that is the
+/// output format and as a PPM image otherwise</param>
+static void StreamFilters(
+    const std::string& imagePath,
+    const std::string& outputDir,
+    const std::vector<std::function<void(cv::Mat&, bool)>>& filterMethods,
+    int stripRows = 256,
+    bool useOpenMP = true,
+    bool saveImage = false
+) {
+    if (stripRows < 1)
+        throw std::invalid_argument("The strip rows have to be at least one!");
+
+    std::unique_ptr<StripReader> reader = StripReader::Open(imagePath);
+    const int rows = reader->GetRows();
+    const int cols = reader->GetCols();
+    const int type = reader->GetType();
+
+    std::unique_ptr<StripWriter> writer;
+    if (saveImage) {
+        std::string outputPath = ImageOutput::IsRaw() ? ImageOutput::GetPath(outputDir, "resulting_image_stream")
+            : outputDir + "/resulting_image_stream.ppm";
+        writer = StripWriter::Create(outputPath, rows, cols, type);
+    }
+
+    // every strip buffer starts with the rows above the strip, which are filtered along with the strip but not
+    // written, so all filters that are not known to be stencils are expected to be pointwise filters
+    const int haloRows = FilterPipeline::FromFilterMethods(filterMethods).GetStencilCount();
+    const int stripCount = (rows + stripRows - 1) / stripRows;
+    auto stripBegin = [&](int strip) { return strip * stripRows; };
+    auto stripEnd = [&](int strip) { return std::min(rows, (strip + 1) * stripRows); };
+    auto stripHaloRows = [&](int strip) { return std::min(haloRows, stripBegin(strip)); };
+    auto stripImage = [&](cv::Mat& buffer, int strip) {
+        return buffer.rowRange(haloRows - stripHaloRows(strip), haloRows + stripEnd(strip) - stripBegin(strip));
+    };
+
+    // a strip is read, filtered and written in three different buffers at the same time
+    std::vector<cv::Mat> buffers(3);
+    for (auto& buffer : buffers) buffer.create(haloRows + stripRows, cols, type);
+
+    auto readStrip = [&](int strip) {
+        cv::Mat rowsOfStrip = buffers[strip % 3].rowRange(haloRows, haloRows + stripEnd(strip) - stripBegin(strip));
+        reader->Read(stripBegin(strip), rowsOfStrip);
+    };
+    auto writeStrip = [&](int strip) {
+        cv::Mat rowsOfStrip = buffers[strip % 3].rowRange(haloRows, haloRows + stripEnd(strip) - stripBegin(strip));
+        writer->Write(rowsOfStrip);
+    };
+
+    const std::string filterPhaseName = "filter " + FilterPipeline::GetFilterName(FilterPipeline::FromFilterMethods(filterMethods));
+    std::future<void> pendingRead = std::async(std::launch::async, readStrip, 0);
+    std::future<void> pendingWrite;
+
+    for (int strip = 0; strip < stripCount; strip++) {
+        {
+            BenchmarkPhase phase("decode");
+            pendingRead.get();
+        }
+        cv::Mat image = stripImage(buffers[strip % 3], strip);
+
+        // the unfiltered last rows of the strip are the rows above the next strip. The buffer of the next strip was
+        // last used by the strip before the previous one, whose write has already finished
+        if (strip + 1 < stripCount) {
+            int nextHaloRows = stripHaloRows(strip + 1);
+            cv::Mat nextHalo = buffers[(strip + 1) % 3].rowRange(haloRows - nextHaloRows, haloRows);
+            image.rowRange(image.rows - nextHaloRows, image.rows).copyTo(nextHalo);
+            pendingRead = std::async(std::launch::async, readStrip, strip + 1);
+        }
+
+        {
+            BenchmarkPhase phase(filterPhaseName);
+            for (const auto& filter : filterMethods) {
+                filter(image, useOpenMP);
+            }
+        }
+
+        if (writer) {
+            BenchmarkPhase phase("encode");
+            if (pendingWrite.valid()) pendingWrite.get();
+            pendingWrite = std::async(std::launch::async, writeStrip, strip);
+        }
+    }
+
+    if (pendingWrite.valid()) {
+        BenchmarkPhase phase("encode");
+        pendingWrite.get();
+    }
+}
@@ -0,0 +1,100 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <stdexcept>
+
+ThreadPool::ThreadPool(int threadCount)
+{
+    Start(threadCount);
+}
+
+ThreadPool::~ThreadPool()
+{
+    Stop();
+}
+
+ThreadPool& ThreadPool::GetShared()
+{
+    static ThreadPool sharedPool;
+    return sharedPool;
+}
+
+void ThreadPool::SetThreadCount(int threadCount)
+{
+    if (threadCount == GetThreadCount()) return;
+    Stop();
+    Start(threadCount);
+}
+
+void ThreadPool::Start(int threadCount)
+{
+    if (threadCount < 1)
+        throw std::invalid_argument("A thread pool needs at least one thread!");
+
+    stopping = false;
+    for (int i = 1; i < threadCount; i++) workers.emplace_back(&ThreadPool::Work, this);
+}
+
+void ThreadPool::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    for (auto& worker : workers) worker.join();
+    workers.clear();
+}
+
+void ThreadPool::Work()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    unsigned long long seenGeneration = generation;
+    while (true) {
+        wakeUp.wait(lock, [&]() { return stopping || generation != seenGeneration; });
+        if (stopping) return;
+        seenGeneration = generation;
+        std::shared_ptr<Loop> loop = currentLoop;
+        lock.unlock();
+
+        if (loop) {
+            // a worker joining a closed loop must not call the function, whose caller may already have returned
+            loop->running++;
+            if (!loop->closed) loop->Run(loop->nextRange++ % loop->rangeCount);
+            loop->running--;
+        }
+        lock.lock();
+    }
+}
+
+void ThreadPool::Run(const std::shared_ptr<Loop>& loop, int count)
+{
+    for (int range = 0; range < loop->rangeCount; range++) {
+        loop->ranges[range].next.store(static_cast<int>(static_cast<long long>(count) * range / loop->rangeCount), std::memory_order_relaxed);
+        loop->ranges[range].end = static_cast<int>(static_cast<long long>(count) * (range + 1) / loop->rangeCount);
+    }
+    loop->nextRange.store(1);
+    loop->closed.store(false);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        currentLoop = loop;
+        generation++;
+    }
+    wakeUp.notify_all();
+
+    // the caller takes the first range and every index no worker took
+    loop->Run(0);
+    loop->closed.store(true);
+    while (loop->running.load() > 0) std::this_thread::yield();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (currentLoop == loop) currentLoop.reset();
+}
+
+void ThreadPool::Loop::Run(int firstRange)
+{
+    for (int offset = 0; offset < rangeCount; offset++) {
+        StealRange& range = ranges[(firstRange + offset) % rangeCount];
+        for (int i = range.next.fetch_add(1); i < range.end; i = range.next.fetch_add(1)) call(function, i);
+    }
+}
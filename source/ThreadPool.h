@@ -0,0 +1,115 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/// <summary>
+/// Pool of worker threads that run the indices of a loop by work stealing, as an alternative to OpenMP for host
+/// applications that already run their own threads. The calling thread takes part in its loop, every thread starts on
+/// its own consecutive range of indices and takes the remaining indices of other ranges once its own range is done.
+/// The caller runs every index no worker took, so loops of several callers and loops started by a worker of the pool
+/// share the workers without waiting for each other.
+/// </summary>
+class ThreadPool
+{
+public:
+    /// <summary>
+    /// Creates a pool, whose threads together with the calling thread of a loop make up the given number of threads.
+    /// </summary>
+    /// <param name="threadCount">The number of threads of a loop, at least one</param>
+    explicit ThreadPool(int threadCount = 1);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /// <summary>
+    /// Returns the pool that is shared by all filters of the process.
+    /// </summary>
+    /// <returns></returns>
+    static ThreadPool& GetShared();
+
+    /// <summary>
+    /// Returns the number of threads of a loop, including the calling thread.
+    /// </summary>
+    /// <returns></returns>
+    int GetThreadCount() const {
+        return static_cast<int>(workers.size()) + 1;
+    }
+
+    /// <summary>
+    /// Stops the workers and starts as many as needed for the given number of threads of a loop.
+    /// Has to be called while no loop runs.
+    /// </summary>
+    /// <param name="threadCount">The number of threads of a loop, at least one</param>
+    void SetThreadCount(int threadCount);
+
+    /// <summary>
+    /// Calls the function for every index from 0 to count and returns once all calls returned.
+    /// </summary>
+    /// <param name="count">The number of indices</param>
+    /// <param name="function">Called with every index, from multiple threads at once</param>
+    template<typename Function>
+    void ForEach(int count, const Function& function);
+
+private:
+    // the next index of a range, which other threads take from when stealing
+    struct alignas(64) StealRange
+    {
+        std::atomic<int> next;
+        int end;
+    };
+
+    struct Loop
+    {
+        void (*call)(const void* function, int index) = nullptr;
+        const void* function = nullptr;
+        std::unique_ptr<StealRange[]> ranges;
+        int rangeCount = 0;
+        std::atomic<int> nextRange{ 0 };
+        // the threads that are running indices, the caller waits for them once it closed the loop
+        std::atomic<int> running{ 0 };
+        std::atomic<bool> closed{ false };
+
+        void Run(int firstRange);
+    };
+
+    std::vector<std::thread> workers;
+    std::shared_ptr<Loop> currentLoop;
+    unsigned long long generation = 0;
+    bool stopping = false;
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+
+    void Start(int threadCount);
+    void Stop();
+    void Work();
+    void Run(const std::shared_ptr<Loop>& loop, int count);
+};
+
+template<typename Function>
+void ThreadPool::ForEach(int count, const Function& function)
+{
+    if (count <= 0) return;
+    if (workers.empty() || count == 1) {
+        for (int i = 0; i < count; i++) function(i);
+        return;
+    }
+
+    // the loop is kept by the calling thread between the calls, so that filtering frames does not allocate. It is
+    // only replaced while a worker still holds it from the previous call
+    static thread_local std::shared_ptr<Loop> loop;
+    const int rangeCount = GetThreadCount();
+    if (!loop || loop.use_count() > 1 || loop->rangeCount != rangeCount) {
+        loop = std::make_shared<Loop>();
+        loop->ranges = std::make_unique<StealRange[]>(rangeCount);
+        loop->rangeCount = rangeCount;
+    }
+    loop->call = [](const void* function, int index) { (*static_cast<const Function*>(function))(index); };
+    loop->function = &function;
+    Run(loop, count);
+}
@@ -0,0 +1,142 @@
+#include "TileScheduler.h"
+#include <algorithm>
+#include <stdexcept>
+
+std::string TileSchedule::GetName() const
+{
+    return TileScheduler::GetPolicyName(policy) + " " + std::to_string(tileRows) + "x" + std::to_string(tileCols);
+}
+
+static TileSchedule& ActiveSchedule()
+{
+    static TileSchedule schedule;
+    return schedule;
+}
+
+const TileSchedule& TileScheduler::GetSchedule()
+{
+    return ActiveSchedule();
+}
+
+void TileScheduler::SetSchedule(const TileSchedule& schedule)
+{
+    if (schedule.tileRows < 0 || schedule.tileCols < 0)
+        throw std::invalid_argument("The tiles cannot have a negative size!");
+    ActiveSchedule() = schedule;
+}
+
+static ParallelBackend activeBackend = ParallelBackend::OpenMP;
+static int activeThreadCount = 0;
+
+ParallelBackend TileScheduler::GetBackend()
+{
+    return activeBackend;
+}
+
+void TileScheduler::SetBackend(ParallelBackend backend)
+{
+    if (!IsBackendAvailable(backend))
+        throw std::invalid_argument("The backend " + GetBackendName(backend) + " is not available in this build!");
+    activeBackend = backend;
+    SetThreadCount((activeThreadCount > 0) ? activeThreadCount : omp_get_max_threads());
+}
+
+bool TileScheduler::IsBackendAvailable(ParallelBackend backend)
+{
+    // the parallel algorithms are only left out of builds without them
+#ifdef TILE_SCHEDULER_PARALLEL_ALGORITHMS
+    const bool hasParallelAlgorithms = true;
+#else
+    const bool hasParallelAlgorithms = false;
+#endif
+    return backend != ParallelBackend::ParallelAlgorithms || hasParallelAlgorithms;
+}
+
+int TileScheduler::GetThreadCount()
+{
+    switch (activeBackend) {
+    case ParallelBackend::ThreadPool:
+        return ThreadPool::GetShared().GetThreadCount();
+    case ParallelBackend::OpenCV:
+        return std::max(1, cv::getNumThreads());
+    case ParallelBackend::ParallelAlgorithms:
+        return (activeThreadCount > 0) ? activeThreadCount : omp_get_num_procs();
+    default:
+        return omp_get_max_threads();
+    }
+}
+
+void TileScheduler::SetThreadCount(int threadCount)
+{
+    if (threadCount < 1)
+        throw std::invalid_argument("At least one thread is needed!");
+    activeThreadCount = threadCount;
+    omp_set_num_threads(threadCount);
+
+    // the workers of the pool are only started for the pool, OpenCV keeps its default outside of its backend, so
+    // that the opencv mode still measures the threads OpenCV chooses itself
+    ThreadPool::GetShared().SetThreadCount((activeBackend == ParallelBackend::ThreadPool) ? threadCount : 1);
+    cv::setNumThreads((activeBackend == ParallelBackend::OpenCV) ? threadCount : -1);
+}
+
+std::string TileScheduler::GetBackendName(ParallelBackend backend)
+{
+    switch (backend) {
+    case ParallelBackend::OpenMP:
+        return "openmp";
+    case ParallelBackend::ThreadPool:
+        return "pool";
+    case ParallelBackend::OpenCV:
+        return "opencv";
+    case ParallelBackend::ParallelAlgorithms:
+        return "std";
+    }
+    return "unknown";
+}
+
+ParallelBackend TileScheduler::ParseBackend(const std::string& name)
+{
+    for (ParallelBackend backend : { ParallelBackend::OpenMP, ParallelBackend::ThreadPool, ParallelBackend::OpenCV, ParallelBackend::ParallelAlgorithms }) {
+        if (GetBackendName(backend) == name) return backend;
+    }
+    throw std::invalid_argument("The backend " + name + " is unknown!");
+}
+
+std::string TileScheduler::GetPolicyName(SchedulePolicy policy)
+{
+    switch (policy) {
+    case SchedulePolicy::Static:
+        return "static";
+    case SchedulePolicy::Dynamic:
+        return "dynamic";
+    case SchedulePolicy::Guided:
+        return "guided";
+    case SchedulePolicy::WorkStealing:
+        return "stealing";
+    }
+    return "unknown";
+}
+
+SchedulePolicy TileScheduler::ParsePolicy(const std::string& name)
+{
+    for (SchedulePolicy policy : { SchedulePolicy::Static, SchedulePolicy::Dynamic, SchedulePolicy::Guided, SchedulePolicy::WorkStealing }) {
+        if (GetPolicyName(policy) == name) return policy;
+    }
+    throw std::invalid_argument("The schedule " + name + " is unknown!");
+}
+
+int TileScheduler::GetTileCount(int rows, int cols, int tileRows, int tileCols)
+{
+    if (rows <= 0 || cols <= 0) return 0;
+    int tileColCount = (tileCols > 0) ? (cols + tileCols - 1) / tileCols : 1;
+    return ((rows + tileRows - 1) / tileRows) * tileColCount;
+}
+
+cv::Rect TileScheduler::GetTile(int tile, int rows, int cols, int tileRows, int tileCols)
+{
+    if (tileCols <= 0) tileCols = cols;
+    int tileColCount = (cols + tileCols - 1) / tileCols;
+    int rowBegin = (tile / tileColCount) * tileRows;
+    int colBegin = (tile % tileColCount) * tileCols;
+    return cv::Rect(colBegin, rowBegin, std::min(tileCols, cols - colBegin), std::min(tileRows, rows - rowBegin));
+}
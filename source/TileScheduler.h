@@ -0,0 +1,344 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <omp.h>
+#include <opencv2/opencv.hpp>
+#include "NumaPlacement.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+
+#if __has_include(<execution>)
+#include <execution>
+#endif
+// builds whose standard library needs a library it is not linked with define TILE_SCHEDULER_NO_PARALLEL_ALGORITHMS
+#if defined(__cpp_lib_parallel_algorithm) && !defined(TILE_SCHEDULER_NO_PARALLEL_ALGORITHMS)
+#define TILE_SCHEDULER_PARALLEL_ALGORITHMS
+#endif
+
+/// <summary>
+/// The policies that distribute the tiles of an image between the OpenMP threads.
+/// </summary>
+enum class SchedulePolicy
+{
+    Static,
+    Dynamic,
+    Guided,
+    WorkStealing,
+};
+
+/// <summary>
+/// The threading libraries that can run the tiles of the filters in parallel.
+/// </summary>
+enum class ParallelBackend
+{
+    OpenMP,
+    // the work-stealing pool of std::threads, see ThreadPool
+    ThreadPool,
+    // cv::parallel_for_, which runs on the threading library OpenCV was built with
+    OpenCV,
+    // std::for_each with the parallel execution policy of C++17
+    ParallelAlgorithms,
+};
+
+/// <summary>
+/// The shape of the tiles an image is filtered in and the policy distributing them between the threads.
+/// </summary>
+struct TileSchedule
+{
+    SchedulePolicy policy = SchedulePolicy::Dynamic;
+    // the rows of a tile, 0 keeps the default of every filter: single rows for pointwise filters and a few bands per
+    // thread for stencils and fused sweeps
+    int tileRows = 0;
+    // the columns of a tile, 0 filters whole rows. Stencils always filter whole rows, since they are filtered in place
+    // and would need the unfiltered column to the left of every tile
+    int tileCols = 0;
+
+    bool operator==(const TileSchedule& other) const {
+        return policy == other.policy && tileRows == other.tileRows && tileCols == other.tileCols;
+    }
+
+    /// <summary>
+    /// Returns a readable description of the schedule, e.g. "dynamic 16x256".
+    /// </summary>
+    /// <returns></returns>
+    std::string GetName() const;
+};
+
+/// <summary>
+/// Runs the tiles of the filters with the schedule and the backend that are active for the process. Both are set
+/// before filtering, like the instruction set of the kernels, so that the filter methods keep their signature, whose
+/// useOpenMP parameter tells wether to filter in parallel with the active backend.
+/// </summary>
+class TileScheduler
+{
+public:
+    /// <summary>
+    /// Returns the active schedule, which is dynamic with the default tiles of every filter unless it was changed.
+    /// </summary>
+    /// <returns></returns>
+    static const TileSchedule& GetSchedule();
+
+    /// <summary>
+    /// Changes the active schedule. Has to be called before filtering, while no other thread filters.
+    /// </summary>
+    /// <param name="schedule"></param>
+    static void SetSchedule(const TileSchedule& schedule);
+
+    /// <summary>
+    /// Returns the active backend, which is OpenMP unless it was changed.
+    /// </summary>
+    /// <returns></returns>
+    static ParallelBackend GetBackend();
+
+    /// <summary>
+    /// Changes the active backend and passes the number of threads on to it.
+    /// Has to be called before filtering, while no other thread filters.
+    /// Throws an invalid_argument exception if the backend is not available in this build.
+    /// </summary>
+    /// <param name="backend"></param>
+    static void SetBackend(ParallelBackend backend);
+
+    /// <summary>
+    /// Returns wether a backend is available in this build. The parallel algorithms need a standard library that
+    /// implements the execution policies.
+    /// </summary>
+    /// <param name="backend"></param>
+    /// <returns></returns>
+    static bool IsBackendAvailable(ParallelBackend backend);
+
+    /// <summary>
+    /// Returns the number of threads of the active backend for the calling thread, which the filters divide their
+    /// images by. The parallel algorithms are assumed to use the number of threads that was set.
+    /// </summary>
+    /// <returns></returns>
+    static int GetThreadCount();
+
+    /// <summary>
+    /// Sets the number of threads of OpenMP and of the active backend.
+    /// Has to be called before filtering, while no other thread filters.
+    /// </summary>
+    /// <param name="threadCount">The number of threads, at least one</param>
+    static void SetThreadCount(int threadCount);
+
+    /// <summary>
+    /// Returns the name of a backend as it is given on the command line.
+    /// </summary>
+    /// <param name="backend"></param>
+    /// <returns></returns>
+    static std::string GetBackendName(ParallelBackend backend);
+
+    /// <summary>
+    /// Returns the backend of a name as it is given on the command line.
+    /// Throws an invalid_argument exception for unknown names.
+    /// </summary>
+    /// <param name="name">One of openmp, pool, opencv and std</param>
+    /// <returns></returns>
+    static ParallelBackend ParseBackend(const std::string& name);
+
+    /// <summary>
+    /// Returns the name of a policy as it is given on the command line.
+    /// </summary>
+    /// <param name="policy"></param>
+    /// <returns></returns>
+    static std::string GetPolicyName(SchedulePolicy policy);
+
+    /// <summary>
+    /// Returns the policy of a name as it is given on the command line.
+    /// Throws an invalid_argument exception for unknown names.
+    /// </summary>
+    /// <param name="name">One of static, dynamic, guided and stealing</param>
+    /// <returns></returns>
+    static SchedulePolicy ParsePolicy(const std::string& name);
+
+    /// <summary>
+    /// Returns the number of tiles of an image, which are counted row by row.
+    /// </summary>
+    /// <param name="rows">The rows of the image</param>
+    /// <param name="cols">The columns of the image</param>
+    /// <param name="tileRows">The rows of a tile, at least one</param>
+    /// <param name="tileCols">The columns of a tile, 0 for whole rows</param>
+    /// <returns></returns>
+    static int GetTileCount(int rows, int cols, int tileRows, int tileCols);
+
+    /// <summary>
+    /// Returns the pixels of a tile, the tiles at the right and bottom border of the image are cut off.
+    /// </summary>
+    /// <param name="tile">The index of the tile, counted row by row</param>
+    /// <param name="rows">The rows of the image</param>
+    /// <param name="cols">The columns of the image</param>
+    /// <param name="tileRows">The rows of a tile, at least one</param>
+    /// <param name="tileCols">The columns of a tile, 0 for whole rows</param>
+    /// <returns></returns>
+    static cv::Rect GetTile(int tile, int rows, int cols, int tileRows, int tileCols);
+
+    /// <summary>
+    /// Calls the function for every index from 0 to count, distributed between the threads of the active backend by
+    /// the policy. With work stealing every thread starts on its own consecutive range of indices, which keeps
+    /// neighboring tiles on the same core, and takes the remaining indices of other threads once its own range is done.
+    /// The thread pool always steals work. OpenCV and the parallel algorithms get one consecutive range per thread with
+    /// the static policy and single indices otherwise, which they distribute by their own policy. While the trace is
+    /// enabled the time every thread spent on its indices is recorded, see TraceRegion.
+    /// </summary>
+    /// <param name="count">The number of indices</param>
+    /// <param name="policy">The policy distributing the indices</param>
+    /// <param name="useOpenMP">Wether to call the function in parallel or not</param>
+    /// <param name="function">Called with every index, from multiple threads at once</param>
+    template<typename Function>
+    static void ForEach(int count, SchedulePolicy policy, bool useOpenMP, const Function& function);
+
+private:
+    // the next index of a thread's range, which other threads take from when stealing
+    struct alignas(64) StealRange
+    {
+        std::atomic<int> next;
+        int end;
+    };
+
+    template<typename Function>
+    static void ForEachBackend(int count, SchedulePolicy policy, bool useOpenMP, const Function& function);
+
+    template<typename Function>
+    static void ForEachStealing(int count, bool useOpenMP, const Function& function);
+
+    // the first index of a consecutive range when count indices are divided into rangeCount ranges
+    static int GetRangeBegin(int count, int range, int rangeCount) {
+        return static_cast<int>(static_cast<long long>(count) * range / rangeCount);
+    }
+
+    template<typename Function>
+    static void ForEachOpenCV(int count, SchedulePolicy policy, const Function& function);
+
+    template<typename Function>
+    static void ForEachParallelAlgorithms(int count, SchedulePolicy policy, const Function& function);
+};
+
+template<typename Function>
+void TileScheduler::ForEach(int count, SchedulePolicy policy, bool useOpenMP, const Function& function)
+{
+    if (Trace::IsEnabled() && useOpenMP) {
+        TraceRegion region(GetPolicyName(policy) + " " + GetBackendName(GetBackend()), GetThreadCount());
+        ForEachBackend(count, policy, useOpenMP, region.Wrap(function));
+    }
+    else {
+        ForEachBackend(count, policy, useOpenMP, function);
+    }
+}
+
+template<typename Function>
+void TileScheduler::ForEachBackend(int count, SchedulePolicy policy, bool useOpenMP, const Function& function)
+{
+    const ParallelBackend backend = GetBackend();
+    if (backend != ParallelBackend::OpenMP && !useOpenMP) {
+        for (int i = 0; i < count; i++) function(i);
+    }
+    else if (backend == ParallelBackend::ThreadPool) {
+        ThreadPool::GetShared().ForEach(count, function);
+    }
+    else if (backend == ParallelBackend::OpenCV) {
+        ForEachOpenCV(count, policy, function);
+    }
+    else if (backend == ParallelBackend::ParallelAlgorithms) {
+        ForEachParallelAlgorithms(count, policy, function);
+    }
+    else if (policy == SchedulePolicy::WorkStealing) {
+        ForEachStealing(count, useOpenMP, function);
+    }
+    else if (policy == SchedulePolicy::Static) {
+        #pragma omp parallel if(useOpenMP)
+        {
+            NumaPlacement::PinTeamThread();
+            #pragma omp for schedule(static)
+            for (int i = 0; i < count; i++) function(i);
+        }
+    }
+    else if (policy == SchedulePolicy::Guided) {
+        #pragma omp parallel if(useOpenMP)
+        {
+            NumaPlacement::PinTeamThread();
+            #pragma omp for schedule(guided)
+            for (int i = 0; i < count; i++) function(i);
+        }
+    }
+    else {
+        #pragma omp parallel if(useOpenMP)
+        {
+            NumaPlacement::PinTeamThread();
+            #pragma omp for schedule(dynamic)
+            for (int i = 0; i < count; i++) function(i);
+        }
+    }
+}
+
+template<typename Function>
+void TileScheduler::ForEachStealing(int count, bool useOpenMP, const Function& function)
+{
+    const int threadCount = useOpenMP ? omp_get_max_threads() : 1;
+
+    // the ranges are kept by the calling thread between the calls, so that filtering frames does not allocate
+    static thread_local std::unique_ptr<StealRange[]> ranges;
+    static thread_local int rangeCount = 0;
+    if (rangeCount < threadCount) {
+        ranges = std::make_unique<StealRange[]>(threadCount);
+        rangeCount = threadCount;
+    }
+    for (int thread = 0; thread < threadCount; thread++) {
+        ranges[thread].next.store(static_cast<int>(static_cast<long long>(count) * thread / threadCount), std::memory_order_relaxed);
+        ranges[thread].end = static_cast<int>(static_cast<long long>(count) * (thread + 1) / threadCount);
+    }
+    StealRange* stealRanges = ranges.get();
+
+    // a team smaller than requested still takes all indices, since every thread visits all ranges
+    #pragma omp parallel num_threads(threadCount) if(useOpenMP)
+    {
+        NumaPlacement::PinTeamThread();
+        int thread = omp_get_thread_num();
+        for (int offset = 0; offset < threadCount; offset++) {
+            StealRange& range = stealRanges[(thread + offset) % threadCount];
+            for (int i = range.next.fetch_add(1); i < range.end; i = range.next.fetch_add(1)) function(i);
+        }
+    }
+}
+
+template<typename Function>
+void TileScheduler::ForEachOpenCV(int count, SchedulePolicy policy, const Function& function)
+{
+    if (count <= 0) return;
+    const int rangeCount = (policy == SchedulePolicy::Static) ? std::max(1, std::min(count, GetThreadCount())) : count;
+    cv::parallel_for_(cv::Range(0, rangeCount), [&](const cv::Range& ranges) {
+        for (int range = ranges.start; range < ranges.end; range++) {
+            int end = GetRangeBegin(count, range + 1, rangeCount);
+            for (int i = GetRangeBegin(count, range, rangeCount); i < end; i++) function(i);
+        }
+    }, rangeCount);
+}
+
+template<typename Function>
+void TileScheduler::ForEachParallelAlgorithms(int count, SchedulePolicy policy, const Function& function)
+{
+    if (count <= 0) return;
+
+#ifdef TILE_SCHEDULER_PARALLEL_ALGORITHMS
+    const int rangeCount = (policy == SchedulePolicy::Static) ? std::max(1, std::min(count, GetThreadCount())) : count;
+
+    // the numbers of the ranges are kept by the calling thread between the calls, so that filtering frames does not allocate
+    static thread_local std::vector<int> ranges;
+    if (static_cast<int>(ranges.size()) < rangeCount) {
+        ranges.resize(rangeCount);
+        for (int range = 0; range < rangeCount; range++) ranges[range] = range;
+    }
+    std::for_each(std::execution::par, ranges.begin(), ranges.begin() + rangeCount, [&](int range) {
+        int end = GetRangeBegin(count, range + 1, rangeCount);
+        for (int i = GetRangeBegin(count, range, rangeCount); i < end; i++) function(i);
+    });
+#else
+    // SetBackend rejects the parallel algorithms in builds without them, so the backend never gets here
+    (void)policy;
+    (void)function;
+    throw std::logic_error("The parallel algorithms are not available in this build!");
+#endif
+}
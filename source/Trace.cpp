@@ -0,0 +1,291 @@
+#include "Trace.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <sstream>
+
+#if defined(__linux__) && __has_include(<linux/perf_event.h>)
+#define TRACE_PERF_EVENTS
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    std::chrono::steady_clock::time_point origin;
+    int process = 0;
+    std::atomic<int> nextThread{ 0 };
+    std::atomic<unsigned long long> nextRegion{ 1 };
+
+    std::mutex eventsMutex;
+    std::vector<TraceEvent> events;
+    TraceTotals totals;
+
+    // the filters the calling thread is in, whose compute time does not include the MPI waits inside of them
+    thread_local int filterDepth = 0;
+
+    // the file descriptors of the cycles, instructions and cache misses, -1 without hardware counters
+    int counterFiles[3] = { -1, -1, -1 };
+
+#ifdef TRACE_PERF_EVENTS
+    int OpenCounter(unsigned long long config)
+    {
+        // inherited counters count every thread that is started by the process afterwards
+        perf_event_attr attributes{};
+        attributes.size = sizeof(attributes);
+        attributes.type = PERF_TYPE_HARDWARE;
+        attributes.config = config;
+        attributes.inherit = 1;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+        return static_cast<int>(syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0));
+    }
+
+    unsigned long long ReadCounter(int file)
+    {
+        unsigned long long value = 0;
+        if (read(file, &value, sizeof(value)) != sizeof(value)) return 0;
+        return value;
+    }
+#endif
+
+    const char* GetCategoryName(TraceCategory category)
+    {
+        switch (category) {
+        case TraceCategory::Phase: return "phase";
+        case TraceCategory::Filter: return "filter";
+        case TraceCategory::Parallel: return "parallel";
+        default: return "mpi";
+        }
+    }
+
+    void WriteString(std::ostream& out, const std::string& text)
+    {
+        out << '"';
+        for (char c : text) {
+            if (c == '"' || c == '\\') out << '\\' << c;
+            else if (static_cast<unsigned char>(c) < 0x20) out << ' ';
+            else out << c;
+        }
+        out << '"';
+    }
+
+    void WriteMetadata(std::ostream& out, const char* name, int thread, const std::string& value)
+    {
+        out << "{\"name\": \"" << name << "\", \"ph\": \"M\", \"pid\": " << process << ", \"tid\": " << thread
+            << ", \"args\": {\"name\": ";
+        WriteString(out, value);
+        out << "}}";
+    }
+}
+
+void Trace::Enable(int process)
+{
+    ::process = process;
+    origin = std::chrono::steady_clock::now();
+    GetThreadId();
+
+#ifdef TRACE_PERF_EVENTS
+    const unsigned long long configs[3] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES };
+    for (int i = 0; i < 3; i++) counterFiles[i] = OpenCounter(configs[i]);
+
+    // the counters are only used together, e.g. virtual machines and containers often permit none of them
+    if (std::any_of(std::begin(counterFiles), std::end(counterFiles), [](int file) { return file < 0; })) {
+        for (int& file : counterFiles) {
+            if (file >= 0) close(file);
+            file = -1;
+        }
+    }
+#endif
+
+    enabled = true;
+}
+
+bool Trace::HasCounters()
+{
+    return counterFiles[0] >= 0;
+}
+
+TraceCounters Trace::ReadCounters()
+{
+    TraceCounters counters;
+#ifdef TRACE_PERF_EVENTS
+    if (HasCounters()) {
+        counters.cycles = ReadCounter(counterFiles[0]);
+        counters.instructions = ReadCounter(counterFiles[1]);
+        counters.cacheMisses = ReadCounter(counterFiles[2]);
+    }
+#endif
+    return counters;
+}
+
+double Trace::Now()
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - origin).count();
+}
+
+int Trace::GetThreadId()
+{
+    thread_local int thread = nextThread++;
+    return thread;
+}
+
+void Trace::Record(TraceEvent event, size_t bytes, const TraceCounters* counters)
+{
+    if (bytes > 0) event.args.push_back({ "bytes", static_cast<double>(bytes) });
+    if (counters) {
+        event.args.push_back({ "cycles", static_cast<double>(counters->cycles) });
+        event.args.push_back({ "instructions", static_cast<double>(counters->instructions) });
+        event.args.push_back({ "cache_misses", static_cast<double>(counters->cacheMisses) });
+    }
+
+    std::lock_guard<std::mutex> lock(eventsMutex);
+    // filters that call other filters, e.g. the collapsed filters of gray images, are only counted once
+    if (event.category == TraceCategory::Filter && filterDepth == 0) {
+        totals.compute += event.duration / 1000;
+        totals.computeBytes += static_cast<double>(bytes);
+        if (counters) {
+            totals.cycles += static_cast<double>(counters->cycles);
+            totals.instructions += static_cast<double>(counters->instructions);
+            totals.cacheMisses += static_cast<double>(counters->cacheMisses);
+        }
+    }
+    else if (event.category == TraceCategory::MPI) {
+        totals.communication += event.duration / 1000;
+        totals.communicationBytes += static_cast<double>(bytes);
+        if (filterDepth > 0 && event.thread == GetThreadId()) totals.compute -= event.duration / 1000;
+    }
+    events.push_back(std::move(event));
+}
+
+TraceTotals Trace::GetTotals()
+{
+    std::lock_guard<std::mutex> lock(eventsMutex);
+    return totals;
+}
+
+void Trace::ResetTotals()
+{
+    std::lock_guard<std::mutex> lock(eventsMutex);
+    totals = TraceTotals();
+}
+
+void Trace::WriteEvents(std::ostream& out)
+{
+    std::lock_guard<std::mutex> lock(eventsMutex);
+
+    // the times are written in microseconds with a nanosecond resolution
+    std::ostringstream json;
+    json.precision(3);
+    json << std::fixed;
+    WriteMetadata(json, "process_name", 0, "rank " + std::to_string(process));
+    for (int thread = 0; thread < nextThread.load(); thread++) {
+        json << ",\n";
+        WriteMetadata(json, "thread_name", thread, (thread == 0) ? "main" : "thread " + std::to_string(thread));
+    }
+
+    for (const TraceEvent& event : events) {
+        json << ",\n{\"name\": ";
+        WriteString(json, event.name);
+        json << ", \"cat\": \"" << GetCategoryName(event.category) << "\", \"ph\": \"X\", \"pid\": " << process
+            << ", \"tid\": " << event.thread << ", \"ts\": " << event.begin << ", \"dur\": " << event.duration
+            << ", \"args\": {";
+        for (size_t i = 0; i < event.args.size(); i++) {
+            json << (i == 0 ? "" : ", ");
+            WriteString(json, event.args[i].first);
+            json << ": " << event.args[i].second;
+        }
+        json << "}}";
+    }
+    out << json.str();
+}
+
+void TraceScope::Start()
+{
+    if (category == TraceCategory::Filter) filterDepth++;
+    if (Trace::HasCounters()) counters = Trace::ReadCounters();
+    begin = Trace::Now();
+}
+
+void TraceScope::Finish()
+{
+    double end = Trace::Now();
+    if (category == TraceCategory::Filter) filterDepth--;
+
+    TraceEvent event{ literalName ? std::string(literalName) : std::move(name), category, Trace::GetThreadId(), begin, end - begin, {} };
+    if (!Trace::HasCounters()) {
+        Trace::Record(std::move(event), bytes);
+        return;
+    }
+
+    TraceCounters endCounters = Trace::ReadCounters();
+    endCounters.cycles -= counters.cycles;
+    endCounters.instructions -= counters.instructions;
+    endCounters.cacheMisses -= counters.cacheMisses;
+    Trace::Record(std::move(event), bytes, &endCounters);
+}
+
+TraceRegion::TraceRegion(std::string name, int threadCount)
+    : name(std::move(name)), threadCount(threadCount), serial(nextRegion++), begin(Trace::Now())
+{
+}
+
+TraceRegion::~TraceRegion()
+{
+    const double end = Trace::Now();
+    const double duration = end - begin;
+    double busy = 0;
+    double maxBusy = 0;
+    int tiles = 0;
+
+    // every thread that ran a tile gets an event from its first to its last tile, a thread waits for the others
+    // from the end of its last tile until the end of the loop
+    for (const ThreadTiles& thread : threads) {
+        busy += thread.busy;
+        maxBusy = std::max(maxBusy, thread.busy);
+        tiles += thread.tiles;
+        Trace::Record({ name, TraceCategory::Parallel, thread.thread, thread.first, thread.last - thread.first,
+            { { "busy_ms", thread.busy / 1000 }, { "idle_ms", (duration - thread.busy) / 1000 }, { "tiles", static_cast<double>(thread.tiles) } } });
+    }
+
+    // threads that got no tile were idle for the whole loop
+    const int threads = std::max(threadCount, static_cast<int>(this->threads.size()));
+    const double idle = threads * duration - busy;
+    const double meanBusy = busy / threads;
+    Trace::Record({ name, TraceCategory::Parallel, Trace::GetThreadId(), begin, duration,
+        { { "threads", static_cast<double>(threads) }, { "tiles", static_cast<double>(tiles) },
+        { "imbalance", (meanBusy > 0) ? maxBusy / meanBusy : 1.0 } } });
+
+    std::lock_guard<std::mutex> lock(eventsMutex);
+    totals.busy += busy / 1000;
+    totals.idle += idle / 1000;
+}
+
+void TraceRegion::AddTile(double tileBegin, double tileEnd)
+{
+    // the entry of the thread is looked up once per loop, and again after a nested loop of the same thread
+    struct CachedEntry
+    {
+        unsigned long long serial = 0;
+        ThreadTiles* entry = nullptr;
+    };
+    static thread_local CachedEntry cached;
+
+    if (cached.serial != serial) {
+        const int thread = Trace::GetThreadId();
+        std::lock_guard<std::mutex> lock(mutex);
+        auto entry = std::find_if(threads.begin(), threads.end(), [&](const ThreadTiles& tiles) { return tiles.thread == thread; });
+        if (entry == threads.end()) {
+            threads.push_back({ thread, 0, tileBegin, tileEnd, 0 });
+            entry = threads.end() - 1;
+        }
+        cached = { serial, &*entry };
+    }
+
+    ThreadTiles& entry = *cached.entry;
+    entry.tiles++;
+    entry.first = std::min(entry.first, tileBegin);
+    entry.last = std::max(entry.last, tileEnd);
+    entry.busy += tileEnd - tileBegin;
+}
@@ -0,0 +1,255 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/// <summary>
+/// The kinds of events of a trace, which are the categories of the Chrome trace events.
+/// </summary>
+enum class TraceCategory
+{
+    // the phases of the benchmarks, e.g. decode, scatter, filter, gather and encode
+    Phase,
+    // a filter or a fused sweep of filters over an image
+    Filter,
+    // the time a thread spent on the tiles of a parallel loop
+    Parallel,
+    // a wait of an MPI process for communication
+    MPI,
+};
+
+/// <summary>
+/// The hardware counters of the process, which count the threads that were started after the trace was enabled.
+/// </summary>
+struct TraceCounters
+{
+    unsigned long long cycles = 0;
+    unsigned long long instructions = 0;
+    unsigned long long cacheMisses = 0;
+};
+
+/// <summary>
+/// A completed event of a trace, with its times in microseconds since the trace was enabled.
+/// </summary>
+struct TraceEvent
+{
+    std::string name;
+    TraceCategory category;
+    int thread;
+    double begin;
+    double duration;
+    // the numbers shown with the event, e.g. the bytes it moved
+    std::vector<std::pair<std::string, double>> args;
+};
+
+/// <summary>
+/// The time and the bytes of the events of a process since the totals were reset, in milliseconds.
+/// </summary>
+struct TraceTotals
+{
+    // the filters, without the MPI waits inside of them
+    double compute = 0;
+    double communication = 0;
+    // the time the threads of the parallel loops spent on tiles and waiting for the other threads of their loop
+    double busy = 0;
+    double idle = 0;
+    double computeBytes = 0;
+    double communicationBytes = 0;
+    // the hardware counters of the process during the filters
+    double cycles = 0;
+    double instructions = 0;
+    double cacheMisses = 0;
+};
+
+/// <summary>
+/// Records the events of the benchmarks in memory, to be exported as Chrome trace events, which chrome://tracing
+/// and Perfetto show as a timeline of every MPI process and thread. The trace is enabled once for the process before
+/// any thread is started and costs a single branch at every instrumented place while it is disabled. On Linux the
+/// events of the calling thread carry the cycles, instructions and last level cache misses of the whole process
+/// during the event if perf_event_open is permitted.
+/// </summary>
+class Trace
+{
+public:
+    /// <summary>
+    /// Returns wether the trace is enabled.
+    /// </summary>
+    /// <returns></returns>
+    static bool IsEnabled() {
+        return enabled;
+    }
+
+    /// <summary>
+    /// Enables the trace and starts its clock. Has to be called before any other thread is started, so that the
+    /// hardware counters count all threads of the process.
+    /// </summary>
+    /// <param name="process">The number of the process in the trace, e.g. its MPI rank</param>
+    static void Enable(int process);
+
+    /// <summary>
+    /// Returns wether the events carry hardware counters.
+    /// </summary>
+    /// <returns></returns>
+    static bool HasCounters();
+
+    /// <summary>
+    /// Reads the hardware counters of the process, which are 0 without hardware counters.
+    /// </summary>
+    /// <returns></returns>
+    static TraceCounters ReadCounters();
+
+    /// <summary>
+    /// Returns the microseconds since the trace was enabled.
+    /// </summary>
+    /// <returns></returns>
+    static double Now();
+
+    /// <summary>
+    /// Returns the number of the calling thread in the trace, the thread that enabled the trace is 0.
+    /// </summary>
+    /// <returns></returns>
+    static int GetThreadId();
+
+    /// <summary>
+    /// Adds a completed event to the trace and its time, bytes and counters to the totals of its category.
+    /// </summary>
+    /// <param name="event"></param>
+    /// <param name="bytes">The bytes the event moved, which are added to the args of the event if not 0</param>
+    /// <param name="counters">The hardware counters during the event, which are added to the args of the event if given</param>
+    static void Record(TraceEvent event, size_t bytes = 0, const TraceCounters* counters = nullptr);
+
+    /// <summary>
+    /// Returns the totals since they were reset.
+    /// </summary>
+    /// <returns></returns>
+    static TraceTotals GetTotals();
+
+    /// <summary>
+    /// Resets the totals, the events are kept.
+    /// </summary>
+    static void ResetTotals();
+
+    /// <summary>
+    /// Writes the events as comma separated Chrome trace events, so that the events of several processes can be
+    /// joined into the traceEvents array of a single trace.
+    /// </summary>
+    /// <param name="out"></param>
+    static void WriteEvents(std::ostream& out);
+
+private:
+    inline static bool enabled = false;
+};
+
+/// <summary>
+/// Records an event of the calling thread from its construction until it goes out of scope, if the trace is enabled.
+/// </summary>
+class TraceScope
+{
+private:
+    bool active;
+    TraceCategory category;
+    const char* literalName;
+    std::string name;
+    size_t bytes;
+    double begin = 0;
+    TraceCounters counters;
+
+    void Start();
+    void Finish();
+
+public:
+    /// <summary>
+    /// Starts an event with a constant name.
+    /// </summary>
+    /// <param name="category"></param>
+    /// <param name="name">The name of the event, which has to outlive the scope</param>
+    /// <param name="bytes">The bytes the event moves</param>
+    TraceScope(TraceCategory category, const char* name, size_t bytes = 0)
+        : active(Trace::IsEnabled()), category(category), literalName(name), bytes(bytes) {
+        if (active) Start();
+    }
+
+    /// <summary>
+    /// Starts an event with a name that is only built by the caller while the trace is enabled.
+    /// </summary>
+    /// <param name="category"></param>
+    /// <param name="name">The name of the event</param>
+    /// <param name="bytes">The bytes the event moves</param>
+    TraceScope(TraceCategory category, std::string name, size_t bytes = 0)
+        : active(Trace::IsEnabled()), category(category), literalName(nullptr), name(std::move(name)), bytes(bytes) {
+        if (active) Start();
+    }
+
+    ~TraceScope() {
+        if (active) Finish();
+    }
+
+    /// <summary>
+    /// Adds bytes that are only known once the event ran, e.g. the bytes of an image the event created.
+    /// </summary>
+    /// <param name="bytes"></param>
+    void AddBytes(size_t bytes) {
+        this->bytes += bytes;
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+};
+
+/// <summary>
+/// Records the time every thread of a parallel loop spent on its tiles and the time it was idle until the last
+/// thread finished, which shows the imbalance of the schedules. The loop runs the function returned by Wrap instead
+/// of its own function, only while the trace is enabled.
+/// </summary>
+class TraceRegion
+{
+public:
+    /// <summary>
+    /// Starts the loop.
+    /// </summary>
+    /// <param name="name">The name of the loop</param>
+    /// <param name="threadCount">The threads the loop runs on, including threads that get no tile</param>
+    TraceRegion(std::string name, int threadCount);
+    ~TraceRegion();
+
+    TraceRegion(const TraceRegion&) = delete;
+    TraceRegion& operator=(const TraceRegion&) = delete;
+
+    /// <summary>
+    /// Returns a function that calls the function of the loop and adds the time of every call to its thread.
+    /// </summary>
+    /// <param name="function">Called with every index, from multiple threads at once</param>
+    /// <returns></returns>
+    template<typename Function>
+    auto Wrap(const Function& function) {
+        return [this, &function](int index) {
+            double tileBegin = Trace::Now();
+            function(index);
+            AddTile(tileBegin, Trace::Now());
+        };
+    }
+
+private:
+    struct ThreadTiles
+    {
+        int thread;
+        int tiles;
+        double first;
+        double last;
+        double busy;
+    };
+
+    std::string name;
+    int threadCount;
+    unsigned long long serial;
+    double begin;
+    // the threads keep their entries while other threads are added
+    std::deque<ThreadTiles> threads;
+    std::mutex mutex;
+
+    void AddTile(double tileBegin, double tileEnd);
+};
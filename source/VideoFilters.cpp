@@ -0,0 +1,170 @@
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <opencv2/opencv.hpp>
+#include "AlgorithmBenchmark.h"
+#include "BoundedQueue.h"
+#include "FilterPipeline.h"
+#include "IncrementalFilter.h"
+
+/// <summary>
+/// A frame of a video on its way from the capture through the filters to the writer.
+/// </summary>
+struct VideoFrame
+{
+    int buffer = -1;
+    high_resolution_clock::time_point captured;
+};
+
+/// <summary>
+/// Applies the specified filter methods on every frame of a video or an image sequence, e.g. frame_%04d.png, and
+/// writes the filtered frames into a video. Capturing, filtering and writing run in their own threads on a fixed set
+/// of frame buffers, which are allocated once and passed between the threads, so that the next frame is captured and
+/// the previous frame is written while a frame is filtered. Frames that waited longer than the maximum latency before
+/// being filtered are dropped, so that the latency stays bounded when the filters cannot keep up. Frames can be
+/// filtered incrementally, re-filtering only the tiles that changed since the previous filtered frame.
+/// </summary>
+/// <param name="videoPath">The file path of the to be filtered video or image sequence</param>
+/// <param name="outputDir">The output directory path of the filtered video after saving</param>
+/// <param name="filterMethods">The image filter methods that should be run</param>
+/// <param name="frameBuffers">The number of frame buffers, at least two</param>
+/// <param name="maxLatency">The maximum milliseconds a frame may wait before being filtered, 0 never drops frames</param>
+/// <param name="tileSize">The size of the tiles of incremental filtering in pixels, 0 filters every frame as a whole</param>
+/// <param name="useOpenMP">Wether to use OpenMP for the image filter or not</param>
+/// <param name="saveImage">Wether to save the resulting video or not</param>
+static void VideoFilters(
+    const std::string& videoPath,
+    const std::string& outputDir,
+    const std::vector<std::function<void(cv::Mat&, bool)>>& filterMethods,
+    int frameBuffers = 3,
+    int maxLatency = 0,
+    int tileSize = 0,
+    bool useOpenMP = true,
+    bool saveImage = false
+) {
+    if (frameBuffers < 2)
+        throw std::invalid_argument("A video needs at least two frame buffers!");
+
+    auto begin = high_resolution_clock::now();
+    cv::VideoCapture capture(videoPath);
+    std::vector<cv::Mat> frames(frameBuffers);
+    if (!capture.isOpened() || !capture.read(frames[0]))
+        throw std::invalid_argument("Could not open or find the video!");
+    double captureDuration = duration<double, std::milli>(high_resolution_clock::now() - begin).count();
+
+    // all buffers are allocated for the size of the first frame, the capture reads into them without allocating
+    const cv::Size frameSize = frames[0].size();
+    for (int i = 1; i < frameBuffers; i++) frames[i].create(frameSize.height, frameSize.width, frames[0].type());
+
+    cv::VideoWriter writer;
+    if (saveImage) {
+        double fps = capture.get(cv::CAP_PROP_FPS);
+        writer.open(outputDir + "/resulting_video.avi", cv::VideoWriter::fourcc('M', 'J', 'P', 'G'),
+            (fps > 0) ? fps : 30, frameSize, frames[0].channels() == 3);
+        if (!writer.isOpened())
+            throw std::invalid_argument("Could not save the video!");
+    }
+
+    BoundedQueue<VideoFrame> freeFrames(frameBuffers);
+    BoundedQueue<VideoFrame> capturedFrames(frameBuffers);
+    BoundedQueue<VideoFrame> filteredFrames(frameBuffers);
+    capturedFrames.Push({ 0, high_resolution_clock::now() });
+    for (int i = 1; i < frameBuffers; i++) freeFrames.Push({ i, {} });
+
+    // the capture and the writer sum the time they were busy, the writer measures the latency of every frame from
+    // its capture until it was written
+    int capturedCount = 1;
+    double writeDuration = 0;
+    std::vector<double> latencies;
+    latencies.reserve(static_cast<size_t>(std::max(0.0, capture.get(cv::CAP_PROP_FRAME_COUNT))));
+
+    // the free frames are only closed when the filters failed, which stops the capture
+    std::atomic<bool> stopped{ false };
+    std::thread captureThread([&]() {
+        VideoFrame frame;
+        while (freeFrames.Pop(frame) && !stopped.load()) {
+            auto readBegin = high_resolution_clock::now();
+            bool read = capture.read(frames[frame.buffer]);
+            frame.captured = high_resolution_clock::now();
+            captureDuration += duration<double, std::milli>(frame.captured - readBegin).count();
+            // a frame of another size ends the video, since it does not fit into the buffers
+            if (!read || frames[frame.buffer].size() != frameSize) break;
+
+            capturedCount++;
+            capturedFrames.Push(frame);
+        }
+        capturedFrames.Close();
+    });
+
+    std::thread writeThread([&]() {
+        VideoFrame frame;
+        while (filteredFrames.Pop(frame)) {
+            auto writeBegin = high_resolution_clock::now();
+            if (saveImage) writer.write(frames[frame.buffer]);
+            auto written = high_resolution_clock::now();
+            writeDuration += duration<double, std::milli>(written - writeBegin).count();
+            latencies.push_back(duration<double, std::milli>(written - frame.captured).count());
+            freeFrames.Push(frame);
+        }
+    });
+
+    // the frames are filtered on the calling thread, which owns the OpenMP threads of the benchmark
+    std::unique_ptr<IncrementalFilter> incrementalFilter;
+    long long tileCount = 0;
+    long long filteredTileCount = 0;
+    int droppedCount = 0;
+    try {
+        const std::string filterPhaseName = "filter " + FilterPipeline::GetFilterName(FilterPipeline::FromFilterMethods(filterMethods));
+        if (tileSize > 0) incrementalFilter = std::make_unique<IncrementalFilter>(filterMethods, tileSize);
+        VideoFrame frame;
+        while (capturedFrames.Pop(frame)) {
+            if (maxLatency > 0 && duration<double, std::milli>(high_resolution_clock::now() - frame.captured).count() > maxLatency) {
+                droppedCount++;
+                freeFrames.Push(frame);
+                continue;
+            }
+
+            {
+                BenchmarkPhase phase(filterPhaseName);
+                if (incrementalFilter) {
+                    incrementalFilter->Apply(frames[frame.buffer], useOpenMP);
+                    tileCount += incrementalFilter->GetTileCount();
+                    filteredTileCount += incrementalFilter->GetFilteredTileCount();
+                }
+                else {
+                    for (const auto& filter : filterMethods) {
+                        filter(frames[frame.buffer], useOpenMP);
+                    }
+                }
+            }
+            filteredFrames.Push(frame);
+        }
+    }
+    catch (...) {
+        // the capture and the writer are stopped and joined before their threads are destroyed
+        stopped = true;
+        freeFrames.Close();
+        filteredFrames.Close();
+        captureThread.join();
+        writeThread.join();
+        throw;
+    }
+    filteredFrames.Close();
+
+    captureThread.join();
+    writeThread.join();
+    double videoDuration = duration<double, std::milli>(high_resolution_clock::now() - begin).count();
+
+    AlgorithmBenchmark::RecordPhase("decode", captureDuration);
+    AlgorithmBenchmark::RecordPhase("encode", writeDuration);
+
+    BenchmarkStatistics latency = BenchmarkStatistics::FromSamples(latencies);
+    std::cout << "Frames: " << capturedCount << ", Filtered: " << latencies.size() << ", Dropped: " << droppedCount << std::endl;
+    std::cout << "Sustained FPS: " << latencies.size() / (videoDuration / 1000) << std::endl;
+    std::cout << "Min / Median / P95 / P99 / Max Latency: " << latency.min << " / " << latency.median << " / "
+        << latency.p95 << " / " << latency.p99 << " / " << latency.max << "ms" << std::endl;
+    if (incrementalFilter)
+        std::cout << "Filtered Tiles: " << filteredTileCount << " of " << tileCount << std::endl;
+}